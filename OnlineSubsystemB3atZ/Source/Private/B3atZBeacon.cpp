@@ -3,6 +3,7 @@
 
 #include "B3atZBeacon.h"
 #include "Misc/FeedbackContext.h"
+#include "Misc/ConfigCacheIni.h"
 #include "UObject/CoreNet.h"
 #include "OnlineSubsystemB3atZ.h"
 #include "SocketSubsystem.h"
@@ -10,6 +11,23 @@
 #include "NboSerializer.h"
 
 
+void FB3atZReceiveBatch::Init(int32 Capacity)
+{
+	if (GetCapacity() != Capacity)
+	{
+		ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+		Buffer.SetNumUninitialized(Capacity * LAN_BEACON_MAX_PACKET_SIZE);
+		PacketSizes.SetNumZeroed(Capacity);
+		SourceAddrs.Empty(Capacity);
+		for (int32 Index = 0; Index < Capacity; Index++)
+		{
+			SourceAddrs.Add(SocketSubsystem->CreateInternetAddr());
+		}
+		NumPackets = 0;
+	}
+}
+
 /** Sets the broadcast address for this object */
 FB3atZBeacon::FB3atZBeacon(void) 
 	: ListenSocket(NULL),
@@ -20,6 +38,8 @@ FB3atZBeacon::FB3atZBeacon(void)
 /** Frees the broadcast socket */
 FB3atZBeacon::~FB3atZBeacon(void)
 {
+	LeaveMulticastGroup();
+
 	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
 	SocketSubsystem->DestroySocket(ListenSocket);
 }
@@ -73,6 +93,71 @@ bool FB3atZBeacon::Init(int32 Port)
 	return bSuccess && ListenSocket;
 }
 
+bool FB3atZBeacon::InitMulticast(int32 Port, const FString& GroupAddress, int32 Ttl)
+{
+	UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("B3atZBeacon InitMulticast"))
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	bool bSuccess = false;
+	// The group doubles as the send address
+	bool bIsValidGroup = false;
+	BroadcastAddr = SocketSubsystem->CreateInternetAddr();
+	BroadcastAddr->SetIp(*GroupAddress, bIsValidGroup);
+	BroadcastAddr->SetPort(Port);
+	if (!bIsValidGroup)
+	{
+		UE_LOG(LogB3atZOnline, Error, TEXT("Invalid multicast group (%s) for LAN beacon"), *GroupAddress);
+		return false;
+	}
+	// Listen on all interfaces so packets sent to the group arrive
+	ListenAddr = SocketSubsystem->GetLocalBindAddr(*GLog);
+	ListenAddr->SetPort(Port);
+	// A temporary "received from" address
+	SockAddr = SocketSubsystem->CreateInternetAddr();
+	ListenSocket = SocketSubsystem->CreateSocket(NAME_DGram, TEXT("LAN beacon"), true);
+	if (ListenSocket != NULL)
+	{
+		ListenSocket->SetReuseAddr();
+		ListenSocket->SetNonBlocking();
+		ListenSocket->SetRecvErr();
+		if (ListenSocket->Bind(*ListenAddr))
+		{
+			if (ListenSocket->JoinMulticastGroup(*BroadcastAddr))
+			{
+				MulticastGroupAddr = BroadcastAddr;
+				// Loopback lets a host and a client on the same machine find each other
+				bSuccess = ListenSocket->SetMulticastTtl((uint8)FMath::Clamp(Ttl, 1, 255)) &&
+					ListenSocket->SetMulticastLoopback(true);
+				UE_LOG(LogB3atZOnline, Verbose, TEXT("B3atZBeacon joined multicast group %s with ttl %d"), *BroadcastAddr->ToString(true), Ttl);
+			}
+			else
+			{
+				UE_LOG(LogB3atZOnline, Error, TEXT("Failed to join multicast group (%s) for LAN beacon"),
+					*BroadcastAddr->ToString(false));
+			}
+		}
+		else
+		{
+			UE_LOG(LogB3atZOnline, Error, TEXT("Failed to bind listen socket to addr (%s) for LAN beacon"),
+				*ListenAddr->ToString(true));
+		}
+	}
+	else
+	{
+		UE_LOG(LogB3atZOnline, Error, TEXT("Failed to create listen socket for LAN beacon"));
+	}
+	return bSuccess && ListenSocket;
+}
+
+void FB3atZBeacon::LeaveMulticastGroup()
+{
+	if (ListenSocket != NULL && MulticastGroupAddr.IsValid())
+	{
+		ListenSocket->LeaveMulticastGroup(*MulticastGroupAddr);
+	}
+	MulticastGroupAddr.Reset();
+}
+
 /**
  * Initializes the socket
  *
@@ -272,6 +357,50 @@ int32 FB3atZBeacon::ReceivePacket(uint8* PacketData, int32 BufferSize)
 	return BytesRead;
 }
 
+int32 FB3atZBeacon::ReceivePackets(FB3atZReceiveBatch& Batch, int32 MaxPackets)
+{
+	Batch.NumPackets = 0;
+	if (ListenSocket != NULL)
+	{
+		const int32 NumToRead = FMath::Min(MaxPackets, Batch.GetCapacity());
+		while (Batch.NumPackets < NumToRead)
+		{
+			const int32 Slot = Batch.NumPackets;
+			int32 BytesRead = 0;
+			// Stop as soon as the socket has nothing left
+			if (!ListenSocket->RecvFrom(Batch.GetPacket(Slot), LAN_BEACON_MAX_PACKET_SIZE, BytesRead, *Batch.SourceAddrs[Slot]) || BytesRead <= 0)
+			{
+				break;
+			}
+			Batch.PacketSizes[Slot] = BytesRead;
+			Batch.NumPackets++;
+		}
+	}
+
+	return Batch.NumPackets;
+}
+
+void FB3atZBeacon::SwapReplyAddr(TSharedRef<FInternetAddr>& Addr)
+{
+	Swap(SockAddr, Addr);
+}
+
+TSharedRef<FInternetAddr> FB3atZBeacon::CopyAddr(const FInternetAddr& Addr)
+{
+	// The string form is the only accessor that carries IPv6 addresses as well
+	TSharedRef<FInternetAddr> Copy = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+	bool bIsValid = false;
+	Copy->SetIp(*Addr.ToString(false), bIsValid);
+	Copy->SetPort(Addr.GetPort());
+	return Copy;
+}
+
+bool FB3atZBeacon::SendPacketTo(uint8* Packet, int32 Length, const FInternetAddr& Addr)
+{
+	int32 BytesSent = 0;
+	return ListenSocket != NULL && ListenSocket->SendTo(Packet, Length, BytesSent, Addr) && (BytesSent == Length);
+}
+
 /**
  * Uses the cached broadcast address to send packet to a subnet
  *
@@ -305,6 +434,37 @@ bool FB3atZBeacon::BroadcastPacketFromSocket(uint8* Packet, int32 Length)
 
 }
 
+/** @return the per tick packet budget from the engine ini, or the default if not configured */
+static int32 GetMaxPacketsPerTickConfig()
+{
+	int32 MaxPackets = LAN_BEACON_MAX_PACKETS_PER_TICK;
+	if (GConfig->GetInt(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconMaxPacketsPerTick"), MaxPackets, GEngineIni) && MaxPackets <= 0)
+	{
+		MaxPackets = LAN_BEACON_MAX_PACKETS_PER_TICK;
+	}
+	return MaxPackets;
+}
+
+/**
+ * Initializes the beacon for LAN discovery, through the multicast group from the
+ * engine ini if bLanBeaconUseMulticast is set, through subnet broadcast otherwise
+ */
+static bool InitLanBeacon(FB3atZBeacon& Beacon, int32 Port)
+{
+	bool bUseMulticast = false;
+	GConfig->GetBool(TEXT("OnlineSubsystemB3atZ"), TEXT("bLanBeaconUseMulticast"), bUseMulticast, GEngineIni);
+	if (!bUseMulticast)
+	{
+		return Beacon.Init(Port);
+	}
+
+	FString GroupAddress = LAN_BEACON_MULTICAST_GROUP;
+	int32 Ttl = LAN_BEACON_MULTICAST_TTL;
+	GConfig->GetString(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconMulticastGroup"), GroupAddress, GEngineIni);
+	GConfig->GetInt(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconMulticastTtl"), Ttl, GEngineIni);
+	return Beacon.InitMulticast(Port, GroupAddress, Ttl);
+}
+
 /**
 * Creates the LAN beacon for queries/advertising servers
 */
@@ -320,11 +480,31 @@ bool FB3atZSession::Host(FOnValidQueryPacketDelegate& QueryDelegate, int32 Port)
 	
 	// Bind a socket for LAN beacon activity
 	B3atZBeacon = new FB3atZBeacon();
+	MaxPacketsPerTick = GetMaxPacketsPerTickConfig();
+
+	// Start every hosting session with a fresh query limiter
+	QueryRatePerSource = B3atZ_QUERY_RATE_PER_SOURCE;
+	QueryBurstPerSource = B3atZ_QUERY_BURST_PER_SOURCE;
+	GConfig->GetFloat(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconQueryRatePerSource"), QueryRatePerSource, GEngineIni);
+	GConfig->GetFloat(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconQueryBurstPerSource"), QueryBurstPerSource, GEngineIni);
+	QueryBurstPerSource = FMath::Max(QueryBurstPerSource, 1.f);
+	PingRatePerSource = B3atZ_PING_RATE_PER_SOURCE;
+	PingBurstPerSource = B3atZ_PING_BURST_PER_SOURCE;
+	GConfig->GetFloat(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconPingRatePerSource"), PingRatePerSource, GEngineIni);
+	GConfig->GetFloat(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconPingBurstPerSource"), PingBurstPerSource, GEngineIni);
+	PingBurstPerSource = FMath::Max(PingBurstPerSource, 1.f);
+	QuerySourceBuckets.Reset();
+	PingSourceBuckets.Reset();
+	AnsweredQueryNonces.Reset();
+	LastQueryLimiterPruneTime = FPlatformTime::Seconds();
+	NumQueriesAnswered = 0;
+	NumQueriesDropped = 0;
+	NumQueriesCoalesced = 0;
 
 	//if its LAN Connection
 	if (Port == -1)
 	{
-		if (B3atZBeacon->Init(LanAnnouncePort))
+		if (InitLanBeacon(*B3atZBeacon, LanAnnouncePort))
 		{
 
 			AddOnValidQueryPacketDelegate_Handle(QueryDelegate);
@@ -379,11 +559,27 @@ bool FB3atZSession::Search(FNboSerializeToBuffer& Packet, FOnValidResponsePacket
 
 	
 	B3atZBeacon = new FB3atZBeacon();
+	MaxPacketsPerTick = GetMaxPacketsPerTickConfig();
+
+	// Reassembly buffers are allocated once and kept across searches
+	if (ReassemblySlots.Num() == 0)
+	{
+		ReassemblySlots.SetNum(B3atZ_REASSEMBLY_SLOTS);
+		for (FReassemblySlot& Slot : ReassemblySlots)
+		{
+			Slot.Buffer.SetNumUninitialized(LAN_BEACON_MAX_FRAGMENTS * LAN_BEACON_FRAGMENT_PAYLOAD_SIZE);
+		}
+	}
+	for (FReassemblySlot& Slot : ReassemblySlots)
+	{
+		Slot.bInUse = false;
+	}
+
 	if (IsLANMatch)
 	{
 		UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("B3atZBeacon Search Init B3atZBeacon"))
 		// Bind a socket for LAN beacon activity
-		if (B3atZBeacon->Init(LanAnnouncePort) == false)
+		if (InitLanBeacon(*B3atZBeacon, LanAnnouncePort) == false)
 		{
 			UE_LOG(LogB3atZOnline, Warning, TEXT("Failed to create socket for lan announce port %s"), ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetSocketError());
 			bSuccess = false;
@@ -446,6 +642,7 @@ void FB3atZSession::StopB3atZSession()
 	OnValidQueryPacketDelegates.Clear();
 	OnValidResponsePacketDelegates.Clear();
 	OnSearchingTimeoutDelegates.Clear();
+	OnPingResponseDelegates.Clear();
 }
 
 void FB3atZSession::Tick(float DeltaTime)
@@ -456,82 +653,421 @@ void FB3atZSession::Tick(float DeltaTime)
 		return;
 	}
 
-	uint8 PacketData[LAN_BEACON_MAX_PACKET_SIZE];
+	ReceiveBatch.Init(LAN_BEACON_RECEIVE_BATCH_SIZE);
+
+	// Delegates may stop or restart the beacon, so remember what we started with
+	FB3atZBeacon* const TickBeacon = B3atZBeacon;
+	const EB3atZBeaconState::Type TickBeaconState = B3atZBeaconState;
+
+	int32 PacketBudget = MaxPacketsPerTick;
 	bool bShouldRead = true;
-	// Read each pending packet and pass it out for processing
-	while (bShouldRead)
+	// Read pending packets in batches and pass them out for processing, anything
+	// beyond the budget stays in the socket until the next tick
+	while (bShouldRead && PacketBudget > 0)
+	{
+		const int32 NumPackets = TickBeacon->ReceivePackets(ReceiveBatch, PacketBudget);
+		for (int32 PacketIdx = 0; PacketIdx < NumPackets; PacketIdx++)
+		{
+			if (B3atZBeacon != TickBeacon || B3atZBeaconState != TickBeaconState)
+			{
+				// The rest of the batch was meant for a beacon that no longer exists
+				return;
+			}
+
+			TickBeacon->SwapReplyAddr(ReceiveBatch.SourceAddrs[PacketIdx]);
+			ProcessPacket(ReceiveBatch.GetPacket(PacketIdx), ReceiveBatch.PacketSizes[PacketIdx]);
+		}
+
+		if (B3atZBeacon != TickBeacon || B3atZBeaconState != TickBeaconState)
+		{
+			// The last packet of the batch stopped or restarted the beacon, don't read from it again
+			return;
+		}
+		PacketBudget -= NumPackets;
+		// A partial batch means the socket has been drained
+		bShouldRead = NumPackets == ReceiveBatch.GetCapacity();
+	}
+
+	if (B3atZBeacon == TickBeacon && B3atZBeaconState == EB3atZBeaconState::Searching)
+	{
+		// Decrement the amount of time remaining
+		B3atZQueryTimeLeft -= DeltaTime;
+		// Check for a timeout on the search packet
+		if (B3atZQueryTimeLeft <= 0.f)
+		{
+			UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("B3atZBeacon Tick SearchTimeout"));
+			TriggerOnSearchingTimeoutDelegates();
+		}
+	}
+}
+
+void FB3atZSession::ProcessPacket(uint8* PacketData, int32 PacketLength)
+{
+	// Check our mode to determine the type of allowed packets
+	if (B3atZBeaconState == EB3atZBeaconState::Hosting)
 	{
-		int32 NumRead = B3atZBeacon->ReceivePacket(PacketData, LAN_BEACON_MAX_PACKET_SIZE);
-		if (NumRead > 0)
+		uint64 ClientNonce;
+		uint8 ClientVersion;
+		// We can only accept Server Query packets
+		if (IsValidLanQueryPacket(PacketData, PacketLength, ClientNonce, ClientVersion))
 		{
-			// Check our mode to determine the type of allowed packets
-			if (B3atZBeaconState == EB3atZBeaconState::Hosting)
+			if (ShouldAnswerQuery(B3atZBeacon->GetReplyAddr(), ClientNonce))
 			{
-				uint64 ClientNonce;
-				// We can only accept Server Query packets
-				if (IsValidLanQueryPacket(PacketData, NumRead, ClientNonce))
-				{
-					// Strip off the header
-					TriggerOnValidQueryPacketDelegates(&PacketData[LAN_BEACON_PACKET_HEADER_SIZE], NumRead - LAN_BEACON_PACKET_HEADER_SIZE, ClientNonce);
-				}
+				// Strip off the header
+				TriggerOnValidQueryPacketDelegates(&PacketData[LAN_BEACON_PACKET_HEADER_SIZE], PacketLength - LAN_BEACON_PACKET_HEADER_SIZE, ClientNonce, ClientVersion);
 			}
-			else if (B3atZBeaconState == EB3atZBeaconState::Searching)
+		}
+		// Or latency probes, which are answered right away within their own rate limit
+		else if (IsValidLanPingPacket(PacketData, PacketLength, LAN_SERVER_PING1, LAN_SERVER_PING2, ClientNonce))
+		{
+			if (ShouldAnswerPing(B3atZBeacon->GetReplyAddr()))
 			{
-				// We can only accept Server Response packets
-				if (IsValidLanResponsePacket(PacketData, NumRead))
-				{
-					// Strip off the header
-					TriggerOnValidResponsePacketDelegates(&PacketData[LAN_BEACON_PACKET_HEADER_SIZE], NumRead - LAN_BEACON_PACKET_HEADER_SIZE);
-				}
+				EchoPing(PacketData, PacketLength);
 			}
 		}
-		else
+	}
+	else if (B3atZBeaconState == EB3atZBeaconState::Searching)
+	{
+		uint64 Nonce;
+		uint8 FragmentIndex;
+		uint8 FragmentCount;
+		// We can only accept Server Response packets
+		if (IsValidLanResponsePacket(PacketData, PacketLength))
+		{
+			// Strip off the header
+			TriggerOnValidResponsePacketDelegates(&PacketData[LAN_BEACON_PACKET_HEADER_SIZE], PacketLength - LAN_BEACON_PACKET_HEADER_SIZE);
+		}
+		// Or pieces of responses too large for a single packet
+		else if (IsValidLanFragmentPacket(PacketData, PacketLength, Nonce, FragmentIndex, FragmentCount))
+		{
+			const int32 HeaderSize = LAN_BEACON_PACKET_HEADER_SIZE + LAN_BEACON_FRAGMENT_HEADER_SIZE;
+			ReassembleFragment(B3atZBeacon->GetReplyAddr(), Nonce, FragmentIndex, FragmentCount, &PacketData[HeaderSize], PacketLength - HeaderSize);
+		}
+		// Or the answers to our own latency probes
+		else if (IsValidLanPingPacket(PacketData, PacketLength, LAN_SERVER_PONG1, LAN_SERVER_PONG2, Nonce) && Nonce == B3atZNonce)
+		{
+			double SendTime = 0.0;
+			int32 PingId = INDEX_NONE;
+			FB3atZBeaconPingPayload::Decode(&PacketData[FB3atZBeaconHeader::Size], SendTime, PingId);
+			TriggerOnPingResponseDelegates(PingId, FPlatformTime::Seconds() - SendTime);
+		}
+	}
+}
+
+bool FB3atZSession::ShouldAnswerQuery(const FInternetAddr& Source, uint64 ClientNonce)
+{
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastQueryLimiterPruneTime >= 1.0)
+	{
+		PruneQueryLimiter(Now);
+	}
+
+	// The same client asking again (or the same broadcast arriving on several
+	// interfaces) gets nothing new from a second answer
+	const double* AnsweredTime = AnsweredQueryNonces.Find(ClientNonce);
+	if (AnsweredTime != NULL && Now - *AnsweredTime < B3atZ_QUERY_COALESCE_WINDOW)
+	{
+		NumQueriesCoalesced++;
+		INC_DWORD_STAT(STAT_B3atZOnline_LanQueriesCoalesced);
+		return false;
+	}
+
+	if (!ConsumeSourceToken(QuerySourceBuckets, Source, QueryRatePerSource, QueryBurstPerSource, Now))
+	{
+		NumQueriesDropped++;
+		INC_DWORD_STAT(STAT_B3atZOnline_LanQueriesDropped);
+		UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("Dropping LAN query from %s, rate limit exceeded"), *Source.ToString(false));
+		return false;
+	}
+
+	// Counted as answered by NotifyQueryAnswered, once the host's session filter sent a response
+	AnsweredQueryNonces.Add(ClientNonce, Now);
+	return true;
+}
+
+bool FB3atZSession::ShouldAnswerPing(const FInternetAddr& Source)
+{
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastQueryLimiterPruneTime >= 1.0)
+	{
+		PruneQueryLimiter(Now);
+	}
+
+	if (!ConsumeSourceToken(PingSourceBuckets, Source, PingRatePerSource, PingBurstPerSource, Now))
+	{
+		NumQueriesDropped++;
+		INC_DWORD_STAT(STAT_B3atZOnline_LanQueriesDropped);
+		UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("Dropping LAN ping from %s, rate limit exceeded"), *Source.ToString(false));
+		return false;
+	}
+	return true;
+}
+
+bool FB3atZSession::ConsumeSourceToken(TMap<FString, FQuerySourceBucket>& Buckets, const FInternetAddr& Source, float Rate, float Burst, double Now)
+{
+	// Keyed by the whole address, IPv6 sources don't fit GetIp's 32 bits
+	FString SourceKey = Source.ToString(false);
+	FQuerySourceBucket* Bucket = Buckets.Find(SourceKey);
+	if (Bucket == NULL)
+	{
+		// Keep the map bounded when flooded from many (possibly spoofed) addresses
+		const FString BucketKey = Buckets.Num() < B3atZ_MAX_QUERY_SOURCES ? MoveTemp(SourceKey) : FString();
+		Bucket = Buckets.Find(BucketKey);
+		if (Bucket == NULL)
+		{
+			Bucket = &Buckets.Add(BucketKey);
+			Bucket->Tokens = Burst;
+			Bucket->LastRefillTime = Now;
+		}
+	}
+
+	// Refill for the time since the last packet from this source
+	Bucket->Tokens = FMath::Min(Burst, Bucket->Tokens + (float)(Now - Bucket->LastRefillTime) * Rate);
+	Bucket->LastRefillTime = Now;
+	if (Bucket->Tokens < 1.f)
+	{
+		return false;
+	}
+
+	Bucket->Tokens -= 1.f;
+	return true;
+}
+
+void FB3atZSession::NotifyQueryAnswered()
+{
+	NumQueriesAnswered++;
+	INC_DWORD_STAT(STAT_B3atZOnline_LanQueriesAnswered);
+}
+
+void FB3atZSession::PruneQueryLimiter(double Now)
+{
+	LastQueryLimiterPruneTime = Now;
+
+	for (TMap<uint64, double>::TIterator It(AnsweredQueryNonces); It; ++It)
+	{
+		if (Now - It.Value() >= B3atZ_QUERY_COALESCE_WINDOW)
 		{
-			if (B3atZBeaconState == EB3atZBeaconState::Searching)
+			It.RemoveCurrent();
+		}
+	}
+
+	PruneSourceBuckets(QuerySourceBuckets, QueryRatePerSource, QueryBurstPerSource, Now);
+	PruneSourceBuckets(PingSourceBuckets, PingRatePerSource, PingBurstPerSource, Now);
+}
+
+void FB3atZSession::PruneSourceBuckets(TMap<FString, FQuerySourceBucket>& Buckets, float Rate, float Burst, double Now)
+{
+	// A bucket that would have refilled completely is the same as no bucket
+	const double FullRefillSeconds = Rate > 0.f ? Burst / Rate : MAX_dbl;
+	for (TMap<FString, FQuerySourceBucket>::TIterator It(Buckets); It; ++It)
+	{
+		if (Now - It.Value().LastRefillTime >= FullRefillSeconds)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FB3atZSession::ReassembleFragment(const FInternetAddr& Source, uint64 ResponseId, uint8 FragmentIndex, uint8 FragmentCount, const uint8* Payload, int32 PayloadLength)
+{
+	// Every fragment but the last is full, so each one's position follows from its index
+	const bool bIsLastFragment = FragmentIndex == FragmentCount - 1;
+	if (bIsLastFragment ? PayloadLength > LAN_BEACON_FRAGMENT_PAYLOAD_SIZE : PayloadLength != LAN_BEACON_FRAGMENT_PAYLOAD_SIZE)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+
+	FReassemblySlot* Slot = NULL;
+	FReassemblySlot* FreeSlot = NULL;
+	for (FReassemblySlot& Candidate : ReassemblySlots)
+	{
+		if (Candidate.bInUse && Now - Candidate.StartTime > B3atZ_REASSEMBLY_TIMEOUT)
+		{
+			UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("Dropping incomplete response %llx from %s"), Candidate.ResponseId, *Candidate.Source->ToString(true));
+			Candidate.bInUse = false;
+		}
+
+		if (Candidate.bInUse)
+		{
+			// Full address comparison, ports included, so IPv6 hosts don't collide
+			if (Candidate.ResponseId == ResponseId && *Candidate.Source == Source)
 			{
-				// Decrement the amount of time remaining
-				B3atZQueryTimeLeft -= DeltaTime;
-				// Check for a timeout on the search packet
-				if (B3atZQueryTimeLeft <= 0.f)
-				{
-					UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("B3atZBeacon Tick SearchTimeout"));
-					TriggerOnSearchingTimeoutDelegates();
-				}
+				Slot = &Candidate;
+				break;
 			}
-			bShouldRead = false;
+		}
+		else if (FreeSlot == NULL)
+		{
+			FreeSlot = &Candidate;
+		}
+	}
+
+	if (Slot == NULL)
+	{
+		if (FreeSlot == NULL)
+		{
+			// Partial responses already in the pool get to finish first
+			UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("No reassembly slot for response %llx, dropping fragment"), ResponseId);
+			return;
+		}
+
+		Slot = FreeSlot;
+		Slot->Source = FB3atZBeacon::CopyAddr(Source);
+		Slot->ResponseId = ResponseId;
+		Slot->FragmentCount = FragmentCount;
+		Slot->ReceivedMask = 0;
+		Slot->ResponseLength = 0;
+		Slot->StartTime = Now;
+		Slot->bInUse = true;
+	}
+
+	const uint32 FragmentBit = 1u << FragmentIndex;
+	if (Slot->FragmentCount != FragmentCount || (Slot->ReceivedMask & FragmentBit) != 0)
+	{
+		// Inconsistent or duplicated fragment
+		return;
+	}
+
+	FMemory::Memcpy(&Slot->Buffer[FragmentIndex * LAN_BEACON_FRAGMENT_PAYLOAD_SIZE], Payload, PayloadLength);
+	Slot->ReceivedMask |= FragmentBit;
+	if (bIsLastFragment)
+	{
+		Slot->ResponseLength = FragmentIndex * LAN_BEACON_FRAGMENT_PAYLOAD_SIZE + PayloadLength;
+	}
+
+	if (Slot->ReceivedMask == (1u << FragmentCount) - 1)
+	{
+		// The buffer stays untouched until a later fragment claims the slot again
+		Slot->bInUse = false;
+		TriggerOnValidResponsePacketDelegates(Slot->Buffer.GetData(), Slot->ResponseLength);
+	}
+}
+
+void FB3atZSession::EchoPing(uint8* Packet, int32 Length)
+{
+	// Everything but the packet type goes back unchanged
+	FB3atZBeaconHeader::Set<EB3atZBeaconHeaderField::PacketType1>(Packet, LAN_SERVER_PONG1);
+	FB3atZBeaconHeader::Set<EB3atZBeaconHeaderField::PacketType2>(Packet, LAN_SERVER_PONG2);
+	BroadcastPacketFromSocket(Packet, Length);
+}
+
+bool FB3atZSession::SendPing(const FInternetAddr& HostAddr, int32 PingId)
+{
+	bool bSuccess = false;
+	if (B3atZBeacon && B3atZBeaconState == EB3atZBeaconState::Searching)
+	{
+		uint8 Packet[FB3atZBeaconHeader::Size + FB3atZBeaconPingPayload::Size];
+		FB3atZBeaconHeader::Encode(Packet,
+			LAN_BEACON_PACKET_VERSION,
+			// Platform information
+			(uint8)FPlatformProperties::IsLittleEndian(),
+			// Game id to prevent cross game lan packets
+			LanGameUniqueId,
+			// Identify the packet type
+			LAN_SERVER_PING1, LAN_SERVER_PING2,
+			// Our search nonce, so stale pongs of earlier searches are ignored
+			B3atZNonce);
+		// Payload echoed by the host
+		FB3atZBeaconPingPayload::Encode(&Packet[FB3atZBeaconHeader::Size], FPlatformTime::Seconds(), PingId);
+
+		bSuccess = B3atZBeacon->SendPacketTo(Packet, sizeof(Packet), HostAddr);
+		if (!bSuccess)
+		{
+			UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("Failed to send ping packet %d"), (int32)ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode());
 		}
 	}
+
+	return bSuccess;
+}
+
+const FInternetAddr* FB3atZSession::GetLastPacketSource() const
+{
+	return B3atZBeacon ? &B3atZBeacon->GetReplyAddr() : NULL;
 }
 
-void FB3atZSession::CreateHostResponsePacket(FNboSerializeToBuffer& Packet, uint64 ClientNonce)
+void FB3atZSession::CreateHostResponsePacket(FNboSerializeToBuffer& Packet, uint64 ClientNonce, uint8 PacketVersion)
 {
 	UE_LOG(LogB3atZOnline, VeryVerbose, TEXT("B3atZBeacon CreateHostResponsePacket Session"));
 
 
-	// Add the supported version
-	Packet << LAN_BEACON_PACKET_VERSION
+	// Add the version the client asked in
+	FB3atZBeaconHeader::Write(Packet,
+		PacketVersion,
 		// Platform information
-		<< (uint8)FPlatformProperties::IsLittleEndian()
+		(uint8)FPlatformProperties::IsLittleEndian(),
 		// Game id to prevent cross game lan packets
-		<< LanGameUniqueId
+		LanGameUniqueId,
 		// Add the packet type
-		<< LAN_SERVER_RESPONSE1 << LAN_SERVER_RESPONSE2
+		LAN_SERVER_RESPONSE1, LAN_SERVER_RESPONSE2,
 		// Append the client nonce as a uint64
-		<< ClientNonce;
+		ClientNonce);
+}
+
+bool FB3atZSession::CreateHostResponseFragments(const uint8* Response, int32 ResponseLength, TArray<TArray<uint8>>& OutFragments)
+{
+	OutFragments.Reset();
+
+	const uint8* Payload = &Response[LAN_BEACON_PACKET_HEADER_SIZE];
+	const int32 PayloadLength = ResponseLength - LAN_BEACON_PACKET_HEADER_SIZE;
+	const int32 FragmentCount = FMath::DivideAndRoundUp(PayloadLength, LAN_BEACON_FRAGMENT_PAYLOAD_SIZE);
+	if (FragmentCount > LAN_BEACON_MAX_FRAGMENTS)
+	{
+		return false;
+	}
+
+	for (int32 FragmentIndex = 0; FragmentIndex < FragmentCount; FragmentIndex++)
+	{
+		const int32 Offset = FragmentIndex * LAN_BEACON_FRAGMENT_PAYLOAD_SIZE;
+		const int32 FragmentLength = FMath::Min(PayloadLength - Offset, LAN_BEACON_FRAGMENT_PAYLOAD_SIZE);
+
+		FNboSerializeToBuffer Fragment(FB3atZBeaconHeader::Size + FB3atZBeaconFragmentHeader::Size + FragmentLength);
+		FB3atZBeaconHeader::Write(Fragment,
+			LAN_BEACON_PACKET_VERSION,
+			// Platform information
+			(uint8)FPlatformProperties::IsLittleEndian(),
+			// Game id to prevent cross game lan packets
+			LanGameUniqueId,
+			// Add the packet type
+			LAN_SERVER_FRAGMENT1, LAN_SERVER_FRAGMENT2,
+			// Response id, filled in per query
+			0);
+		// Where this piece goes
+		FB3atZBeaconFragmentHeader::Write(Fragment, (uint8)FragmentIndex, (uint8)FragmentCount);
+		Fragment.WriteBinary(&Payload[Offset], FragmentLength);
+
+		OutFragments.Add(Fragment.GetBuffer());
+	}
+
+	return true;
+}
+
+uint64 FB3atZSession::MakeResponseId(uint64 ClientNonce)
+{
+	// The low half still lets the client match the fragments to its search
+	return ((uint64)NextResponseId++ << 32) | (ClientNonce & 0xFFFFFFFF);
 }
 
 void FB3atZSession::CreateClientQueryPacket(FNboSerializeToBuffer& Packet, uint64 ClientNonce)
 {
 	// Build the discovery packet
-	Packet << LAN_BEACON_PACKET_VERSION
+	FB3atZBeaconHeader::Write(Packet,
+		LAN_BEACON_PACKET_VERSION,
 		// Platform information
-		<< (uint8)FPlatformProperties::IsLittleEndian()
+		(uint8)FPlatformProperties::IsLittleEndian(),
 		// Game id to prevent cross game lan packets
-		<< LanGameUniqueId
+		LanGameUniqueId,
 		// Identify the packet type
-		<< LAN_SERVER_QUERY1 << LAN_SERVER_QUERY2
+		LAN_SERVER_QUERY1, LAN_SERVER_QUERY2,
 		// Append the nonce as a uint64
-		<< ClientNonce;
+		ClientNonce);
+}
+
+void FB3atZSession::SetHostResponsePacketNonce(uint8* Packet, uint64 ClientNonce)
+{
+	check(Packet);
+	FB3atZBeaconHeader::Set<EB3atZBeaconHeaderField::Nonce>(Packet, ClientNonce);
 }
 
 /**
@@ -582,47 +1118,58 @@ bool FB3atZSession::BroadcastPacketFromSocket(uint8* Packet, int32 Length)
  * @param Packet the packet data to check
  * @param Length the size of the packet buffer
  * @param ClientNonce the client nonce contained within the packet
+ * @param ClientVersion the packet version the client speaks
  *
  * @return true if the header is valid, false otherwise
  */
-bool FB3atZSession::IsValidLanQueryPacket(const uint8* Packet, uint32 Length, uint64& ClientNonce)
+bool FB3atZSession::IsValidLanQueryPacket(const uint8* Packet, uint32 Length, uint64& ClientNonce, uint8& ClientVersion)
 {
 	ClientNonce = 0;
+	ClientVersion = 0;
 	bool bIsValid = false;
-	// Serialize out the data if the packet is the right size
-	if (Length == LAN_BEACON_PACKET_HEADER_SIZE)
+	// Decode the header if the packet is big enough, anything past the header is the search filter
+	if (Length >= FB3atZBeaconHeader::Size)
 	{
-		FNboSerializeFromBuffer PacketReader(Packet,Length);
-		uint8 Version = 0;
-		PacketReader >> Version;
-		// Do the versions match?
-		if (Version == LAN_BEACON_PACKET_VERSION)
-		{
-			uint8 Platform = 255;
-			PacketReader >> Platform;
+		uint8 Version, Platform, Type1, Type2;
+		int32 GameId;
+		uint64 Nonce;
+		FB3atZBeaconHeader::Decode(Packet, Version, Platform, GameId, Type1, Type2, Nonce);
+		// Older clients are answered in their own format
+		bIsValid = Version >= LAN_BEACON_MIN_QUERY_VERSION && Version <= LAN_BEACON_PACKET_VERSION &&
 			// Can we communicate with this platform?
-			if (Platform & LanPacketPlatformMask)
-			{
-				int32 GameId = -1;
-				PacketReader >> GameId;
-				// Is this our game?
-				if (GameId == LanGameUniqueId)
-				{
-					uint8 SQ1 = 0;
-					PacketReader >> SQ1;
-					uint8 SQ2 = 0;
-					PacketReader >> SQ2;
-					// Is this a server query?
-					bIsValid = (SQ1 == LAN_SERVER_QUERY1 && SQ2 == LAN_SERVER_QUERY2);
-					// Read the client nonce as the outvalue
-					PacketReader >> ClientNonce;
-				}
-			}
+			(Platform & LanPacketPlatformMask) &&
+			// Is this our game?
+			GameId == LanGameUniqueId &&
+			// Is this a server query?
+			Type1 == LAN_SERVER_QUERY1 && Type2 == LAN_SERVER_QUERY2;
+		if (bIsValid)
+		{
+			ClientVersion = Version;
+			ClientNonce = Nonce;
 		}
 	}
 	return bIsValid;
 }
 
+bool FB3atZSession::IsValidLanPingPacket(const uint8* Packet, uint32 Length, uint8 PacketType1, uint8 PacketType2, uint64& Nonce)
+{
+	Nonce = 0;
+	bool bIsValid = false;
+	// Decode the header if the packet is the right size
+	if (Length == FB3atZBeaconHeader::Size + FB3atZBeaconPingPayload::Size)
+	{
+		uint8 Version, Platform, Type1, Type2;
+		int32 GameId;
+		FB3atZBeaconHeader::Decode(Packet, Version, Platform, GameId, Type1, Type2, Nonce);
+		// Pings are echoed unchanged, so older clients can be answered as well
+		bIsValid = Version >= LAN_BEACON_MIN_QUERY_VERSION && Version <= LAN_BEACON_PACKET_VERSION &&
+			(Platform & LanPacketPlatformMask) &&
+			GameId == LanGameUniqueId &&
+			Type1 == PacketType1 && Type2 == PacketType2;
+	}
+	return bIsValid;
+}
+
 /**
  * Determines if the packet header is valid or not
  *
@@ -631,42 +1178,50 @@ bool FB3atZSession::IsValidLanQueryPacket(const uint8* Packet, uint32 Length, ui
  *
  * @return true if the header is valid, false otherwise
  */
+bool FB3atZSession::IsValidLanFragmentPacket(const uint8* Packet, uint32 Length, uint64& ResponseId, uint8& FragmentIndex, uint8& FragmentCount)
+{
+	ResponseId = 0;
+	FragmentIndex = 0;
+	FragmentCount = 0;
+	bool bIsValid = false;
+	// Decode the headers if the packet carries any payload
+	if (Length > FB3atZBeaconHeader::Size + FB3atZBeaconFragmentHeader::Size)
+	{
+		uint8 Version, Platform, Type1, Type2;
+		int32 GameId;
+		FB3atZBeaconHeader::Decode(Packet, Version, Platform, GameId, Type1, Type2, ResponseId);
+		FB3atZBeaconFragmentHeader::Decode(&Packet[FB3atZBeaconHeader::Size], FragmentIndex, FragmentCount);
+		bIsValid = Version == LAN_BEACON_PACKET_VERSION &&
+			(Platform & LanPacketPlatformMask) &&
+			GameId == LanGameUniqueId &&
+			Type1 == LAN_SERVER_FRAGMENT1 && Type2 == LAN_SERVER_FRAGMENT2 &&
+			// Only the low half of our nonce travels with the fragments
+			(ResponseId & 0xFFFFFFFF) == (B3atZNonce & 0xFFFFFFFF) &&
+			FragmentCount <= LAN_BEACON_MAX_FRAGMENTS &&
+			FragmentIndex < FragmentCount;
+	}
+	return bIsValid;
+}
+
 bool FB3atZSession::IsValidLanResponsePacket(const uint8* Packet, uint32 Length)
 {
 	bool bIsValid = false;
-	// Serialize out the data if the packet is the right size
-	if (Length > LAN_BEACON_PACKET_HEADER_SIZE)
+	// Decode the header if the packet carries any payload
+	if (Length > FB3atZBeaconHeader::Size)
 	{
-		FNboSerializeFromBuffer PacketReader(Packet,Length);
-		uint8 Version = 0;
-		PacketReader >> Version;
+		uint8 Version, Platform, Type1, Type2;
+		int32 GameId;
+		uint64 Nonce;
+		FB3atZBeaconHeader::Decode(Packet, Version, Platform, GameId, Type1, Type2, Nonce);
 		// Do the versions match?
-		if (Version == LAN_BEACON_PACKET_VERSION)
-		{
-			uint8 Platform = 255;
-			PacketReader >> Platform;
+		bIsValid = Version == LAN_BEACON_PACKET_VERSION &&
 			// Can we communicate with this platform?
-			if (Platform & LanPacketPlatformMask)
-			{
-				int32 GameId = -1;
-				PacketReader >> GameId;
-				// Is this our game?
-				if (GameId == LanGameUniqueId)
-				{
-					uint8 SQ1 = 0;
-					PacketReader >> SQ1;
-					uint8 SQ2 = 0;
-					PacketReader >> SQ2;
-					// Is this a server response?
-					if (SQ1 == LAN_SERVER_RESPONSE1 && SQ2 == LAN_SERVER_RESPONSE2)
-					{
-						uint64 Nonce = 0;
-						PacketReader >> Nonce;
-						bIsValid = (Nonce == B3atZNonce);
-					}
-				}
-			}
-		}
+			(Platform & LanPacketPlatformMask) &&
+			// Is this our game?
+			GameId == LanGameUniqueId &&
+			// Is this a server response to our search?
+			Type1 == LAN_SERVER_RESPONSE1 && Type2 == LAN_SERVER_RESPONSE2 &&
+			Nonce == B3atZNonce;
 	}
 	return bIsValid;
 }
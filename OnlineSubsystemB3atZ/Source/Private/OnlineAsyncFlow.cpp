@@ -0,0 +1,125 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "OnlineAsyncFlow.h"
+#include "OnlineSubsystemB3atZ.h"
+
+FOnlineAsyncFlow::FOnlineAsyncFlow(FOnlineAsyncTaskManager& InTaskManager, FName InLane)
+	: TaskManager(InTaskManager)
+	, Lane(InLane)
+	, CurrentStep(0)
+	, bIsComplete(false)
+	, bWasSuccessful(false)
+{
+}
+
+FOnlineAsyncFlow& FOnlineAsyncFlow::Then(const FStep& Step, EOnlineAsyncResume::Type ResumeOn)
+{
+	FFlowStep& NewStep = Steps[Steps.AddDefaulted()];
+	NewStep.Function = Step;
+	NewStep.ResumeOn = ResumeOn;
+	return *this;
+}
+
+FOnlineAsyncFlow& FOnlineAsyncFlow::OnComplete(const FOnComplete& InCompleteCallback)
+{
+	CompleteCallback = InCompleteCallback;
+	return *this;
+}
+
+FOnlineAsyncTaskHandle FOnlineAsyncFlow::Start()
+{
+	return TaskManager.AddToInQueue(this);
+}
+
+double FOnlineAsyncFlow::GetNextTickTime() const
+{
+	// Waiting on the game thread, which wakes the online thread once the step ran
+	return PendingCall.IsValid() && !PendingCall->bIsDone ? MAX_dbl : 0.0;
+}
+
+void FOnlineAsyncFlow::PostToGameThread(const FFlowStep& Step)
+{
+	PendingCall = MakeShareable(new FGameThreadCall());
+	PendingCall->Function = Step.Function;
+
+	TSharedPtr<FGameThreadCall, ESPMode::ThreadSafe> Call = PendingCall;
+	FOnlineAsyncTaskManager* Manager = &TaskManager;
+	TaskManager.AddGenericToOutQueue([Call, Manager]()
+	{
+		if (!Call->bIsAbandoned)
+		{
+			FPlatformAtomics::InterlockedExchange(&Call->Result, Call->Function());
+		}
+		FPlatformAtomics::InterlockedExchange(&Call->bIsDone, 1);
+		Manager->WakeUp();
+	});
+}
+
+void FOnlineAsyncFlow::Tick()
+{
+	while (CurrentStep < Steps.Num())
+	{
+		const FFlowStep& Step = Steps[CurrentStep];
+
+		EOnlineAsyncStepResult::Type Result = EOnlineAsyncStepResult::Pending;
+		if (Step.ResumeOn == EOnlineAsyncResume::GameThread)
+		{
+			if (!PendingCall.IsValid())
+			{
+				PostToGameThread(Step);
+				return;
+			}
+			if (!PendingCall->bIsDone)
+			{
+				return;
+			}
+			Result = (EOnlineAsyncStepResult::Type)PendingCall->Result;
+			PendingCall.Reset();
+		}
+		else
+		{
+			Result = Step.Function();
+		}
+
+		if (Result == EOnlineAsyncStepResult::Pending)
+		{
+			// Resumed on the next pass, a game thread step is posted again
+			return;
+		}
+		if (Result == EOnlineAsyncStepResult::Failed)
+		{
+			UE_LOG(LogB3atZOnline, Log, TEXT("%s failed"), *ToString());
+			bIsComplete = true;
+			return;
+		}
+
+		CurrentStep++;
+	}
+
+	bWasSuccessful = true;
+	bIsComplete = true;
+}
+
+void FOnlineAsyncFlow::Abandon()
+{
+	if (PendingCall.IsValid())
+	{
+		// The out queue item outlives the flow, it just skips the step now
+		FPlatformAtomics::InterlockedExchange(&PendingCall->bIsAbandoned, 1);
+		PendingCall.Reset();
+	}
+}
+
+FString FOnlineAsyncFlow::ToString() const
+{
+	return FString::Printf(TEXT("FOnlineAsyncFlow step %d of %d"), CurrentStep + 1, Steps.Num());
+}
+
+void FOnlineAsyncFlow::TriggerDelegates()
+{
+	if (CompleteCallback)
+	{
+		CompleteCallback(bWasSuccessful);
+	}
+}
@@ -7,9 +7,87 @@
 #include "HAL/Event.h"
 #include "Misc/ConfigCacheIni.h"
 #include "HAL/IConsoleManager.h"
+#include "Containers/LockFreeFixedSizeAllocator.h"
+#include "OnlineAsyncTaskStats.h"
+#include "OnlineAsyncTaskRecorder.h"
+#include "OnlineAsyncWorkerPool.h"
 #include "OnlineSubsystemB3atZ.h"
 
 int32 FOnlineAsyncTaskManager::InvocationCount = 0;
+volatile int32 FOnlineAsyncTaskManager::NextTaskId = 0;
+
+/** Block sizes of the async item pools, anything larger is allocated from the heap */
+#define ASYNC_ITEM_POOL_SMALL 64
+#define ASYNC_ITEM_POOL_MEDIUM 128
+#define ASYNC_ITEM_POOL_LARGE 256
+
+namespace OnlineAsyncItemPool
+{
+	/** Freed blocks are kept for reuse, so the pools stop allocating once they cover the peak item count */
+	static TLockFreeFixedSizeAllocator<ASYNC_ITEM_POOL_SMALL, PLATFORM_CACHE_LINE_SIZE> SmallItems;
+	static TLockFreeFixedSizeAllocator<ASYNC_ITEM_POOL_MEDIUM, PLATFORM_CACHE_LINE_SIZE> MediumItems;
+	static TLockFreeFixedSizeAllocator<ASYNC_ITEM_POOL_LARGE, PLATFORM_CACHE_LINE_SIZE> LargeItems;
+}
+
+FName FOnlineAsyncItem::GetStatName() const
+{
+	FString TypeName = ToString();
+	int32 SpaceIndex = INDEX_NONE;
+	if (TypeName.FindChar(TEXT(' '), SpaceIndex))
+	{
+		TypeName = TypeName.Left(SpaceIndex);
+	}
+	return FName(*TypeName);
+}
+
+void* FOnlineAsyncItem::operator new(size_t Size)
+{
+	INC_DWORD_STAT(STAT_B3atZOnline_AsyncItemsLive);
+	if (Size <= ASYNC_ITEM_POOL_SMALL)
+	{
+		INC_DWORD_STAT(STAT_B3atZOnline_AsyncItemPoolAllocs);
+		return OnlineAsyncItemPool::SmallItems.Allocate();
+	}
+	if (Size <= ASYNC_ITEM_POOL_MEDIUM)
+	{
+		INC_DWORD_STAT(STAT_B3atZOnline_AsyncItemPoolAllocs);
+		return OnlineAsyncItemPool::MediumItems.Allocate();
+	}
+	if (Size <= ASYNC_ITEM_POOL_LARGE)
+	{
+		INC_DWORD_STAT(STAT_B3atZOnline_AsyncItemPoolAllocs);
+		return OnlineAsyncItemPool::LargeItems.Allocate();
+	}
+	INC_DWORD_STAT(STAT_B3atZOnline_AsyncItemHeapAllocs);
+	return FMemory::Malloc(Size);
+}
+
+void FOnlineAsyncItem::operator delete(void* Ptr, size_t Size)
+{
+	if (Ptr == nullptr)
+	{
+		return;
+	}
+
+	// The virtual destructor makes Size the size of the most derived type, the same one operator new saw
+	DEC_DWORD_STAT(STAT_B3atZOnline_AsyncItemsLive);
+	if (Size <= ASYNC_ITEM_POOL_SMALL)
+	{
+		OnlineAsyncItemPool::SmallItems.Free(Ptr);
+	}
+	else if (Size <= ASYNC_ITEM_POOL_MEDIUM)
+	{
+		OnlineAsyncItemPool::MediumItems.Free(Ptr);
+	}
+	else if (Size <= ASYNC_ITEM_POOL_LARGE)
+	{
+		OnlineAsyncItemPool::LargeItems.Free(Ptr);
+	}
+	else
+	{
+		FMemory::Free(Ptr);
+	}
+}
 
 #if !UE_BUILD_SHIPPING
 namespace OSSConsoleVariables
@@ -27,13 +105,43 @@ namespace OSSConsoleVariables
 /** The default value for the polling interval when not set by config */
 #define POLLING_INTERVAL_MS 50
 
+/** The default time GameTick may spend finalizing completed items when not set by config */
+#define GAME_TICK_BUDGET_MS 2.0f
+
 FOnlineAsyncTaskManager::FOnlineAsyncTaskManager() :
-	ActiveTask(nullptr),
+	NumSerialTasks(0),
+	WorkerPool(nullptr),
+	NumPendingOut(0),
+	GameTickBudget(GAME_TICK_BUDGET_MS / 1000.0),
 	WorkEvent(nullptr),
 	PollingInterval(POLLING_INTERVAL_MS),
 	bRequestingExit(0),
+	bIsDeterministic(false),
+	VirtualTime(0.0),
 	OnlineThreadId(0)
 {
+	for (int32 Priority = 0; Priority < EOnlineAsyncPriority::Count; Priority++)
+	{
+		PendingOutHead[Priority] = nullptr;
+		PendingOutTail[Priority] = nullptr;
+	}
+}
+
+FOnlineAsyncTaskManager::~FOnlineAsyncTaskManager()
+{
+	// Only torn down once the online thread joined, AddToParallelTasks reads the pool from any thread until then
+	if (WorkerPool != nullptr)
+	{
+		delete WorkerPool;
+		WorkerPool = nullptr;
+
+		if (IsInGameThread())
+		{
+			// Give the tasks the workers didn't get to a chance to report their cancellation
+			GameTickBudget = 0.0;
+			GameTick();
+		}
+	}
 }
 
 bool FOnlineAsyncTaskManager::Init(void)
@@ -45,6 +153,17 @@ bool FOnlineAsyncTaskManager::Init(void)
 	{
 		PollingInterval = (uint32)PollingConfig;
 	}
+	float BudgetConfig = GAME_TICK_BUDGET_MS;
+	if (GConfig->GetFloat(TEXT("OnlineSubsystemB3atZ"), TEXT("GameTickBudgetInMs"), BudgetConfig, GEngineIni))
+	{
+		GameTickBudget = FMath::Max(BudgetConfig, 0.0f) / 1000.0;
+	}
+	int32 WorkerPoolSize = 0;
+	GConfig->GetInt(TEXT("OnlineSubsystemB3atZ"), TEXT("AsyncWorkerPoolSize"), WorkerPoolSize, GEngineIni);
+	if (WorkerPoolSize > 0 && FPlatformProcess::SupportsMultithreading())
+	{
+		WorkerPool = new FOnlineAsyncWorkerPool(*this, FMath::Min(WorkerPoolSize, FPlatformMisc::NumberOfCoresIncludingHyperthreads()));
+	}
 
 	return WorkEvent != nullptr;
 }
@@ -58,90 +177,20 @@ uint32 FOnlineAsyncTaskManager::Run(void)
 
 	do 
 	{
-		FOnlineAsyncTask* Task = NULL;
-
-		// Wait for a trigger event to start work
-		WorkEvent->Wait(PollingInterval);
+		// Wait for new work or the earliest deadline, whichever comes first
+		WorkEvent->Wait(GetWaitTime());
 		if (!bRequestingExit)
 		{
 			SCOPE_CYCLE_COUNTER(STAT_B3atZOnline_Async);
-			
-			double TimeElapsed = 0;
 
 			// Chance for services to do work
 			OnlineTick();
 
-			TArray<FOnlineAsyncTask*> CopyParallelTasks;
-
-			// Grab a copy of the parallel list
-			{
-				FScopeLock LockParallelTasks(&ParallelTasksLock);
-
-				CopyParallelTasks = ParallelTasks;
-			}
-
 			// Tick all the parallel tasks
-			for ( auto it = CopyParallelTasks.CreateIterator(); it; ++it )
-			{
-				Task = *it;
-
-				Task->Tick();
-
-				if (Task->IsDone())
-				{
-					if (Task->WasSuccessful())
-					{
-						UE_LOG(LogB3atZOnline, Verbose, TEXT("Async task '%s' succeeded in %f seconds (Parallel)"),
-							*Task->ToString(),
-							Task->GetElapsedTime());
-					}
-					else
-					{
-						UE_LOG(LogB3atZOnline, Log, TEXT("Async task '%s' failed in %f seconds (Parallel)"),
-							*Task->ToString(),
-							Task->GetElapsedTime());
-					}
-
-					// Task is done, remove from the incoming queue and add to the outgoing queue
-					RemoveFromParallelTasks( Task );
-
-					AddToOutQueue( Task );
-				}
-			}
+			TickParallelTasks();
 
 			// Now process the serial "In" queue
-			{
-				FScopeLock LockActiveTask(&ActiveTaskLock);
-				Task = ActiveTask;
-			}
-			if (Task)
-			{
-				Task->Tick();
-	
-				if (Task->IsDone())
-				{
-					if (Task->WasSuccessful())
-					{
-						UE_LOG(LogB3atZOnline, Verbose, TEXT("Async task '%s' succeeded in %f seconds"),
-							*Task->ToString(),
-							Task->GetElapsedTime());
-					}
-					else
-					{
-						UE_LOG(LogB3atZOnline, Warning, TEXT("Async task '%s' failed in %f seconds"),
-							*Task->ToString(),
-							Task->GetElapsedTime());
-					}
-						
-					// Task is done, add to the outgoing queue
-					AddToOutQueue(Task);
-					
-					{
-						FScopeLock LockActiveTask(&ActiveTaskLock);
-						ActiveTask = nullptr;
-					}
-				}
-			}
+			TickSerialLanes();
 		}
 	} 
 	while (!bRequestingExit);
@@ -164,178 +213,615 @@ void FOnlineAsyncTaskManager::Exit(void)
 	InvocationCount--;
 }
 
-void FOnlineAsyncTaskManager::AddToInQueue(FOnlineAsyncTask* NewTask)
+FOnlineAsyncTaskHandle FOnlineAsyncTaskManager::RegisterTask(FOnlineAsyncTask* Task)
 {
-	FScopeLock Lock(&InQueueLock);
-	InQueue.Add(NewTask);
+	uint32 TaskId = 0;
+	do
+	{
+		TaskId = (uint32)FPlatformAtomics::InterlockedIncrement(&NextTaskId);
+	}
+	while (TaskId == 0);
+	Task->TaskId = TaskId;
+	Task->bIsDeterministic = bIsDeterministic;
+
+	const double Now = GetClockTime();
+	Task->Deadline = Task->Timeout > 0.0 ? Now + Task->Timeout : 0.0;
+
+	FOnlineAsyncTaskRecorder& Recorder = FOnlineAsyncTaskRecorder::Get();
+	if (Recorder.IsRecording())
+	{
+		Recorder.RecordEnqueue(TaskId, Now, Task->GetStatName(), Task->GetSerializationLane(), Task->bIsParallel, Task->GetPriority());
+	}
+
+	FScopeLock ScopeLock(&LiveTasksLock);
+	LiveTasks.Add(TaskId, Task);
+	return FOnlineAsyncTaskHandle(TaskId);
 }
 
-void FOnlineAsyncTaskManager::AddToOutQueue(FOnlineAsyncItem* CompletedItem)
+void FOnlineAsyncTaskManager::SetDeterministic(double StartTime)
 {
-	FScopeLock Lock(&OutQueueLock);
-	OutQueue.Add(CompletedItem);
+	check(OnlineThreadId == 0 && NumSerialTasks == 0);
+	bIsDeterministic = true;
+	VirtualTime = StartTime;
+	// Step runs the online passes on this thread, so OnlineTick implementations checking for the online thread accept it
+	FPlatformAtomics::InterlockedExchange((volatile int32*)&OnlineThreadId, FPlatformTLS::GetCurrentThreadId());
 }
 
-void FOnlineAsyncTaskManager::AddToParallelTasks(FOnlineAsyncTask* NewTask)
+void FOnlineAsyncTaskManager::Step(double DeltaSeconds)
 {
-	NewTask->Initialize();
+	check(bIsDeterministic);
+	VirtualTime += FMath::Max(DeltaSeconds, 0.0);
+	Tick();
+	GameTick();
+}
 
-	FScopeLock LockParallelTasks(&ParallelTasksLock);
+FOnlineAsyncTaskHandle FOnlineAsyncTaskManager::AddToInQueue(FOnlineAsyncTask* NewTask)
+{
+	const FOnlineAsyncTaskHandle Handle = RegisterTask(NewTask);
+	FPlatformAtomics::InterlockedIncrement(&NumSerialTasks);
+	InQueue.Push(NewTask);
+	WakeUp();
+	return Handle;
+}
 
-	ParallelTasks.Add( NewTask );
+bool FOnlineAsyncTaskManager::Cancel(FOnlineAsyncTaskHandle Handle)
+{
+	{
+		FScopeLock ScopeLock(&LiveTasksLock);
+		FOnlineAsyncTask** Task = LiveTasks.Find(Handle.Id);
+		if (Task == nullptr)
+		{
+			return false;
+		}
+		FPlatformAtomics::InterlockedExchange(&(*Task)->bCancelRequested, 1);
+		if (!(*Task)->bIsParallel)
+		{
+			// Parallel tasks are all visited every pass anyway, serial ones may be waiting deep in a lane
+			CancelledTaskIds.Add(Handle.Id);
+		}
+	}
+	WakeUp();
+	return true;
 }
 
-void FOnlineAsyncTaskManager::RemoveFromParallelTasks(FOnlineAsyncTask* OldTask)
+void FOnlineAsyncTaskManager::CompleteTask(FOnlineAsyncTask* Task)
 {
-	FScopeLock LockParallelTasks(&ParallelTasksLock);
+	if (Task->TaskId != 0)
+	{
+		FScopeLock ScopeLock(&LiveTasksLock);
+		LiveTasks.Remove(Task->TaskId);
+	}
+	if (!Task->bIsParallel)
+	{
+		FPlatformAtomics::InterlockedDecrement(&NumSerialTasks);
+		Task->OutLane = Task->GetSerializationLane();
+		Task->bHasOutLane = true;
+	}
 
-	ParallelTasks.Remove( OldTask );
+	FOnlineAsyncTaskRecorder& Recorder = FOnlineAsyncTaskRecorder::Get();
+	if (Recorder.IsRecording())
+	{
+		Recorder.RecordComplete(Task, Task->TaskId, GetClockTime(), !Task->bWasCancelled && !Task->bHasTimedOut && Task->WasSuccessful());
+	}
+	AddToOutQueue(Task);
 }
 
-void FOnlineAsyncTaskManager::GameTick()
+bool FOnlineAsyncTaskManager::AbandonIfExpired(FOnlineAsyncTask* Task, double Now)
 {
-	// assert if not game thread
-	check(IsInGameThread());
+	if (Task->bCancelRequested)
+	{
+		Task->bWasCancelled = true;
+		UE_LOG(LogB3atZOnline, Log, TEXT("Async task '%s' cancelled after %f seconds"),
+			*Task->ToString(),
+			Task->GetElapsedTime());
+	}
+	else if (Task->Deadline > 0.0 && Now >= Task->Deadline)
+	{
+		Task->bHasTimedOut = true;
+		UE_LOG(LogB3atZOnline, Warning, TEXT("Async task '%s' timed out after %f seconds"),
+			*Task->ToString(),
+			Task->GetElapsedTime());
+	}
+	else
+	{
+		return false;
+	}
 
-	FOnlineAsyncItem* Item = nullptr;
-	int32 CurrentQueueSize = 0;
+	Task->Abandon();
+	return true;
+}
 
-#if !UE_BUILD_SHIPPING
-	const float TimeToWait = OSSConsoleVariables::CVarDelayAsyncTaskOutQueue.GetValueOnGameThread();
-#endif
+void FOnlineAsyncTaskManager::CompleteCancelledTask(FOnlineAsyncTask* Task)
+{
+	FPlatformAtomics::InterlockedExchange(&Task->bCancelRequested, 1);
+	AbandonIfExpired(Task, GetClockTime());
+	CompleteTask(Task);
+}
 
-	do 
+void FOnlineAsyncTaskManager::RemoveCancelledTasks()
+{
+	TArray<uint32> TaskIds;
 	{
-		Item = nullptr;
-		// Grab a completed task from the queue
+		FScopeLock ScopeLock(&LiveTasksLock);
+		if (CancelledTaskIds.Num() == 0)
 		{
-			FScopeLock LockOutQueue(&OutQueueLock);
-			CurrentQueueSize = OutQueue.Num();
-			if (CurrentQueueSize > 0)
-			{
-				Item = OutQueue[0];
+			return;
+		}
+		Swap(TaskIds, CancelledTaskIds);
+	}
 
-#if !UE_BUILD_SHIPPING
-				if (Item && Item->GetElapsedTime() >= TimeToWait)
-				{
-					OutQueue.RemoveAt(0);
-				}
-				else
-				{
-					Item = nullptr;
-				}
-#else
-				OutQueue.RemoveAt(0);	
-#endif
-			}
+	for (uint32 TaskId : TaskIds)
+	{
+		FOnlineAsyncTask* Task = nullptr;
+		{
+			FScopeLock ScopeLock(&LiveTasksLock);
+			FOnlineAsyncTask** LiveTask = LiveTasks.Find(TaskId);
+			Task = LiveTask != nullptr ? *LiveTask : nullptr;
 		}
+		if (Task == nullptr || !Task->bIsPendingInLane)
+		{
+			// Already finished, or still queued or active and abandoned once it is promoted
+			continue;
+		}
+		FSerialLane* Lane = SerialLanes.Find(Task->GetSerializationLane());
+		check(Lane != nullptr);
+
+		UnlinkPendingTask(*Lane, Task);
+		AbandonIfExpired(Task, GetClockTime());
+		CompleteTask(Task);
+	}
+}
 
-		if (Item)
+void FOnlineAsyncTaskManager::UnlinkPendingTask(FSerialLane& Lane, FOnlineAsyncTask* Task)
+{
+	FOnlineAsyncTask* Next = TOnlineAsyncQueue<FOnlineAsyncTask>::GetNext(Task);
+	if (Task->PrevInLane != nullptr)
+	{
+		TOnlineAsyncQueue<FOnlineAsyncTask>::SetNext(Task->PrevInLane, Next);
+	}
+	else
+	{
+		Lane.PendingHead = Next;
+	}
+	if (Next != nullptr)
+	{
+		Next->PrevInLane = Task->PrevInLane;
+	}
+	else
+	{
+		Lane.PendingTail = Task->PrevInLane;
+	}
+	TOnlineAsyncQueue<FOnlineAsyncTask>::SetNext(Task, nullptr);
+	Task->PrevInLane = nullptr;
+	Task->bIsPendingInLane = false;
+}
+
+void FOnlineAsyncTaskManager::RemoveExpiredTasks(FSerialLane& Lane, double Now)
+{
+	Lane.PendingDeadline = MAX_dbl;
+	FOnlineAsyncTask* Task = Lane.PendingHead;
+	while (Task != nullptr)
+	{
+		FOnlineAsyncTask* Next = TOnlineAsyncQueue<FOnlineAsyncTask>::GetNext(Task);
+		if (Task->Deadline > 0.0)
 		{
-#if !UE_BUILD_SHIPPING
-			if (TimeToWait > 0.0f)
+			if (Now >= Task->Deadline)
 			{
-				UE_LOG(LogB3atZOnline, Verbose, TEXT("Async task '%s' finalizing after %f seconds"),
-					*Item->ToString(),
-					Item->GetElapsedTime());
+				UnlinkPendingTask(Lane, Task);
+				AbandonIfExpired(Task, Now);
+				CompleteTask(Task);
+			}
+			else
+			{
+				Lane.PendingDeadline = FMath::Min(Lane.PendingDeadline, Task->Deadline);
 			}
-#endif
-
-			// Finish work and trigger delegates
-			Item->Finalize();
-			Item->TriggerDelegates();
-			delete Item;
-			Item = nullptr;
 		}
+		Task = Next;
 	}
-	while (Item != NULL);
+}
 
-	int32 QueueSize = 0;
-	bool bHasActiveTask = false;
+void FOnlineAsyncTaskManager::WakeUp()
+{
+	if (WorkEvent != nullptr)
 	{
+		WorkEvent->Trigger();
+	}
+}
+
+/** Folds a deadline into the earliest one, 0 meaning a poll after the polling interval */
+static void MergeDeadline(double& EarliestDeadline, double Deadline, double PollDeadline)
+{
+	EarliestDeadline = FMath::Min(EarliestDeadline, Deadline > 0.0 ? Deadline : PollDeadline);
+}
+
+uint32 FOnlineAsyncTaskManager::GetWaitTime()
+{
+	const double Now = FPlatformTime::Seconds();
+	const double PollDeadline = Now + PollingInterval / 1000.0;
+	double EarliestDeadline = MAX_dbl;
+
+	MergeDeadline(EarliestDeadline, GetNextOnlineTickTime(), PollDeadline);
+	for (const TPair<FName, FSerialLane>& Lane : SerialLanes)
+	{
+		if (Lane.Value.ActiveTask != nullptr)
 		{
-			FScopeLock LockInQueue(&InQueueLock);
-			QueueSize = InQueue.Num();
+			MergeDeadline(EarliestDeadline, Lane.Value.ActiveTask->GetNextTickTime(), PollDeadline);
+			if (Lane.Value.ActiveTask->Deadline > 0.0)
+			{
+				EarliestDeadline = FMath::Min(EarliestDeadline, Lane.Value.ActiveTask->Deadline);
+			}
 		}
+		EarliestDeadline = FMath::Min(EarliestDeadline, Lane.Value.PendingDeadline);
+	}
+	{
+		FScopeLock LockParallelTasks(&ParallelTasksLock);
+		for (const FOnlineAsyncTask* Task : ParallelTasks)
 		{
-			FScopeLock LockActiveTask(&ActiveTaskLock);
-			if (ActiveTask != nullptr)
+			MergeDeadline(EarliestDeadline, Task->GetNextTickTime(), PollDeadline);
+			if (Task->Deadline > 0.0)
 			{
-				++QueueSize;
-				bHasActiveTask = true;
+				EarliestDeadline = FMath::Min(EarliestDeadline, Task->Deadline);
 			}
 		}
+	}
+
+	if (EarliestDeadline == MAX_dbl)
+	{
+		// Nothing to do until something is queued
+		return MAX_uint32;
+	}
+	return (uint32)FMath::CeilToInt((float)(FMath::Max(EarliestDeadline - Now, 0.0) * 1000.0));
+}
+
+void FOnlineAsyncTaskManager::AddToOutQueue(FOnlineAsyncItem* CompletedItem)
+{
+	CompletedItem->CompletedTime = FPlatformTime::Seconds();
+	OutQueue.Push(CompletedItem);
+}
+
+FOnlineAsyncTaskHandle FOnlineAsyncTaskManager::AddToParallelTasks(FOnlineAsyncTask* NewTask)
+{
+	NewTask->bIsParallel = true;
+	const FOnlineAsyncTaskHandle Handle = RegisterTask(NewTask);
+	NewTask->ActivatedTime = FPlatformTime::Seconds();
+	NewTask->Initialize();
 
-		if (!bHasActiveTask && QueueSize > 0)
+	FOnlineAsyncTaskRecorder& Recorder = FOnlineAsyncTaskRecorder::Get();
+	if (Recorder.IsRecording())
+	{
+		Recorder.RecordActivate(Handle.Id, GetClockTime());
+	}
+
+	if (WorkerPool != nullptr && NewTask->IsCpuBound())
+	{
+		WorkerPool->AddTask(NewTask);
+		return Handle;
+	}
+
+	{
+		FScopeLock LockParallelTasks(&ParallelTasksLock);
+
+		NewTask->ParallelIndex = ParallelTasks.Add( NewTask );
+	}
+	WakeUp();
+	return Handle;
+}
+
+void FOnlineAsyncTaskManager::TickParallelTasks()
+{
+	// Grab a copy of the parallel list
+	{
+		FScopeLock LockParallelTasks(&ParallelTasksLock);
+
+		ParallelTasksSnapshot.Reset();
+		ParallelTasksSnapshot.Append(ParallelTasks);
+	}
+
+	const double Now = GetClockTime();
+	for (FOnlineAsyncTask* Task : ParallelTasksSnapshot)
+	{
+		if (!AbandonIfExpired(Task, Now))
 		{
-			// Grab the current task from the queue
-			FOnlineAsyncTask* Task = nullptr;
+			Task->Tick();
+
+			if (!Task->IsDone())
 			{
-				FScopeLock LockInQueue(&InQueueLock);
-				Task = InQueue[0];
-				InQueue.RemoveAt(0);
+				continue;
+			}
+
+			if (Task->WasSuccessful())
+			{
+				UE_LOG(LogB3atZOnline, Verbose, TEXT("Async task '%s' succeeded in %f seconds (Parallel)"),
+					*Task->ToString(),
+					Task->GetElapsedTime());
 			}
+			else
 			{
-				FScopeLock LockActiveTask(&ActiveTaskLock);
-				ActiveTask = Task;
-				ActiveTask->Initialize();
+				UE_LOG(LogB3atZOnline, Log, TEXT("Async task '%s' failed in %f seconds (Parallel)"),
+					*Task->ToString(),
+					Task->GetElapsedTime());
 			}
-			WorkEvent->Trigger();
 		}
-	}
 
-	SET_DWORD_STAT(STAT_B3atZOnline_AsyncTasks, QueueSize);
+		// Task is done, remove from the incoming queue and add to the outgoing queue
+		RemoveFromParallelTasks(Task);
+		CompleteTask(Task);
+	}
 }
 
-void FOnlineAsyncTaskManager::Tick()
+void FOnlineAsyncTaskManager::RemoveFromParallelTasks(FOnlineAsyncTask* OldTask)
 {
-	// Tick Online services ( possibly callbacks ). 
-	OnlineTick();
+	FScopeLock LockParallelTasks(&ParallelTasksLock);
 
+	const int32 Index = OldTask->ParallelIndex;
+	if (ParallelTasks.IsValidIndex(Index) && ParallelTasks[Index] == OldTask)
 	{
-		// Tick all the parallel tasks - Tick unrelated tasks together. 
+		// The last task takes the freed spot
+		ParallelTasks.RemoveAtSwap(Index, 1, false);
+		if (Index < ParallelTasks.Num())
+		{
+			ParallelTasks[Index]->ParallelIndex = Index;
+		}
+	}
+	OldTask->ParallelIndex = INDEX_NONE;
+}
 
-		// Create a copy of existing tasks. 
-		TArray<FOnlineAsyncTask*> CopyParallelTasks = ParallelTasks;
+void FOnlineAsyncTaskManager::TickSerialLanes()
+{
+	// Append new tasks to their lanes in queue order
+	FOnlineAsyncTask* BatchTail = nullptr;
+	int32 BatchNum = 0;
+	FOnlineAsyncTask* Task = InQueue.PopAll(BatchTail, BatchNum);
+	while (Task != nullptr)
+	{
+		FOnlineAsyncTask* Next = TOnlineAsyncQueue<FOnlineAsyncTask>::GetNext(Task);
+		TOnlineAsyncQueue<FOnlineAsyncTask>::SetNext(Task, nullptr);
 
-		// parallel Q.
-		FOnlineAsyncTask* Task = NULL;
+		FSerialLane& Lane = SerialLanes.FindOrAdd(Task->GetSerializationLane());
+		Task->PrevInLane = Lane.PendingTail;
+		Task->bIsPendingInLane = true;
+		if (Lane.PendingTail != nullptr)
+		{
+			TOnlineAsyncQueue<FOnlineAsyncTask>::SetNext(Lane.PendingTail, Task);
+		}
+		else
+		{
+			Lane.PendingHead = Task;
+		}
+		Lane.PendingTail = Task;
+		if (Task->Deadline > 0.0)
+		{
+			Lane.PendingDeadline = FMath::Min(Lane.PendingDeadline, Task->Deadline);
+		}
 
-		// Iterate. 
-		for (auto it = CopyParallelTasks.CreateIterator(); it; ++it)
+		Task = Next;
+	}
+
+	RemoveCancelledTasks();
+
+	FOnlineAsyncTaskRecorder& Recorder = FOnlineAsyncTaskRecorder::Get();
+
+	for (auto It = SerialLanes.CreateIterator(); It; ++It)
+	{
+		FSerialLane& Lane = It.Value();
+		if (Lane.PendingDeadline <= GetClockTime())
 		{
-			Task = *it;
-			Task->Tick();
+			// Queued tasks keep their deadline while they wait for the lane
+			RemoveExpiredTasks(Lane, GetClockTime());
+		}
+		for (;;)
+		{
+			if (Lane.ActiveTask == nullptr)
+			{
+				// Promote the next task of the lane without waiting for the game thread
+				Lane.ActiveTask = Lane.PendingHead;
+				if (Lane.ActiveTask == nullptr)
+				{
+					break;
+				}
+				Lane.PendingHead = TOnlineAsyncQueue<FOnlineAsyncTask>::GetNext(Lane.ActiveTask);
+				if (Lane.PendingHead == nullptr)
+				{
+					Lane.PendingTail = nullptr;
+					Lane.PendingDeadline = MAX_dbl;
+				}
+				else
+				{
+					Lane.PendingHead->PrevInLane = nullptr;
+				}
+				Lane.ActiveTask->bIsPendingInLane = false;
+				Lane.ActiveTask->ActivatedTime = FPlatformTime::Seconds();
+				if (Recorder.IsRecording())
+				{
+					Recorder.RecordActivate(Lane.ActiveTask->TaskId, GetClockTime());
+				}
+				if (!Lane.ActiveTask->bCancelRequested)
+				{
+					Lane.ActiveTask->Initialize();
+				}
+			}
 
-			if (Task->IsDone())
+			Task = Lane.ActiveTask;
+			// A stuck task gives up the lane once cancelled or past its deadline
+			if (!AbandonIfExpired(Task, GetClockTime()))
 			{
-				UE_LOG(LogB3atZOnline, Log, TEXT("Async parallel Task '%s' completed in %f seconds with %d (Parallel)"),
-					*Task->ToString(),
-					Task->GetElapsedTime(),
-					Task->WasSuccessful());
+				Task->Tick();
+				if (!Task->IsDone())
+				{
+					break;
+				}
 
-				// Task is done, fixup the original parallel task queue. 
-				RemoveFromParallelTasks(Task);
-				AddToOutQueue(Task);
+				if (Task->WasSuccessful())
+				{
+					UE_LOG(LogB3atZOnline, Verbose, TEXT("Async task '%s' succeeded in %f seconds"),
+						*Task->ToString(),
+						Task->GetElapsedTime());
+				}
+				else
+				{
+					UE_LOG(LogB3atZOnline, Warning, TEXT("Async task '%s' failed in %f seconds"),
+						*Task->ToString(),
+						Task->GetElapsedTime());
+				}
 			}
+
+			// Task is done, add to the outgoing queue
+			Lane.ActiveTask = nullptr;
+			CompleteTask(Task);
+		}
+
+		if (Lane.ActiveTask == nullptr && It.Key() != NAME_None)
+		{
+			// Per user and per request lanes come and go, don't let them pile up
+			It.RemoveCurrent();
 		}
 	}
+}
 
-	// Serial Q.
-	if (ActiveTask == nullptr)
-		return;
+void FOnlineAsyncTaskManager::GameTick()
+{
+	// assert if not game thread
+	check(IsInGameThread());
+
+	SCOPE_CYCLE_COUNTER(STAT_B3atZOnline_AsyncDispatch);
+
+	// Take everything completed since the last tick in one go and sort it by priority
+	{
+		FOnlineAsyncItem* BatchTail = nullptr;
+		int32 BatchNum = 0;
+		FOnlineAsyncItem* Item = OutQueue.PopAll(BatchTail, BatchNum);
+		NumPendingOut += BatchNum;
+		while (Item != nullptr)
+		{
+			FOnlineAsyncItem* Next = TOnlineAsyncQueue<FOnlineAsyncItem>::GetNext(Item);
+			TOnlineAsyncQueue<FOnlineAsyncItem>::SetNext(Item, nullptr);
+
+			int32 Priority = FMath::Clamp<int32>(Item->GetPriority(), 0, EOnlineAsyncPriority::Count - 1);
+			if (Item->bHasOutLane)
+			{
+				// Never ahead of an earlier item of the same lane, so a lane finalizes in the order it ran
+				FPendingOutLane& Lane = PendingOutLanes.FindOrAdd(Item->OutLane);
+				if (Lane.NumItems > 0)
+				{
+					Priority = FMath::Max(Priority, Lane.Priority);
+				}
+				Lane.Priority = Priority;
+				Lane.NumItems++;
+			}
+			if (PendingOutTail[Priority] != nullptr)
+			{
+				TOnlineAsyncQueue<FOnlineAsyncItem>::SetNext(PendingOutTail[Priority], Item);
+			}
+			else
+			{
+				PendingOutHead[Priority] = Item;
+			}
+			PendingOutTail[Priority] = Item;
 
-	ActiveTask->Tick();
+			Item = Next;
+		}
+	}
 
-	if (ActiveTask->IsDone())
+#if !UE_BUILD_SHIPPING
+	const float TimeToWait = OSSConsoleVariables::CVarDelayAsyncTaskOutQueue.GetValueOnGameThread();
+#endif
+
+	const double StartTime = FPlatformTime::Seconds();
+	double ElapsedTime = 0.0;
+	bool bIsOverBudget = false;
+	int32 NumDispatched = 0;
+	const bool bRecordStats = FOnlineAsyncTaskStats::IsEnabled();
+	FOnlineAsyncTaskRecorder& Recorder = FOnlineAsyncTaskRecorder::Get();
+	for (int32 Priority = 0; Priority < EOnlineAsyncPriority::Count; Priority++)
 	{
-		UE_LOG(LogB3atZOnline, Log, TEXT("Async serial task '%s' completed in %f seconds with %d"),
-			*ActiveTask->ToString(),
-			ActiveTask->GetElapsedTime(),
-			ActiveTask->WasSuccessful());
+		while (PendingOutHead[Priority] != nullptr)
+		{
+			FOnlineAsyncItem* Item = PendingOutHead[Priority];
+
+			// Always make progress, but leave the rest for the next frame once the budget is used up
+			if (bIsOverBudget)
+			{
+				break;
+			}
+
+#if !UE_BUILD_SHIPPING
+			// Items finalize in completion order, so a delayed one holds back the rest of the frame,
+			// lower priorities included since they may hold later items of the same lane
+			if (Item->GetElapsedTime() < TimeToWait)
+			{
+				bIsOverBudget = true;
+				break;
+			}
 
-		// Task is done, add to the outgoing queue
-		AddToOutQueue(ActiveTask);
-		ActiveTask = nullptr;
+			if (TimeToWait > 0.0f)
+			{
+				UE_LOG(LogB3atZOnline, Verbose, TEXT("Async task '%s' finalizing after %f seconds"),
+					*Item->ToString(),
+					Item->GetElapsedTime());
+			}
+#endif
+
+			PendingOutHead[Priority] = TOnlineAsyncQueue<FOnlineAsyncItem>::GetNext(Item);
+			if (PendingOutHead[Priority] == nullptr)
+			{
+				PendingOutTail[Priority] = nullptr;
+			}
+			if (Item->bHasOutLane)
+			{
+				FPendingOutLane* Lane = PendingOutLanes.Find(Item->OutLane);
+				check(Lane != nullptr);
+				if (--Lane->NumItems == 0)
+				{
+					PendingOutLanes.Remove(Item->OutLane);
+				}
+			}
+
+			// Finish work and trigger delegates
+			const double FinalizeStartTime = FPlatformTime::Seconds();
+			Item->Finalize();
+			Item->TriggerDelegates();
+			const double FinalizeEndTime = FPlatformTime::Seconds();
+
+			if (Recorder.IsRecording())
+			{
+				Recorder.RecordFinalize(Item, GetClockTime());
+			}
+			if (bRecordStats)
+			{
+				FOnlineAsyncTaskStats::Get().RecordTask(Item->GetStatName(), Item->StartTime, Item->ActivatedTime, Item->CompletedTime, FinalizeStartTime, FinalizeEndTime, OnlineThreadId);
+			}
+
+			delete Item;
+			NumDispatched++;
+
+			ElapsedTime = FinalizeEndTime - StartTime;
+			// A wall clock budget would make deterministic runs depend on machine speed
+			bIsOverBudget = !bIsDeterministic && GameTickBudget > 0.0 && ElapsedTime >= GameTickBudget;
+		}
 	}
+
+	NumPendingOut -= NumDispatched;
+
+	INC_DWORD_STAT_BY(STAT_B3atZOnline_AsyncDispatched, NumDispatched);
+	INC_DWORD_STAT_BY(STAT_B3atZOnline_AsyncDeferred, NumPendingOut);
+	if (GameTickBudget > 0.0 && ElapsedTime > GameTickBudget)
+	{
+		INC_DWORD_STAT(STAT_B3atZOnline_AsyncBudgetOverruns);
+	}
+
+	// Serial tasks are promoted by the online thread, only report how many are left
+	const int32 QueueSize = NumSerialTasks;
+	SET_DWORD_STAT(STAT_B3atZOnline_AsyncTasks, QueueSize);
+}
+
+void FOnlineAsyncTaskManager::Tick()
+{
+	// Tick Online services ( possibly callbacks ). 
+	OnlineTick();
+
+	// Tick all the parallel tasks - Tick unrelated tasks together. 
+	TickParallelTasks();
+
+	// Serial Q.
+	TickSerialLanes();
 }
@@ -0,0 +1,433 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "OnlineAsyncTaskRecorder.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "HAL/FileManager.h"
+#include "Serialization/Archive.h"
+#include "OnlineSubsystemB3atZ.h"
+
+/** Identifies an async task recording, "OATR" */
+#define ONLINE_ASYNC_RECORDING_MAGIC 0x5254414F
+
+/** Bits of the flags byte of an enqueue event */
+#define RECORD_ENQUEUE_PARALLEL 0x01
+#define RECORD_ENQUEUE_PRIORITY_SHIFT 1
+
+/** Bits of the flags byte of a complete event */
+#define RECORD_COMPLETE_SUCCESS 0x01
+
+/** Replays give up once this much virtual time passed after the last recorded event */
+#define REPLAY_MAX_OVERTIME 60.0
+
+/**
+ * Stand in for a recorded task, runs for the recorded time on the virtual clock
+ */
+class FOnlineAsyncTaskReplayed : public FOnlineAsyncTask
+{
+public:
+	FOnlineAsyncTaskReplayed(const FOnlineAsyncTaskManager& InTaskManager, const FOnlineAsyncRecordedTask& InRecordedTask, TArray<uint32>& InFinalizeOrder)
+		: TaskManager(InTaskManager)
+		, RecordedTask(InRecordedTask)
+		, FinalizeOrder(InFinalizeOrder)
+		, Duration(InRecordedTask.ActivateTime >= 0.0 ? FMath::Max(InRecordedTask.CompleteTime - InRecordedTask.ActivateTime, 0.0) : 0.0)
+		, FirstTickTime(-1.0)
+		, bIsComplete(false)
+	{
+	}
+
+	virtual FName GetSerializationLane() const override { return RecordedTask.Lane; }
+	virtual EOnlineAsyncPriority::Type GetPriority() const override { return RecordedTask.Priority; }
+
+	virtual void Tick() override
+	{
+		const double Now = TaskManager.GetClockTime();
+		if (FirstTickTime < 0.0)
+		{
+			FirstTickTime = Now;
+		}
+		bIsComplete = Now - FirstTickTime >= Duration;
+	}
+
+	virtual bool IsDone() override { return bIsComplete; }
+	virtual bool WasSuccessful() override { return RecordedTask.bWasSuccessful; }
+
+	virtual FString ToString() const override
+	{
+		return FString::Printf(TEXT("%s (replayed %u)"), *RecordedTask.Name.ToString(), RecordedTask.TaskId);
+	}
+	virtual FName GetStatName() const override { return RecordedTask.Name; }
+
+	virtual void TriggerDelegates() override
+	{
+		FinalizeOrder.Add(RecordedTask.TaskId);
+	}
+
+private:
+	/** Manager whose clock the task runs on */
+	const FOnlineAsyncTaskManager& TaskManager;
+	/** The task being replayed */
+	const FOnlineAsyncRecordedTask& RecordedTask;
+	/** Receives the recorded id once finalized */
+	TArray<uint32>& FinalizeOrder;
+	/** Recorded time from activation to completion */
+	double Duration;
+	/** Clock time of the first tick */
+	double FirstTickTime;
+	/** Whether the recorded duration passed */
+	bool bIsComplete;
+};
+
+FOnlineAsyncTaskRecorder& FOnlineAsyncTaskRecorder::Get()
+{
+	static FOnlineAsyncTaskRecorder Recorder;
+	return Recorder;
+}
+
+FOnlineAsyncTaskRecorder::FOnlineAsyncTaskRecorder()
+	: Writer(nullptr)
+	, StartTime(-1.0)
+	, LastMicros(0)
+	, NumEvents(0)
+	, bIsRecording(false)
+{
+}
+
+bool FOnlineAsyncTaskRecorder::StartRecording(FString Filename)
+{
+	StopRecording();
+
+	if (Filename.IsEmpty())
+	{
+		Filename = FPaths::ProfilingDir() / FString::Printf(TEXT("OnlineAsyncRecording-%s.oatr"), *FDateTime::Now().ToString());
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	Writer = IFileManager::Get().CreateFileWriter(*Filename);
+	if (Writer == nullptr)
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("Failed to open async task recording %s"), *Filename);
+		return false;
+	}
+
+	uint32 Magic = ONLINE_ASYNC_RECORDING_MAGIC;
+	uint32 Version = ONLINE_ASYNC_RECORDING_VERSION;
+	*Writer << Magic;
+	*Writer << Version;
+
+	StartTime = -1.0;
+	LastMicros = 0;
+	NumEvents = 0;
+	NameIndices.Reset();
+	CompletedItems.Reset();
+	bIsRecording = true;
+
+	UE_LOG_ONLINEB3ATZ(Display, TEXT("Recording async tasks to %s"), *Filename);
+	return true;
+}
+
+void FOnlineAsyncTaskRecorder::StopRecording()
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Writer != nullptr)
+	{
+		bIsRecording = false;
+		Writer->Close();
+		delete Writer;
+		Writer = nullptr;
+		CompletedItems.Empty();
+		UE_LOG_ONLINEB3ATZ(Display, TEXT("Recorded %d async task events"), NumEvents);
+	}
+}
+
+uint32 FOnlineAsyncTaskRecorder::GetNameIndex(FName InName)
+{
+	if (const uint32* Index = NameIndices.Find(InName))
+	{
+		return *Index;
+	}
+
+	const uint32 Index = NameIndices.Num();
+	NameIndices.Add(InName, Index);
+
+	uint8 Type = EOnlineAsyncRecordEvent::Name;
+	FString NameString = InName.ToString();
+	*Writer << Type;
+	*Writer << NameString;
+	return Index;
+}
+
+void FOnlineAsyncTaskRecorder::WriteEvent(EOnlineAsyncRecordEvent::Type Type, uint32 TaskId, double Time)
+{
+	if (StartTime < 0.0)
+	{
+		StartTime = Time;
+	}
+
+	// Events of different threads can arrive slightly out of time order, keep deltas positive
+	const uint64 Micros = FMath::Max<uint64>((uint64)(FMath::Max(Time - StartTime, 0.0) * 1000000.0), LastMicros);
+	uint32 DeltaMicros = (uint32)FMath::Min<uint64>(Micros - LastMicros, MAX_uint32);
+	LastMicros += DeltaMicros;
+
+	uint8 TypeByte = (uint8)Type;
+	*Writer << TypeByte;
+	Writer->SerializeIntPacked(DeltaMicros);
+	Writer->SerializeIntPacked(TaskId);
+	NumEvents++;
+}
+
+void FOnlineAsyncTaskRecorder::RecordEnqueue(uint32 TaskId, double Time, FName TaskName, FName Lane, bool bIsParallel, EOnlineAsyncPriority::Type Priority)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Writer != nullptr)
+	{
+		uint32 NameIndex = GetNameIndex(TaskName);
+		uint32 LaneIndex = GetNameIndex(Lane);
+		uint8 Flags = (bIsParallel ? RECORD_ENQUEUE_PARALLEL : 0) | (uint8)(Priority << RECORD_ENQUEUE_PRIORITY_SHIFT);
+
+		WriteEvent(EOnlineAsyncRecordEvent::Enqueue, TaskId, Time);
+		Writer->SerializeIntPacked(NameIndex);
+		Writer->SerializeIntPacked(LaneIndex);
+		*Writer << Flags;
+	}
+}
+
+void FOnlineAsyncTaskRecorder::RecordActivate(uint32 TaskId, double Time)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Writer != nullptr)
+	{
+		WriteEvent(EOnlineAsyncRecordEvent::Activate, TaskId, Time);
+	}
+}
+
+void FOnlineAsyncTaskRecorder::RecordComplete(const FOnlineAsyncItem* Item, uint32 TaskId, double Time, bool bWasSuccessful)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Writer != nullptr)
+	{
+		uint8 Flags = bWasSuccessful ? RECORD_COMPLETE_SUCCESS : 0;
+		WriteEvent(EOnlineAsyncRecordEvent::Complete, TaskId, Time);
+		*Writer << Flags;
+		CompletedItems.Add(Item, TaskId);
+	}
+}
+
+void FOnlineAsyncTaskRecorder::RecordFinalize(const FOnlineAsyncItem* Item, double Time)
+{
+	FScopeLock ScopeLock(&Lock);
+	uint32 TaskId = 0;
+	if (Writer != nullptr && CompletedItems.RemoveAndCopyValue(Item, TaskId))
+	{
+		WriteEvent(EOnlineAsyncRecordEvent::Finalize, TaskId, Time);
+	}
+}
+
+bool FOnlineAsyncTaskRecorder::LoadRecording(const FString& Filename, TArray<FOnlineAsyncRecordedTask>& OutTasks)
+{
+	OutTasks.Reset();
+
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Reader.IsValid())
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("Failed to open async task recording %s"), *Filename);
+		return false;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Reader << Magic;
+	*Reader << Version;
+	if (Magic != ONLINE_ASYNC_RECORDING_MAGIC || Version != ONLINE_ASYNC_RECORDING_VERSION)
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("%s is not an async task recording of version %d"), *Filename, ONLINE_ASYNC_RECORDING_VERSION);
+		return false;
+	}
+
+	TArray<FName> Names;
+	TMap<uint32, int32> TaskIndices;
+	uint64 Micros = 0;
+	int32 NumFinalized = 0;
+	while (!Reader->AtEnd() && !Reader->IsError())
+	{
+		uint8 Type = 0;
+		*Reader << Type;
+		if (Type == EOnlineAsyncRecordEvent::Name)
+		{
+			FString NameString;
+			*Reader << NameString;
+			Names.Add(FName(*NameString));
+			continue;
+		}
+
+		uint32 DeltaMicros = 0;
+		uint32 TaskId = 0;
+		Reader->SerializeIntPacked(DeltaMicros);
+		Reader->SerializeIntPacked(TaskId);
+		Micros += DeltaMicros;
+		const double Time = Micros / 1000000.0;
+
+		if (Type == EOnlineAsyncRecordEvent::Enqueue)
+		{
+			uint32 NameIndex = 0;
+			uint32 LaneIndex = 0;
+			uint8 Flags = 0;
+			Reader->SerializeIntPacked(NameIndex);
+			Reader->SerializeIntPacked(LaneIndex);
+			*Reader << Flags;
+			if (!Names.IsValidIndex(NameIndex) || !Names.IsValidIndex(LaneIndex))
+			{
+				break;
+			}
+
+			FOnlineAsyncRecordedTask& Task = OutTasks[OutTasks.AddDefaulted()];
+			Task.TaskId = TaskId;
+			Task.Name = Names[NameIndex];
+			Task.Lane = Names[LaneIndex];
+			Task.bIsParallel = (Flags & RECORD_ENQUEUE_PARALLEL) != 0;
+			Task.Priority = (EOnlineAsyncPriority::Type)FMath::Min<int32>(Flags >> RECORD_ENQUEUE_PRIORITY_SHIFT, EOnlineAsyncPriority::Count - 1);
+			Task.EnqueueTime = Time;
+			TaskIndices.Add(TaskId, OutTasks.Num() - 1);
+			continue;
+		}
+
+		uint8 Flags = 0;
+		if (Type == EOnlineAsyncRecordEvent::Complete)
+		{
+			*Reader << Flags;
+		}
+		else if (Type != EOnlineAsyncRecordEvent::Activate && Type != EOnlineAsyncRecordEvent::Finalize)
+		{
+			break;
+		}
+
+		// Tasks queued before the recording started are skipped
+		const int32* TaskIndex = TaskIndices.Find(TaskId);
+		if (TaskIndex == nullptr)
+		{
+			continue;
+		}
+		FOnlineAsyncRecordedTask& Task = OutTasks[*TaskIndex];
+		switch (Type)
+		{
+			case EOnlineAsyncRecordEvent::Activate:
+			{
+				Task.ActivateTime = Time;
+				break;
+			}
+			case EOnlineAsyncRecordEvent::Complete:
+			{
+				Task.CompleteTime = Time;
+				Task.bWasSuccessful = (Flags & RECORD_COMPLETE_SUCCESS) != 0;
+				break;
+			}
+			case EOnlineAsyncRecordEvent::Finalize:
+			{
+				Task.FinalizeTime = Time;
+				Task.FinalizeOrder = NumFinalized++;
+				break;
+			}
+		}
+	}
+
+	if (Reader->IsError())
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("Async task recording %s is truncated, read %d tasks"), *Filename, OutTasks.Num());
+	}
+	return true;
+}
+
+FOnlineAsyncReplayResult FOnlineAsyncTaskRecorder::Replay(FOnlineAsyncTaskManager& TaskManager, const TArray<FOnlineAsyncRecordedTask>& Tasks, double StepSeconds)
+{
+	FOnlineAsyncReplayResult Result;
+	if (!TaskManager.IsDeterministic() || StepSeconds <= 0.0)
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("Async task replays need a deterministic task manager and a positive step"));
+		return Result;
+	}
+
+	// Only tasks that completed while recording have a known duration
+	TArray<const FOnlineAsyncRecordedTask*> ReplayedTasks;
+	TArray<const FOnlineAsyncRecordedTask*> RecordedOrder;
+	double LastEventTime = 0.0;
+	for (const FOnlineAsyncRecordedTask& Task : Tasks)
+	{
+		if (Task.CompleteTime >= 0.0)
+		{
+			ReplayedTasks.Add(&Task);
+			LastEventTime = FMath::Max(LastEventTime, FMath::Max(Task.CompleteTime, Task.FinalizeTime));
+			if (Task.FinalizeOrder >= 0)
+			{
+				RecordedOrder.Add(&Task);
+			}
+		}
+	}
+	RecordedOrder.Sort([](const FOnlineAsyncRecordedTask& A, const FOnlineAsyncRecordedTask& B)
+	{
+		return A.FinalizeOrder < B.FinalizeOrder;
+	});
+	Result.NumTasks = ReplayedTasks.Num();
+
+	const double StartWallTime = FPlatformTime::Seconds();
+	const double StartTime = TaskManager.GetClockTime();
+	TArray<FOnlineAsyncTaskHandle> Handles;
+	int32 NextTask = 0;
+	while (Result.FinalizeOrder.Num() < ReplayedTasks.Num() && TaskManager.GetClockTime() - StartTime <= LastEventTime + REPLAY_MAX_OVERTIME)
+	{
+		// Tasks were recorded in enqueue order
+		const double Now = TaskManager.GetClockTime() - StartTime;
+		while (NextTask < ReplayedTasks.Num() && ReplayedTasks[NextTask]->EnqueueTime <= Now)
+		{
+			const FOnlineAsyncRecordedTask& RecordedTask = *ReplayedTasks[NextTask++];
+			FOnlineAsyncTaskReplayed* Task = new FOnlineAsyncTaskReplayed(TaskManager, RecordedTask, Result.FinalizeOrder);
+			Handles.Add(RecordedTask.bIsParallel ? TaskManager.AddToParallelTasks(Task) : TaskManager.AddToInQueue(Task));
+		}
+
+		TaskManager.Step(StepSeconds);
+		Result.NumSteps++;
+	}
+	Result.WallSeconds = FPlatformTime::Seconds() - StartWallTime;
+	Result.VirtualSeconds = TaskManager.GetClockTime() - StartTime;
+
+	if (Result.FinalizeOrder.Num() < ReplayedTasks.Num())
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("Async task replay gave up with %d of %d tasks finalized"), Result.FinalizeOrder.Num(), ReplayedTasks.Num());
+
+		// The stragglers point at the result, flush them out while it still exists
+		const int32 NumFinalized = Result.FinalizeOrder.Num();
+		for (const FOnlineAsyncTaskHandle& Handle : Handles)
+		{
+			TaskManager.Cancel(Handle);
+		}
+		TaskManager.Step(0.0);
+		Result.FinalizeOrder.SetNum(NumFinalized);
+	}
+
+	for (int32 Index = 0; Index < RecordedOrder.Num(); Index++)
+	{
+		if (!Result.FinalizeOrder.IsValidIndex(Index) || Result.FinalizeOrder[Index] != RecordedOrder[Index]->TaskId)
+		{
+			Result.NumReordered++;
+		}
+	}
+	return Result;
+}
+
+bool FOnlineAsyncTaskRecorder::Exec(const TCHAR* Cmd, FOutputDevice& Ar)
+{
+	if (FParse::Command(&Cmd, TEXT("START")))
+	{
+		StartRecording(FParse::Token(Cmd, false));
+	}
+	else if (FParse::Command(&Cmd, TEXT("STOP")))
+	{
+		StopRecording();
+	}
+	else
+	{
+		Ar.Logf(TEXT("Async task recording is %s"), IsRecording() ? TEXT("on") : TEXT("off"));
+	}
+	return true;
+}
@@ -0,0 +1,310 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "OnlineAsyncTaskStats.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/Paths.h"
+#include "Misc/FileHelper.h"
+#include "Misc/DateTime.h"
+#include "HAL/IConsoleManager.h"
+#include "OnlineSubsystemB3atZ.h"
+
+namespace OSSConsoleVariables
+{
+	/** Records async task latencies, cheap enough to leave on in production */
+	TAutoConsoleVariable<int32> CVarAsyncTaskStats(
+		TEXT("OSS.AsyncTaskStats"),
+		0,
+		TEXT("Record queue, execute and finalize latencies of online async tasks\n")
+		TEXT("0 off, 1 on"),
+		ECVF_Default);
+}
+
+const TCHAR* EOnlineAsyncTaskPhase::ToString(EOnlineAsyncTaskPhase::Type Phase)
+{
+	switch (Phase)
+	{
+		case QueueWait:
+		{
+			return TEXT("QueueWait");
+		}
+		case Execute:
+		{
+			return TEXT("Execute");
+		}
+		case Finalize:
+		{
+			return TEXT("Finalize");
+		}
+	}
+	return TEXT("");
+}
+
+FOnlineLatencyHistogram::FOnlineLatencyHistogram()
+{
+	Reset();
+}
+
+int32 FOnlineLatencyHistogram::GetBucketIndex(uint64 Micros)
+{
+	if (Micros < ONLINE_LATENCY_SUB_BUCKETS)
+	{
+		return (int32)Micros;
+	}
+	const int32 Exponent = FMath::Min((int32)FPlatformMath::FloorLog2_64(Micros), ONLINE_LATENCY_MAX_EXPONENT);
+	const int32 SubBucket = (int32)(Micros >> (Exponent - ONLINE_LATENCY_SUB_BUCKET_BITS)) & (ONLINE_LATENCY_SUB_BUCKETS - 1);
+	return (Exponent - ONLINE_LATENCY_SUB_BUCKET_BITS + 1) * ONLINE_LATENCY_SUB_BUCKETS + SubBucket;
+}
+
+uint64 FOnlineLatencyHistogram::GetBucketUpperBound(int32 Index)
+{
+	if (Index < ONLINE_LATENCY_SUB_BUCKETS)
+	{
+		return (uint64)Index;
+	}
+	const int32 Shift = Index / ONLINE_LATENCY_SUB_BUCKETS - 1;
+	const uint64 SubBucket = Index % ONLINE_LATENCY_SUB_BUCKETS;
+	return ((ONLINE_LATENCY_SUB_BUCKETS + SubBucket + 1) << Shift) - 1;
+}
+
+void FOnlineLatencyHistogram::Record(double Seconds)
+{
+	const int64 Micros = FMath::Max<int64>((int64)(Seconds * 1000000.0), 0);
+	FPlatformAtomics::InterlockedIncrement(&Buckets[GetBucketIndex((uint64)Micros)]);
+	FPlatformAtomics::InterlockedIncrement(&Count);
+	FPlatformAtomics::InterlockedAdd(&TotalMicros, Micros);
+
+	int64 OldMax = MaxMicros;
+	while (Micros > OldMax)
+	{
+		const int64 PrevMax = FPlatformAtomics::InterlockedCompareExchange(&MaxMicros, Micros, OldMax);
+		if (PrevMax == OldMax)
+		{
+			break;
+		}
+		OldMax = PrevMax;
+	}
+}
+
+void FOnlineLatencyHistogram::Reset()
+{
+	for (int32 Index = 0; Index < ONLINE_LATENCY_NUM_BUCKETS; Index++)
+	{
+		Buckets[Index] = 0;
+	}
+	Count = 0;
+	TotalMicros = 0;
+	MaxMicros = 0;
+}
+
+int64 FOnlineLatencyHistogram::GetPercentile(double Percentile) const
+{
+	const int64 NumSamples = Count;
+	if (NumSamples == 0)
+	{
+		return 0;
+	}
+
+	const double ExactTarget = NumSamples * FMath::Clamp(Percentile, 0.0, 1.0);
+	int64 Target = FMath::Max<int64>((int64)ExactTarget, 1);
+	if (Target < ExactTarget)
+	{
+		Target++;
+	}
+	int64 Seen = 0;
+	for (int32 Index = 0; Index < ONLINE_LATENCY_NUM_BUCKETS; Index++)
+	{
+		Seen += Buckets[Index];
+		if (Seen >= Target)
+		{
+			// Never report more than was actually seen
+			return FMath::Min<int64>((int64)GetBucketUpperBound(Index), MaxMicros);
+		}
+	}
+	return MaxMicros;
+}
+
+FOnlineAsyncTaskStats& FOnlineAsyncTaskStats::Get()
+{
+	static FOnlineAsyncTaskStats Instance;
+	return Instance;
+}
+
+FOnlineAsyncTaskStats::FOnlineAsyncTaskStats()
+	: NumTraceEvents(0)
+	, bIsTracing(false)
+{
+}
+
+bool FOnlineAsyncTaskStats::IsEnabled()
+{
+	return OSSConsoleVariables::CVarAsyncTaskStats.GetValueOnAnyThread() != 0 || Get().IsTracing();
+}
+
+FOnlineAsyncTaskStats::FTaskTypeStats& FOnlineAsyncTaskStats::FindOrAddType(FName TaskName)
+{
+	FScopeLock ScopeLock(&TaskTypesLock);
+	FTaskTypeStats*& TypeStats = TaskTypes.FindOrAdd(TaskName);
+	if (TypeStats == nullptr)
+	{
+		TypeStats = new FTaskTypeStats();
+		TypeStats->Name = TaskName;
+	}
+	return *TypeStats;
+}
+
+void FOnlineAsyncTaskStats::RecordTask(FName TaskName, double CreatedTime, double ActivatedTime, double CompletedTime, double FinalizeStartTime, double FinalizeEndTime, uint32 ExecuteThreadId)
+{
+	FTaskTypeStats& TypeStats = FindOrAddType(TaskName);
+	TypeStats.Phases[EOnlineAsyncTaskPhase::QueueWait].Record(ActivatedTime - CreatedTime);
+	TypeStats.Phases[EOnlineAsyncTaskPhase::Execute].Record(CompletedTime - ActivatedTime);
+	TypeStats.Phases[EOnlineAsyncTaskPhase::Finalize].Record(FinalizeEndTime - FinalizeStartTime);
+
+	if (bIsTracing)
+	{
+		// Waiting tasks get their own track, they aren't running on any thread
+		AddTraceEvent(TaskName, EOnlineAsyncTaskPhase::QueueWait, CreatedTime, ActivatedTime, 0);
+		AddTraceEvent(TaskName, EOnlineAsyncTaskPhase::Execute, ActivatedTime, CompletedTime, ExecuteThreadId);
+		AddTraceEvent(TaskName, EOnlineAsyncTaskPhase::Finalize, FinalizeStartTime, FinalizeEndTime, FPlatformTLS::GetCurrentThreadId());
+	}
+}
+
+void FOnlineAsyncTaskStats::AddTraceEvent(FName TaskName, EOnlineAsyncTaskPhase::Type Phase, double StartTime, double EndTime, uint32 ThreadId)
+{
+	const int32 Slot = (FPlatformAtomics::InterlockedIncrement(&NumTraceEvents) - 1) % ONLINE_ASYNC_TRACE_CAPACITY;
+	FTraceEvent& Event = TraceEvents[Slot];
+	Event.Name = TaskName;
+	Event.Phase = Phase;
+	Event.ThreadId = ThreadId;
+	Event.StartTime = StartTime;
+	Event.EndTime = EndTime;
+}
+
+void FOnlineAsyncTaskStats::Dump(FOutputDevice& Ar)
+{
+	TArray<FTaskTypeStats*> SortedTypes;
+	{
+		FScopeLock ScopeLock(&TaskTypesLock);
+		TaskTypes.GenerateValueArray(SortedTypes);
+	}
+	SortedTypes.Sort([](const FTaskTypeStats& A, const FTaskTypeStats& B)
+	{
+		return A.Name.ToString() < B.Name.ToString();
+	});
+
+	Ar.Logf(TEXT("Online async task latencies in microseconds:"));
+	for (const FTaskTypeStats* TypeStats : SortedTypes)
+	{
+		Ar.Logf(TEXT("%s (%lld tasks)"), *TypeStats->Name.ToString(), TypeStats->Phases[EOnlineAsyncTaskPhase::Finalize].GetCount());
+		for (int32 Phase = 0; Phase < EOnlineAsyncTaskPhase::Count; Phase++)
+		{
+			const FOnlineLatencyHistogram& Histogram = TypeStats->Phases[Phase];
+			Ar.Logf(TEXT("  %-10s mean %10.0f p50 %10lld p90 %10lld p99 %10lld max %10lld"),
+				EOnlineAsyncTaskPhase::ToString((EOnlineAsyncTaskPhase::Type)Phase),
+				Histogram.GetMean(),
+				Histogram.GetPercentile(0.5),
+				Histogram.GetPercentile(0.9),
+				Histogram.GetPercentile(0.99),
+				Histogram.GetMax());
+		}
+	}
+}
+
+void FOnlineAsyncTaskStats::Reset()
+{
+	FScopeLock ScopeLock(&TaskTypesLock);
+	for (TPair<FName, FTaskTypeStats*>& Pair : TaskTypes)
+	{
+		for (int32 Phase = 0; Phase < EOnlineAsyncTaskPhase::Count; Phase++)
+		{
+			Pair.Value->Phases[Phase].Reset();
+		}
+	}
+}
+
+void FOnlineAsyncTaskStats::StartTrace()
+{
+	// Tasks are only recorded on the game thread, same as this, so the ring can be set up safely
+	check(IsInGameThread());
+	bIsTracing = false;
+	TraceEvents.SetNum(ONLINE_ASYNC_TRACE_CAPACITY);
+	NumTraceEvents = 0;
+	bIsTracing = true;
+}
+
+void FOnlineAsyncTaskStats::StopTrace()
+{
+	bIsTracing = false;
+}
+
+bool FOnlineAsyncTaskStats::SaveTrace(FString Filename)
+{
+	if (Filename.IsEmpty())
+	{
+		Filename = FPaths::ProfilingDir() / FString::Printf(TEXT("OnlineAsyncTrace-%s.json"), *FDateTime::Now().ToString());
+	}
+
+	const int32 NumEvents = FMath::Min<int32>(NumTraceEvents, TraceEvents.Num());
+	const int32 FirstEvent = NumTraceEvents > TraceEvents.Num() ? NumTraceEvents % TraceEvents.Num() : 0;
+
+	// Complete events ("ph":"X") with microsecond timestamps
+	FString Json = TEXT("{\"traceEvents\":[\n");
+	for (int32 Index = 0; Index < NumEvents; Index++)
+	{
+		const FTraceEvent& Event = TraceEvents[(FirstEvent + Index) % TraceEvents.Num()];
+		Json += FString::Printf(TEXT("%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}"),
+			Index > 0 ? TEXT(",\n") : TEXT(""),
+			*Event.Name.ToString().ReplaceCharWithEscapedChar(),
+			EOnlineAsyncTaskPhase::ToString(Event.Phase),
+			Event.ThreadId,
+			Event.StartTime * 1000000.0,
+			FMath::Max(Event.EndTime - Event.StartTime, 0.0) * 1000000.0);
+	}
+	Json += TEXT("\n]}\n");
+
+	if (!FFileHelper::SaveStringToFile(Json, *Filename))
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("Failed to write async task trace to %s"), *Filename);
+		return false;
+	}
+	UE_LOG_ONLINEB3ATZ(Display, TEXT("Wrote %d async task trace events to %s"), NumEvents, *Filename);
+	return true;
+}
+
+bool FOnlineAsyncTaskStats::Exec(const TCHAR* Cmd, FOutputDevice& Ar)
+{
+	if (FParse::Command(&Cmd, TEXT("RESET")))
+	{
+		Reset();
+	}
+	else if (FParse::Command(&Cmd, TEXT("TRACE")))
+	{
+		if (FParse::Command(&Cmd, TEXT("START")))
+		{
+			StartTrace();
+		}
+		else if (FParse::Command(&Cmd, TEXT("STOP")))
+		{
+			StopTrace();
+		}
+		else if (FParse::Command(&Cmd, TEXT("SAVE")))
+		{
+			SaveTrace(FParse::Token(Cmd, false));
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// DUMP or nothing
+		FParse::Command(&Cmd, TEXT("DUMP"));
+		if (!IsEnabled())
+		{
+			Ar.Logf(TEXT("Async task stats are off, enable them with OSS.AsyncTaskStats 1"));
+		}
+		Dump(Ar);
+	}
+	return true;
+}
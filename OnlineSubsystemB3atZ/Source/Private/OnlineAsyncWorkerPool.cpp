@@ -0,0 +1,185 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "OnlineAsyncWorkerPool.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+#include "OnlineAsyncTaskManager.h"
+#include "OnlineSubsystemB3atZ.h"
+
+/** How long an idle worker waits before it looks for work to steal again, while other workers have tasks queued */
+#define WORKER_IDLE_WAIT_MS 10
+
+FOnlineAsyncWorkerPool::FWorker::FWorker(FOnlineAsyncWorkerPool& InPool, int32 InIndex)
+	: Pool(InPool)
+	, Index(InIndex)
+	, WorkEvent(FPlatformProcess::GetSynchEventFromPool())
+	, bIsIdle(0)
+	, bRequestingExit(0)
+	, Thread(nullptr)
+{
+}
+
+FOnlineAsyncWorkerPool::FWorker::~FWorker()
+{
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	WorkEvent = nullptr;
+}
+
+uint32 FOnlineAsyncWorkerPool::FWorker::Run()
+{
+	while (!bRequestingExit)
+	{
+		FOnlineAsyncTask* Task = Pool.FindWork(*this);
+		if (Task != nullptr)
+		{
+			Pool.RunTask(*this, Task);
+		}
+		else
+		{
+			FPlatformAtomics::InterlockedExchange(&bIsIdle, 1);
+			// Park until AddTask picks this worker, unless there is queued work a busy worker may not get to soon
+			WorkEvent->Wait(Pool.NumQueuedTasks > 0 ? WORKER_IDLE_WAIT_MS : MAX_uint32);
+			FPlatformAtomics::InterlockedExchange(&bIsIdle, 0);
+		}
+	}
+	return 0;
+}
+
+void FOnlineAsyncWorkerPool::FWorker::Stop()
+{
+	FPlatformAtomics::InterlockedExchange(&bRequestingExit, 1);
+	WorkEvent->Trigger();
+}
+
+FOnlineAsyncWorkerPool::FOnlineAsyncWorkerPool(FOnlineAsyncTaskManager& InTaskManager, int32 NumWorkers)
+	: TaskManager(InTaskManager)
+	, NextWorker(0)
+	, NumQueuedTasks(0)
+{
+	// All workers exist before any thread starts stealing from them
+	for (int32 Index = 0; Index < NumWorkers; Index++)
+	{
+		Workers.Add(new FWorker(*this, Index));
+	}
+	for (FWorker* Worker : Workers)
+	{
+		Worker->Thread = FRunnableThread::Create(Worker, *FString::Printf(TEXT("OnlineAsyncWorker %d"), Worker->Index), 128 * 1024, TPri_BelowNormal);
+		check(Worker->Thread);
+	}
+	UE_LOG(LogB3atZOnline, Log, TEXT("Started %d online async workers"), NumWorkers);
+}
+
+FOnlineAsyncWorkerPool::~FOnlineAsyncWorkerPool()
+{
+	for (FWorker* Worker : Workers)
+	{
+		Worker->Stop();
+	}
+	for (FWorker* Worker : Workers)
+	{
+		Worker->Thread->WaitForCompletion();
+		delete Worker->Thread;
+	}
+	for (FWorker* Worker : Workers)
+	{
+		for (FOnlineAsyncTask* Task : Worker->Tasks)
+		{
+			// Still live in the task manager, so it has to finish them for their handles and delegates
+			TaskManager.CompleteCancelledTask(Task);
+		}
+		delete Worker;
+	}
+	Workers.Empty();
+}
+
+void FOnlineAsyncWorkerPool::AddTask(FOnlineAsyncTask* Task)
+{
+	const int32 NumWorkers = Workers.Num();
+	const int32 FirstWorker = (FPlatformAtomics::InterlockedIncrement(&NextWorker) & MAX_int32) % NumWorkers;
+
+	// Counted before looking for an idle worker, so a worker going idle meanwhile either is found or sees the task
+	FPlatformAtomics::InterlockedIncrement(&NumQueuedTasks);
+
+	// Prefer a worker that waits for work, otherwise spread tasks round robin and let stealing even it out
+	FWorker* Target = Workers[FirstWorker];
+	for (int32 Offset = 0; Offset < NumWorkers; Offset++)
+	{
+		FWorker* Worker = Workers[(FirstWorker + Offset) % NumWorkers];
+		if (Worker->bIsIdle)
+		{
+			Target = Worker;
+			break;
+		}
+	}
+
+	{
+		FScopeLock ScopeLock(&Target->TasksLock);
+		Target->Tasks.Add(Task);
+	}
+	Target->WorkEvent->Trigger();
+}
+
+FOnlineAsyncTask* FOnlineAsyncWorkerPool::FindWork(FWorker& Worker)
+{
+	{
+		FScopeLock ScopeLock(&Worker.TasksLock);
+		if (Worker.Tasks.Num() > 0)
+		{
+			FPlatformAtomics::InterlockedDecrement(&NumQueuedTasks);
+			return Worker.Tasks.Pop(false);
+		}
+	}
+
+	const int32 NumWorkers = Workers.Num();
+	for (int32 Offset = 1; Offset < NumWorkers; Offset++)
+	{
+		FWorker& Victim = *Workers[(Worker.Index + Offset) % NumWorkers];
+		FScopeLock ScopeLock(&Victim.TasksLock);
+		if (Victim.Tasks.Num() > 0)
+		{
+			FOnlineAsyncTask* Task = Victim.Tasks[0];
+			Victim.Tasks.RemoveAt(0, 1, false);
+			FPlatformAtomics::InterlockedDecrement(&NumQueuedTasks);
+			INC_DWORD_STAT(STAT_B3atZOnline_AsyncWorkerSteals);
+			return Task;
+		}
+	}
+	return nullptr;
+}
+
+void FOnlineAsyncWorkerPool::RunTask(FWorker& Worker, FOnlineAsyncTask* Task)
+{
+	if (!TaskManager.AbandonIfExpired(Task, TaskManager.GetClockTime()))
+	{
+		Task->Tick();
+
+		if (!Task->IsDone())
+		{
+			// Behind the worker's other tasks, and first in line for a thief
+			FPlatformAtomics::InterlockedIncrement(&NumQueuedTasks);
+			FScopeLock ScopeLock(&Worker.TasksLock);
+			Worker.Tasks.Insert(Task, 0);
+			return;
+		}
+
+		if (Task->WasSuccessful())
+		{
+			UE_LOG(LogB3atZOnline, Verbose, TEXT("Async task '%s' succeeded in %f seconds (Worker %d)"),
+				*Task->ToString(),
+				Task->GetElapsedTime(),
+				Worker.Index);
+		}
+		else
+		{
+			UE_LOG(LogB3atZOnline, Log, TEXT("Async task '%s' failed in %f seconds (Worker %d)"),
+				*Task->ToString(),
+				Task->GetElapsedTime(),
+				Worker.Index);
+		}
+	}
+
+	TaskManager.CompleteTask(Task);
+}
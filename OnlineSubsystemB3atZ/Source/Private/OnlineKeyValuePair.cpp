@@ -20,20 +20,21 @@
  * @param Other the other structure to copy
  */
 FVariantData::FVariantData(const FVariantData& Other) :
-	Type(EOnlineKeyValuePairDataType::Empty)
+	Type(EOnlineKeyValuePairDataType::Empty),
+	bIsInline(false)
 {
 	// Use common methods for doing deep copy or just do a simple shallow copy
-	if (Other.Type == EOnlineKeyValuePairDataType::String)
+	if (Other.Type == EOnlineKeyValuePairDataType::String && !Other.bIsInline)
 	{
 		SetValue(Other.Value.AsTCHAR);
 	}
-	else if (Other.Type == EOnlineKeyValuePairDataType::Blob)
+	else if (Other.Type == EOnlineKeyValuePairDataType::Blob && !Other.bIsInline)
 	{
 		SetValue(Other.Value.AsBlob.BlobSize, Other.Value.AsBlob.BlobData);
 	}
 	else
 	{
-		// Shallow copy is safe
+		// Shallow copy is safe, inline strings and blobs hold no pointers
 		FMemory::Memcpy(this, &Other, sizeof(FVariantData));
 	}
 }
@@ -48,18 +49,18 @@ FVariantData& FVariantData::operator=(const FVariantData& Other)
 	if (this != &Other)
 	{
 		// Use common methods for doing deep copy or just do a simple shallow copy
-		if (Other.Type == EOnlineKeyValuePairDataType::String)
+		if (Other.Type == EOnlineKeyValuePairDataType::String && !Other.bIsInline)
 		{
 			SetValue(Other.Value.AsTCHAR);
 		}
-		else if (Other.Type == EOnlineKeyValuePairDataType::Blob)
+		else if (Other.Type == EOnlineKeyValuePairDataType::Blob && !Other.bIsInline)
 		{
 			SetValue(Other.Value.AsBlob.BlobSize, Other.Value.AsBlob.BlobData);
 		}
 		else
 		{
 			Empty();
-			// Shallow copy is safe
+			// Shallow copy is safe, inline strings and blobs hold no pointers
 			FMemory::Memcpy(this, &Other, sizeof(FVariantData));
 		}
 	}
@@ -78,6 +79,14 @@ void FVariantData::SetValue(const TCHAR* InData)
 	if (InData != NULL)
 	{	
 		int32 StrLen = FCString::Strlen(InData);
+		const int32 NumBytes = (StrLen + 1) * sizeof(TCHAR);
+		if (NumBytes <= VARIANT_DATA_INLINE_SIZE)
+		{
+			// Short strings and their terminator fit in the union
+			bIsInline = true;
+			FMemory::Memcpy(Value.AsInline.Data, InData, NumBytes);
+			return;
+		}
 		// Allocate a buffer for the string plus terminator
 		Value.AsTCHAR = new TCHAR[StrLen + 1];
 		if (StrLen > 0)
@@ -92,6 +101,25 @@ void FVariantData::SetValue(const TCHAR* InData)
 	}
 }
 
+TCHAR* FVariantData::SetStringUninitialized(int32 MaxChars)
+{
+	Empty();
+	Type = EOnlineKeyValuePairDataType::String;
+	TCHAR* Chars = NULL;
+	if ((MaxChars + 1) * (int32)sizeof(TCHAR) <= VARIANT_DATA_INLINE_SIZE)
+	{
+		bIsInline = true;
+		Chars = (TCHAR*)Value.AsInline.Data;
+	}
+	else
+	{
+		Value.AsTCHAR = new TCHAR[MaxChars + 1];
+		Chars = Value.AsTCHAR;
+	}
+	Chars[0] = TEXT('\0');
+	return Chars;
+}
+
 /**
  * Copies the data and sets the type
  *
@@ -182,7 +210,14 @@ void FVariantData::SetValue(uint32 Size, const uint8* InData)
 {
 	Empty();
 	Type = EOnlineKeyValuePairDataType::Blob;
-	if (Size > 0)
+	if (Size > 0 && Size <= VARIANT_DATA_INLINE_SIZE)
+	{
+		// Small blobs fit in the union
+		bIsInline = true;
+		Value.AsInline.Size = (uint8)Size;
+		FMemory::Memcpy(Value.AsInline.Data, InData, Size);
+	}
+	else if (Size > 0)
 	{
 		// Deep copy the binary data
 		Value.AsBlob.BlobSize = Size;
@@ -222,9 +257,10 @@ void FVariantData::SetValue(uint64 InData)
  */
 void FVariantData::GetValue(FString& OutData) const
 {
-	if (Type == EOnlineKeyValuePairDataType::String && Value.AsTCHAR != NULL)
+	const TCHAR* StringData = Type == EOnlineKeyValuePairDataType::String ? GetStringData() : NULL;
+	if (StringData != NULL)
 	{
-		OutData = Value.AsTCHAR;
+		OutData = StringData;
 	}
 	else
 	{
@@ -345,10 +381,10 @@ void FVariantData::GetValue(uint32& OutSize, uint8** OutData) const
 {
 	if (Type == EOnlineKeyValuePairDataType::Blob)
 	{
-		OutSize = Value.AsBlob.BlobSize;
+		OutSize = GetBlobSize();
 		// Need to perform a deep copy
 		*OutData = new uint8[OutSize];
-		FMemory::Memcpy(*OutData, Value.AsBlob.BlobData, OutSize);
+		FMemory::Memcpy(*OutData, GetBlobData(), OutSize);
 	}
 	else
 	{
@@ -367,10 +403,11 @@ void FVariantData::GetValue(TArray<uint8>& OutData) const
 	if (Type == EOnlineKeyValuePairDataType::Blob)
 	{
 		// Presize the array so it only allocates what's needed
-		OutData.Empty(Value.AsBlob.BlobSize);
-		OutData.AddUninitialized(Value.AsBlob.BlobSize);
+		const uint32 BlobSize = GetBlobSize();
+		OutData.Empty(BlobSize);
+		OutData.AddUninitialized(BlobSize);
 		// Copy into the array
-		FMemory::Memcpy(OutData.GetData(), Value.AsBlob.BlobData, Value.AsBlob.BlobSize);
+		FMemory::Memcpy(OutData.GetData(), GetBlobData(), BlobSize);
 	}
 	else
 	{
@@ -400,8 +437,8 @@ void FVariantData::GetValue(double& OutData) const
  */
 void FVariantData::Empty()
 {
-	// Be sure to delete deep allocations
-	switch (Type)
+	// Be sure to delete deep allocations, inline payloads have none
+	switch (bIsInline ? EOnlineKeyValuePairDataType::Empty : Type)
 	{
 	case EOnlineKeyValuePairDataType::String:
 		delete [] Value.AsTCHAR;
@@ -412,6 +449,7 @@ void FVariantData::Empty()
 	}
 
 	Type = EOnlineKeyValuePairDataType::Empty;
+	bIsInline = false;
 	FMemory::Memset(&Value, 0, sizeof(ValueUnion));
 }
 
@@ -479,7 +517,7 @@ FString FVariantData::ToString() const
 		}
 		case EOnlineKeyValuePairDataType::Blob:
 		{
-			return FString::Printf(TEXT("%d byte blob"), Value.AsBlob.BlobSize);
+			return FString::Printf(TEXT("%d byte blob"), GetBlobSize());
 		}
 	}
 	return TEXT("");
@@ -755,12 +793,12 @@ bool FVariantData::operator==(const FVariantData& Other) const
 			}
 		case EOnlineKeyValuePairDataType::String:
 			{
-				return FCString::Strcmp(Value.AsTCHAR, Other.Value.AsTCHAR) == 0;
+				return FCString::Strcmp(GetStringData(), Other.GetStringData()) == 0;
 			}
 		case EOnlineKeyValuePairDataType::Blob:
 			{
-				return (Value.AsBlob.BlobSize == Other.Value.AsBlob.BlobSize) && 
-						 (FMemory::Memcmp(Value.AsBlob.BlobData, Other.Value.AsBlob.BlobData, Value.AsBlob.BlobSize) == 0);
+				return (GetBlobSize() == Other.GetBlobSize()) && 
+						 (FMemory::Memcmp(GetBlobData(), Other.GetBlobData(), GetBlobSize()) == 0);
 			}
 		case EOnlineKeyValuePairDataType::Bool:
 			{
@@ -137,6 +137,20 @@ void FOnlineSessionSettings::Set(FName Key, const FOnlineSessionSetting& SrcSett
 	}
 }
 
+void FOnlineSessionSettings::Set(FName Key, FOnlineSessionSetting&& SrcSetting)
+{
+	FOnlineSessionSetting* Setting = Settings.Find(Key);
+	if (Setting)
+	{
+		Setting->Data = MoveTemp(SrcSetting.Data);
+		Setting->AdvertisementType = SrcSetting.AdvertisementType;
+	}
+	else
+	{
+		Settings.Add(Key, MoveTemp(SrcSetting));
+	}
+}
+
 template<typename ValueType> 
 bool FOnlineSessionSettings::Get(FName Key, ValueType& Value) const
 {
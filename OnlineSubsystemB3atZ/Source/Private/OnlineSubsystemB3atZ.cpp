@@ -16,8 +16,19 @@ DEFINE_LOG_CATEGORY(LogB3atZOnlineChat);
 #if STATS
 ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_Async);
 ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncTasks);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncDispatch);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncDispatched);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncDeferred);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncBudgetOverruns);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncItemPoolAllocs);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncItemHeapAllocs);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncItemsLive);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_AsyncWorkerSteals);
 ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZSession_Interface);
 ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZVoice_Interface);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_LanQueriesAnswered);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_LanQueriesDropped);
+ONLINESUBSYSTEMB3ATZ_API DEFINE_STAT(STAT_B3atZOnline_LanQueriesCoalesced);
 #endif
 
 int32 GetBuildUniqueId()
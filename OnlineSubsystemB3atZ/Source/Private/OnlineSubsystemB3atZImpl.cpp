@@ -10,6 +10,8 @@
 #include "Interfaces/OnlineSessionInterfaceB3atZ.h"
 #include "Interfaces/OnlineFriendsInterface.h"
 #include "Interfaces/OnlinePurchaseInterface.h"
+#include "OnlineAsyncTaskStats.h"
+#include "OnlineAsyncTaskRecorder.h"
 
 namespace OSSConsoleVariables
 {
@@ -213,6 +215,14 @@ bool FOnlineSubsystemB3atZImpl::Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputD
 	{
 		bWasHandled = HandlePurchaseExecCommands(InWorld, Cmd, Ar);
 	}
+	else if (FParse::Command(&Cmd, TEXT("ASYNCSTATS")))
+	{
+		bWasHandled = FOnlineAsyncTaskStats::Get().Exec(Cmd, Ar);
+	}
+	else if (FParse::Command(&Cmd, TEXT("ASYNCRECORD")))
+	{
+		bWasHandled = FOnlineAsyncTaskRecorder::Get().Exec(Cmd, Ar);
+	}
 	
 	return bWasHandled;
 }
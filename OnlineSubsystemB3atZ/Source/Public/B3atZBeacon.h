@@ -6,6 +6,7 @@
 #include "CoreMinimal.h"
 #include "OnlineSubsystemB3atZTypes.h"
 #include "OnlineDelegateMacros.h"
+#include "NboPacketLayout.h"
 
 
 /**
@@ -15,8 +16,25 @@
  * Current format:
  *
  *	<Ver byte><Platform byte><Game unique 4 bytes><packet type 2 bytes><nonce 8 bytes><payload>
+ *
+ * Client queries carry the search parameters as payload so hosts can filter before answering.
+ * Since version 12 host responses carry the session settings in a compact encoding,
+ * since version 13 responses too large for one packet are sent as fragments,
+ * since version 14 the fixed fields of the session come first as one layout
  */
-#define LAN_BEACON_PACKET_VERSION (uint8)10
+#define LAN_BEACON_PACKET_VERSION (uint8)14
+
+/** Oldest client version hosts still answer, in the format of that version */
+#define LAN_BEACON_MIN_QUERY_VERSION (uint8)10
+
+/** First version with the compact session settings encoding */
+#define LAN_BEACON_COMPACT_SETTINGS_VERSION (uint8)12
+
+/** First version that can reassemble fragmented host responses */
+#define LAN_BEACON_FRAGMENT_VERSION (uint8)13
+
+/** First version with the fixed session header ahead of the session strings and settings */
+#define LAN_BEACON_SESSION_LAYOUT_VERSION (uint8)14
 
 /** The size of the header for validation */
 #define LAN_BEACON_PACKET_HEADER_SIZE 16
@@ -36,11 +54,85 @@
 #define LAN_SERVER_RESPONSE1 (uint8)'S'
 #define LAN_SERVER_RESPONSE2 (uint8)'R'
 
+// Latency probe sent by a searching client to a host it found, carries <send time 8 bytes><ping id 4 bytes>
+#define LAN_SERVER_PING1 (uint8)'S'
+#define LAN_SERVER_PING2 (uint8)'P'
+
+// Host echo of a latency probe, payload is returned unchanged
+#define LAN_SERVER_PONG1 (uint8)'S'
+#define LAN_SERVER_PONG2 (uint8)'O'
+
+/** Size of the ping/pong payload following the header */
+#define LAN_BEACON_PING_PAYLOAD_SIZE 12
+
+// Fragment of a host response too large for a single packet. The nonce slot holds
+// <response id 4 bytes><low 4 bytes of the client nonce>, followed by <fragment index byte><fragment count byte>
+#define LAN_SERVER_FRAGMENT1 (uint8)'S'
+#define LAN_SERVER_FRAGMENT2 (uint8)'F'
+
+/** Size of the fragment index and count following the header */
+#define LAN_BEACON_FRAGMENT_HEADER_SIZE 2
+
+/** Response bytes carried by every fragment but the last */
+#define LAN_BEACON_FRAGMENT_PAYLOAD_SIZE (LAN_BEACON_MAX_PACKET_SIZE - LAN_BEACON_PACKET_HEADER_SIZE - LAN_BEACON_FRAGMENT_HEADER_SIZE)
+
+/** Maximum number of fragments a single host response is split into */
+#define LAN_BEACON_MAX_FRAGMENTS 16
+
+/** Largest host response that can be sent, including the header */
+#define LAN_BEACON_MAX_RESPONSE_SIZE (LAN_BEACON_PACKET_HEADER_SIZE + LAN_BEACON_MAX_FRAGMENTS * LAN_BEACON_FRAGMENT_PAYLOAD_SIZE)
+
+/** Number of datagrams pulled from the beacon socket per receive call */
+#define LAN_BEACON_RECEIVE_BATCH_SIZE 32
+
+/** Default maximum number of beacon packets processed in a single tick */
+#define LAN_BEACON_MAX_PACKETS_PER_TICK 256
+
+/** Default group for multicast discovery, from the organization local scope */
+#define LAN_BEACON_MULTICAST_GROUP TEXT("239.255.14.1")
+
+/** Default multicast hop limit, 1 keeps discovery on the local subnet like broadcast does */
+#define LAN_BEACON_MULTICAST_TTL 1
+
+/** Fields of FB3atZBeaconHeader */
+namespace EB3atZBeaconHeaderField
+{
+	enum Type
+	{
+		Version,
+		Platform,
+		GameId,
+		PacketType1,
+		PacketType2,
+		/** Client nonce, or the response id of fragments */
+		Nonce
+	};
+}
+
+/** Header every beacon packet starts with */
+typedef TNboPacketLayout<uint8, uint8, int32, uint8, uint8, uint64> FB3atZBeaconHeader;
+
+/** Payload of pings and pongs: <send time><ping id> */
+typedef TNboPacketLayout<double, int32> FB3atZBeaconPingPayload;
+
+/** Follows the header of fragments: <fragment index><fragment count> */
+typedef TNboPacketLayout<uint8, uint8> FB3atZBeaconFragmentHeader;
+
+// The offsets above are part of the wire format, keep them in sync with the layouts
+static_assert(FB3atZBeaconHeader::Size == LAN_BEACON_PACKET_HEADER_SIZE, "Beacon header size changed");
+static_assert(FB3atZBeaconHeader::TOffset<EB3atZBeaconHeaderField::Version>::Value == LAN_BEACON_VER_OFFSET, "Beacon header layout changed");
+static_assert(FB3atZBeaconHeader::TOffset<EB3atZBeaconHeaderField::Platform>::Value == LAN_BEACON_PLATFORM_OFFSET, "Beacon header layout changed");
+static_assert(FB3atZBeaconHeader::TOffset<EB3atZBeaconHeaderField::GameId>::Value == LAN_BEACON_GAMEID_OFFSET, "Beacon header layout changed");
+static_assert(FB3atZBeaconHeader::TOffset<EB3atZBeaconHeaderField::PacketType1>::Value == LAN_BEACON_PACKETTYPE1_OFFSET, "Beacon header layout changed");
+static_assert(FB3atZBeaconHeader::TOffset<EB3atZBeaconHeaderField::PacketType2>::Value == LAN_BEACON_PACKETTYPE2_OFFSET, "Beacon header layout changed");
+static_assert(FB3atZBeaconHeader::TOffset<EB3atZBeaconHeaderField::Nonce>::Value == LAN_BEACON_NONCE_OFFSET, "Beacon header layout changed");
+static_assert(FB3atZBeaconPingPayload::Size == LAN_BEACON_PING_PAYLOAD_SIZE, "Ping payload size changed");
+static_assert(FB3atZBeaconFragmentHeader::Size == LAN_BEACON_FRAGMENT_HEADER_SIZE, "Fragment header size changed");
+
 class FInternetAddr;
-class FNboSerializeToBuffer;
 
 // LAN Session Delegates
-DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnValidQueryPacket, uint8*, int32, uint64);
+DECLARE_MULTICAST_DELEGATE_FourParams(FOnValidQueryPacket, uint8*, int32, uint64, uint8);
 typedef FOnValidQueryPacket::FDelegate FOnValidQueryPacketDelegate;
 
 DECLARE_MULTICAST_DELEGATE_TwoParams(FOnValidResponsePacket, uint8*, int32);
@@ -49,10 +141,52 @@ typedef FOnValidResponsePacket::FDelegate FOnValidResponsePacketDelegate;
 DECLARE_MULTICAST_DELEGATE(FOnSearchingTimeout);
 typedef FOnSearchingTimeout::FDelegate FOnSearchingTimeoutDelegate;
 
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnPingResponse, int32, double);
+typedef FOnPingResponse::FDelegate FOnPingResponseDelegate;
+
 //LAN Beacon Delegate
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnPortChanged, int32);
 typedef FOnPortChanged::FDelegate FOnPortChangedDelegate;
 
+/**
+ * Reusable set of receive buffers filled by FB3atZBeacon::ReceivePackets
+ */
+struct ONLINESUBSYSTEMB3ATZ_API FB3atZReceiveBatch
+{
+	/** Packet slots of LAN_BEACON_MAX_PACKET_SIZE bytes each */
+	TArray<uint8> Buffer;
+	/** Number of bytes read into each slot */
+	TArray<int32> PacketSizes;
+	/** The address each packet was received from */
+	TArray<TSharedRef<FInternetAddr>> SourceAddrs;
+	/** Number of slots filled by the last receive */
+	int32 NumPackets;
+
+	FB3atZReceiveBatch() :
+		NumPackets(0)
+	{
+	}
+
+	/**
+	 * Allocates the packet slots, does nothing if they already exist
+	 *
+	 * @param Capacity the number of packets that can be received at once
+	 */
+	void Init(int32 Capacity);
+
+	/** @return the number of packet slots */
+	inline int32 GetCapacity() const
+	{
+		return PacketSizes.Num();
+	}
+
+	/** @return the data of the packet in the specified slot */
+	inline uint8* GetPacket(int32 Index)
+	{
+		return &Buffer[Index * LAN_BEACON_MAX_PACKET_SIZE];
+	}
+};
+
 /**
  * Class responsible for sending/receiving UDP broadcasts for LAN match
  * discovery
@@ -67,6 +201,8 @@ class ONLINESUBSYSTEMB3ATZ_API FB3atZBeacon
 	TSharedPtr<class FInternetAddr> ListenAddr;
 	/** Temporary address when receiving packets*/
 	TSharedRef<class FInternetAddr> SockAddr;
+	/** The multicast group joined by InitMulticast, invalid in broadcast and unicast modes */
+	TSharedPtr<class FInternetAddr> MulticastGroupAddr;
 
 public:
 	/** Sets the broadcast address for this object */
@@ -87,6 +223,22 @@ public:
 	*/
 	bool Init(int32 Port);
 
+	/**
+	 * Initializes the socket for LAN discovery through a multicast group instead of
+	 * subnet broadcast. Packets sent with BroadcastPacket go to the group, so only
+	 * machines that joined it process them. IPv6 groups need an IPv6 socket subsystem
+	 *
+	 * @param Port the port to listen on
+	 * @param GroupAddress the IPv4 or IPv6 multicast group to join
+	 * @param Ttl the number of routers multicast packets may cross
+	 *
+	 * @return true if the socket was created and joined the group, false otherwise
+	 */
+	bool InitMulticast(int32 Port, const FString& GroupAddress, int32 Ttl);
+
+	/** Leaves the multicast group joined by InitMulticast, if any */
+	void LeaveMulticastGroup();
+
 	/**
 	 * Initializes the socket for host in online connection
 	 *
@@ -116,6 +268,49 @@ public:
 	 */
 	int32 ReceivePacket(uint8* PacketData, int32 BufferSize);
 
+	/**
+	 * Drains pending datagrams from the socket into the slots of the batch,
+	 * stopping when the socket is empty or the batch is full
+	 *
+	 * @param Batch the buffers to receive into
+	 * @param MaxPackets the maximum number of packets to read (clamped to the batch capacity)
+	 *
+	 * @return the number of packets read
+	 */
+	int32 ReceivePackets(FB3atZReceiveBatch& Batch, int32 MaxPackets);
+
+	/**
+	 * Makes Addr the address BroadcastPacketFromSocket replies to without copying it, so IPv4
+	 * and IPv6 peers are answered alike. Addr receives the previous reply address for reuse
+	 *
+	 * @param Addr the address of the peer to answer, e.g. a slot of FB3atZReceiveBatch::SourceAddrs
+	 */
+	void SwapReplyAddr(TSharedRef<FInternetAddr>& Addr);
+
+	/**
+	 * Copies an address of either family, including its port
+	 *
+	 * @param Addr the address to copy
+	 *
+	 * @return a new address equal to Addr
+	 */
+	static TSharedRef<FInternetAddr> CopyAddr(const FInternetAddr& Addr);
+
+	/** @return the address of the last received packet, which BroadcastPacketFromSocket replies to */
+	const FInternetAddr& GetReplyAddr() const
+	{
+		return *SockAddr;
+	}
+
+	/**
+	 * Sends a packet to a single peer
+	 *
+	 * @param Packet the packet to send
+	 * @param Length the size of the packet to send
+	 * @param Addr the address to send to
+	 */
+	bool SendPacketTo(uint8* Packet, int32 Length, const FInternetAddr& Addr);
+
 	/**
 	 * Uses the cached broadcast address to send packet to a subnet
 	 *
@@ -138,6 +333,25 @@ public:
 #define LAN_ANNOUNCE_PORT 14001
 #define B3atZ_UNIQUE_ID 9999
 #define B3atZ_QUERY_TIMEOUT 5
+#define B3atZ_PING_TIMEOUT 1
+#define B3atZ_MAX_CONCURRENT_PINGS 8
+
+/** Queries per second a single source address may send once its burst is used up */
+#define B3atZ_QUERY_RATE_PER_SOURCE 10.f
+/** Number of queries a single source address may send back to back */
+#define B3atZ_QUERY_BURST_PER_SOURCE 20.f
+/** Pings per second a single source address may send once its burst is used up */
+#define B3atZ_PING_RATE_PER_SOURCE 5.f
+/** Number of pings a single source address may send back to back */
+#define B3atZ_PING_BURST_PER_SOURCE 10.f
+/** Seconds during which queries repeating an answered nonce are coalesced into that answer */
+#define B3atZ_QUERY_COALESCE_WINDOW 0.25
+/** Maximum number of source addresses tracked individually, the rest share one bucket */
+#define B3atZ_MAX_QUERY_SOURCES 1024
+/** Number of fragmented responses a searching client reassembles at the same time */
+#define B3atZ_REASSEMBLY_SLOTS 8
+/** Seconds a partially received response is kept before its slot is reused */
+#define B3atZ_REASSEMBLY_TIMEOUT 1.0
 #define B3atZ_PLATFORMMASK 0xffffffff
 
 /**
@@ -151,10 +365,12 @@ protected:
 	 *
 	 * @param Packet the packet data to check
 	 * @param Length the size of the packet buffer
+	 * @param ClientNonce the client nonce contained within the packet
+	 * @param ClientVersion the packet version the client speaks, to answer in the same format
 	 *
 	 * @return true if the header is valid, false otherwise
 	 */
-	bool IsValidLanQueryPacket(const uint8* Packet, uint32 Length, uint64& ClientNonce);
+	bool IsValidLanQueryPacket(const uint8* Packet, uint32 Length, uint64& ClientNonce, uint8& ClientVersion);
 
 	/**
 	 * Determines if the packet header is valid or not
@@ -166,6 +382,137 @@ protected:
 	 */
 	bool IsValidLanResponsePacket(const uint8* Packet, uint32 Length);
 
+	/**
+	 * Determines if the packet is a ping or pong of this game with a valid payload
+	 *
+	 * @param Packet the packet data to check
+	 * @param Length the size of the packet buffer
+	 * @param PacketType1 first byte of the expected packet type
+	 * @param PacketType2 second byte of the expected packet type
+	 * @param Nonce the nonce contained within the packet
+	 *
+	 * @return true if the header is valid, false otherwise
+	 */
+	bool IsValidLanPingPacket(const uint8* Packet, uint32 Length, uint8 PacketType1, uint8 PacketType2, uint64& Nonce);
+
+	/**
+	 * Applies the per source rate limit and nonce coalescing to a valid query
+	 *
+	 * @param Source the address the query came from
+	 * @param ClientNonce the nonce of the query
+	 *
+	 * @return true if the query should be answered
+	 */
+	bool ShouldAnswerQuery(const FInternetAddr& Source, uint64 ClientNonce);
+
+	/**
+	 * Applies the per source ping rate limit, so spoofed pings can't be reflected at line rate
+	 *
+	 * @param Source the address the ping came from
+	 *
+	 * @return true if the ping should be echoed
+	 */
+	bool ShouldAnswerPing(const FInternetAddr& Source);
+
+	/** Forgets idle sources and expired nonces so the limiter state stays bounded */
+	void PruneQueryLimiter(double Now);
+
+	/** Token bucket of a single query source */
+	struct FQuerySourceBucket
+	{
+		/** Queries that may still be answered right now */
+		float Tokens;
+		/** Time the bucket was last refilled */
+		double LastRefillTime;
+	};
+
+	/**
+	 * Takes a token from the bucket of a source, refilling it for the time since its last packet
+	 *
+	 * @param Buckets the buckets of the packet type
+	 * @param Source the address the packet came from
+	 * @param Rate tokens per second refilled
+	 * @param Burst maximum number of tokens
+	 * @param Now current time
+	 *
+	 * @return false if the source used up its tokens
+	 */
+	static bool ConsumeSourceToken(TMap<FString, FQuerySourceBucket>& Buckets, const FInternetAddr& Source, float Rate, float Burst, double Now);
+
+	/** Forgets the buckets that would have refilled completely */
+	static void PruneSourceBuckets(TMap<FString, FQuerySourceBucket>& Buckets, float Rate, float Burst, double Now);
+
+	/** Rate limit buckets by source address without port, the empty string is shared by sources beyond B3atZ_MAX_QUERY_SOURCES */
+	TMap<FString, FQuerySourceBucket> QuerySourceBuckets;
+
+	/** Ping rate limit buckets, keyed like QuerySourceBuckets */
+	TMap<FString, FQuerySourceBucket> PingSourceBuckets;
+
+	/** Time each recently answered nonce was answered */
+	TMap<uint64, double> AnsweredQueryNonces;
+
+	/** Time the limiter state was last pruned */
+	double LastQueryLimiterPruneTime;
+
+	/**
+	 * Answers a ping by sending it back to its sender as a pong
+	 *
+	 * @param Packet the ping packet including its header, turned into the pong in place
+	 * @param Length the size of the packet
+	 */
+	void EchoPing(uint8* Packet, int32 Length);
+
+	/**
+	 * Determines if the packet is a fragment of a response to our current search
+	 *
+	 * @param Packet the packet data to check
+	 * @param Length the size of the packet buffer
+	 * @param ResponseId the id shared by all fragments of the response
+	 * @param FragmentIndex position of this fragment within the response
+	 * @param FragmentCount number of fragments the response was split into
+	 *
+	 * @return true if the header is valid, false otherwise
+	 */
+	bool IsValidLanFragmentPacket(const uint8* Packet, uint32 Length, uint64& ResponseId, uint8& FragmentIndex, uint8& FragmentCount);
+
+	/**
+	 * Stores a response fragment and passes the response on once all fragments arrived
+	 *
+	 * @param Source the host the fragment came from
+	 * @param ResponseId the id shared by all fragments of the response
+	 * @param FragmentIndex position of this fragment within the response
+	 * @param FragmentCount number of fragments the response was split into
+	 * @param Payload the fragment data following the fragment header
+	 * @param PayloadLength the size of the fragment data
+	 */
+	void ReassembleFragment(const FInternetAddr& Source, uint64 ResponseId, uint8 FragmentIndex, uint8 FragmentCount, const uint8* Payload, int32 PayloadLength);
+
+	/** A response being reassembled from its fragments */
+	struct FReassemblySlot
+	{
+		/** Host and response the fragments belong to */
+		TSharedPtr<FInternetAddr> Source;
+		uint64 ResponseId;
+		/** Number of fragments of the response */
+		uint8 FragmentCount;
+		/** Bit per fragment that has been received */
+		uint32 ReceivedMask;
+		/** Size of the response, known once the last fragment arrived */
+		int32 ResponseLength;
+		/** Time the first fragment arrived */
+		double StartTime;
+		/** Whether the slot holds a partial response */
+		bool bInUse;
+		/** Response payload, allocated once for the largest possible response */
+		TArray<uint8> Buffer;
+	};
+
+	/** Fixed pool of reassembly slots, so a flood of fragments can't grow memory */
+	TArray<FReassemblySlot> ReassemblySlots;
+
+	/** Id of the next fragmented response this host sends */
+	uint32 NextResponseId;
+
 public:
 
 	FDateTime PeepTime;
@@ -208,7 +555,32 @@ public:
 	/** The amount of time before the LAN query is considered done */
 	float B3atZQueryTimeLeft;
 
+	/** Maximum number of packets processed per tick, anything beyond waits for the next tick */
+	int32 MaxPacketsPerTick;
+
+	/** Receive buffers reused across ticks */
+	FB3atZReceiveBatch ReceiveBatch;
+
+	/** Sustained queries per second answered for a single source address */
+	float QueryRatePerSource;
+
+	/** Queries answered back to back for a single source address before the rate applies */
+	float QueryBurstPerSource;
+
+	/** Sustained pings per second echoed for a single source address */
+	float PingRatePerSource;
+
+	/** Pings echoed back to back for a single source address before the rate applies */
+	float PingBurstPerSource;
+
+	/** Totals since hosting started, also reported per frame through STAT_B3atZOnline_LanQueries*. Dropped pings count as dropped queries */
+	uint32 NumQueriesAnswered;
+	uint32 NumQueriesDropped;
+	uint32 NumQueriesCoalesced;
+
 	FB3atZSession() :
+		LastQueryLimiterPruneTime(0.0),
+		NextResponseId(0),
 		LanAnnouncePort(LAN_ANNOUNCE_PORT),
 		LanGameUniqueId(B3atZ_UNIQUE_ID),
 		LanPacketPlatformMask(B3atZ_PLATFORMMASK),
@@ -217,6 +589,14 @@ public:
 		B3atZBeaconState(EB3atZBeaconState::NotUsingB3atZBeacon),
 		B3atZNonce(0),
 		B3atZQueryTimeLeft(0.0f),
+		MaxPacketsPerTick(LAN_BEACON_MAX_PACKETS_PER_TICK),
+		QueryRatePerSource(B3atZ_QUERY_RATE_PER_SOURCE),
+		QueryBurstPerSource(B3atZ_QUERY_BURST_PER_SOURCE),
+		PingRatePerSource(B3atZ_PING_RATE_PER_SOURCE),
+		PingBurstPerSource(B3atZ_PING_BURST_PER_SOURCE),
+		NumQueriesAnswered(0),
+		NumQueriesDropped(0),
+		NumQueriesCoalesced(0),
 		HostSessionAddr(0)
 	{
 	}
@@ -251,10 +631,48 @@ public:
 
 	void Tick(float DeltaTime);
 
+	/**
+	 * Validates a received packet for the current beacon mode and triggers the matching delegates
+	 *
+	 * @param PacketData the packet including its header
+	 * @param PacketLength the size of the packet
+	 */
+	void ProcessPacket(uint8* PacketData, int32 PacketLength);
+
 	/** create packet of MAX size */
-	void CreateHostResponsePacket(FNboSerializeToBuffer& Packet, uint64 ClientNonce);
+	void CreateHostResponsePacket(FNboSerializeToBuffer& Packet, uint64 ClientNonce, uint8 PacketVersion = LAN_BEACON_PACKET_VERSION);
 	void CreateClientQueryPacket(FNboSerializeToBuffer& Packet, uint64 ClientNonce);
 
+	/**
+	 * Overwrites the nonce of an already built host response packet so a
+	 * cached response can be reused for a different client query
+	 *
+	 * @param Packet the response packet, starting with the beacon header
+	 * @param ClientNonce the nonce of the client query being answered
+	 */
+	void SetHostResponsePacketNonce(uint8* Packet, uint64 ClientNonce);
+
+	/**
+	 * Splits a host response too large for a single packet into fragment packets.
+	 * The fragments' nonce slots are filled per query with MakeResponseId
+	 *
+	 * @param Response the full response packet, starting with the beacon header
+	 * @param ResponseLength the size of the response packet
+	 * @param OutFragments receives the fragment packets including their headers
+	 *
+	 * @return false if the response needs more than LAN_BEACON_MAX_FRAGMENTS fragments
+	 */
+	bool CreateHostResponseFragments(const uint8* Response, int32 ResponseLength, TArray<TArray<uint8>>& OutFragments);
+
+	/**
+	 * Creates a new response id for the fragments answering a client query
+	 *
+	 * @param ClientNonce the nonce of the client query being answered
+	 *
+	 * @return the value to write into the nonce slot of each fragment
+	 */
+	uint64 MakeResponseId(uint64 ClientNonce);
+
 	/**
 	 * Uses the cached broadcast address to send packet to a subnet
 	 *
@@ -265,12 +683,30 @@ public:
 
 	bool BroadcastPacketFromSocket(uint8* Packet, int32 Length);
 
+	/**
+	 * Sends a latency probe to a host while searching, the host echoes it back
+	 * and OnPingResponse fires with the measured round trip time
+	 *
+	 * @param HostAddr the beacon address of the host to ping
+	 * @param PingId caller chosen id returned with the response
+	 *
+	 * @return true if the ping was sent
+	 */
+	bool SendPing(const FInternetAddr& HostAddr, int32 PingId);
+
+	/** Counts a query the host sent at least one response to, reported through STAT_B3atZOnline_LanQueriesAnswered */
+	void NotifyQueryAnswered();
+
+	/** @return the address the last processed packet came from, NULL if there is no beacon */
+	const FInternetAddr* GetLastPacketSource() const;
+
 	EB3atZBeaconState::Type GetBeaconState() const
 	{
 		return B3atZBeaconState;
 	}
 
-	DEFINE_ONLINE_DELEGATE_THREE_PARAM(OnValidQueryPacket, uint8*, int32, uint64);
+	DEFINE_ONLINE_DELEGATE_FOUR_PARAM(OnValidQueryPacket, uint8*, int32, uint64, uint8);
 	DEFINE_ONLINE_DELEGATE_TWO_PARAM(OnValidResponsePacket, uint8*, int32);
 	DEFINE_ONLINE_DELEGATE(OnSearchingTimeout);
+	DEFINE_ONLINE_DELEGATE_TWO_PARAM(OnPingResponse, int32, double);
 };
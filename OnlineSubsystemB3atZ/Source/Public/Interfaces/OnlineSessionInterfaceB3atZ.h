@@ -84,6 +84,15 @@ typedef FOnCancelMatchmakingComplete::FDelegate FOnCancelMatchmakingCompleteDele
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnFindSessionsComplete, bool);
 typedef FOnFindSessionsComplete::FDelegate FOnFindSessionsCompleteDelegate;
 
+/**
+ * Delegate fired for each new search result while a search is still in progress
+ * The result has already been added to the search object's SearchResults
+ *
+ * @param SearchResult the search result that just arrived
+ */
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnFindSessionsPartialResult, const FOnlineSessionSearchResult&);
+typedef FOnFindSessionsPartialResult::FDelegate FOnFindSessionsPartialResultDelegate;
+
 /**
  * Delegate fired when the cancellation of a search for an online session has completed
  *
@@ -476,6 +485,14 @@ public:
 	 */
 	DEFINE_ONLINE_DELEGATE_ONE_PARAM(OnFindSessionsComplete, bool);
 
+	/**
+	 * Delegate fired for each new search result while a search is still in progress
+	 * Not all platforms stream results, OnFindSessionsComplete always fires at the end
+	 *
+	 * @param SearchResult the search result that just arrived
+	 */
+	DEFINE_ONLINE_DELEGATE_ONE_PARAM(OnFindSessionsPartialResult, const FOnlineSessionSearchResult&);
+
 	/**
 	 * Find a single advertised session by session id
 	 *
@@ -0,0 +1,165 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NboSerializer.h"
+
+namespace NboPacketLayout
+{
+	/** Offset of field Index, the sum of the sizes of the fields before it */
+	template<uint32 Index, typename... FieldTypes>
+	struct TOffsetOf
+	{
+		static constexpr uint32 Value = 0;
+	};
+
+	template<uint32 Index, typename FirstType, typename... OtherTypes>
+	struct TOffsetOf<Index, FirstType, OtherTypes...>
+	{
+		static constexpr uint32 Value = Index == 0 ? 0 : sizeof(FirstType) + TOffsetOf<(Index == 0 ? 0 : Index - 1), OtherTypes...>::Value;
+	};
+
+	/** Type of field Index */
+	template<uint32 Index, typename FirstType, typename... OtherTypes>
+	struct TFieldType
+	{
+		typedef typename TFieldType<Index - 1, OtherTypes...>::Type Type;
+	};
+
+	template<typename FirstType, typename... OtherTypes>
+	struct TFieldType<0, FirstType, OtherTypes...>
+	{
+		typedef FirstType Type;
+	};
+
+	inline void EncodeFields(uint8* Dest)
+	{
+	}
+
+	/** Stores each value at the end of the previous one, the offsets fold to constants once inlined */
+	template<typename FirstType, typename... OtherTypes>
+	FORCEINLINE void EncodeFields(uint8* Dest, const FirstType& Value, const OtherTypes&... OtherValues)
+	{
+		NboByteOrder::Store(Dest, Value);
+		EncodeFields(Dest + sizeof(FirstType), OtherValues...);
+	}
+
+	inline void DecodeFields(const uint8* Source)
+	{
+	}
+
+	template<typename FirstType, typename... OtherTypes>
+	FORCEINLINE void DecodeFields(const uint8* Source, FirstType& OutValue, OtherTypes&... OutOtherValues)
+	{
+		OutValue = NboByteOrder::Load<FirstType>(Source);
+		DecodeFields(Source + sizeof(FirstType), OutOtherValues...);
+	}
+}
+
+/**
+ * Fixed size packet layout declared once as the list of its field types, in wire order and
+ * network byte order. Encoding and decoding check the size once for the whole layout and
+ * store every field at an offset known at compile time, and single fields can be read or
+ * patched in place. Pair the layout with static_asserts on Size and TOffset so that a
+ * format change that isn't made everywhere fails to compile:
+ *
+ *	typedef TNboPacketLayout<uint8, int32, uint64> FMyHeader;
+ *	static_assert(FMyHeader::TOffset<2>::Value == MY_NONCE_OFFSET, "Nonce moved");
+ */
+template<typename... FieldTypes>
+struct TNboPacketLayout
+{
+	/** Number of fields */
+	static constexpr uint32 NumFields = sizeof...(FieldTypes);
+
+	/** Number of bytes the layout takes on the wire */
+	static constexpr uint32 Size = NboPacketLayout::TOffsetOf<sizeof...(FieldTypes), FieldTypes...>::Value;
+
+	/** Offset of field Index from the start of the layout */
+	template<uint32 Index>
+	struct TOffset
+	{
+		static_assert(Index < sizeof...(FieldTypes), "Field index out of range");
+		static constexpr uint32 Value = NboPacketLayout::TOffsetOf<Index, FieldTypes...>::Value;
+	};
+
+	/** Type of field Index */
+	template<uint32 Index>
+	struct TField
+	{
+		static_assert(Index < sizeof...(FieldTypes), "Field index out of range");
+		typedef typename NboPacketLayout::TFieldType<Index, FieldTypes...>::Type Type;
+	};
+
+	/**
+	 * Writes all fields without any checks
+	 *
+	 * @param Dest where to write, at least Size bytes
+	 * @param Values the value of every field
+	 */
+	static FORCEINLINE void Encode(uint8* Dest, FieldTypes... Values)
+	{
+		NboPacketLayout::EncodeFields(Dest, Values...);
+	}
+
+	/**
+	 * Reads all fields without any checks
+	 *
+	 * @param Source where to read, at least Size bytes
+	 * @param OutValues receive the value of every field
+	 */
+	static FORCEINLINE void Decode(const uint8* Source, FieldTypes&... OutValues)
+	{
+		NboPacketLayout::DecodeFields(Source, OutValues...);
+	}
+
+	/**
+	 * Appends all fields with a single bounds check
+	 *
+	 * @param Ar the buffer to append to
+	 * @param Values the value of every field
+	 * @return false if the buffer overflowed
+	 */
+	static inline bool Write(FNboSerializeToBuffer& Ar, FieldTypes... Values)
+	{
+		if (uint8* Dest = Ar.WriteUninitialized(Size))
+		{
+			Encode(Dest, Values...);
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Reads all fields with a single bounds check
+	 *
+	 * @param Ar the buffer to read from
+	 * @param OutValues receive the value of every field, untouched on overflow
+	 * @return false if the buffer overflowed
+	 */
+	static inline bool Read(FNboSerializeFromBuffer& Ar, FieldTypes&... OutValues)
+	{
+		if (const uint8* Source = Ar.ReadInPlace(Size))
+		{
+			Decode(Source, OutValues...);
+			return true;
+		}
+		return false;
+	}
+
+	/** @return field Index of the layout at Source */
+	template<uint32 Index>
+	static FORCEINLINE typename TField<Index>::Type Get(const uint8* Source)
+	{
+		return NboByteOrder::Load<typename TField<Index>::Type>(Source + TOffset<Index>::Value);
+	}
+
+	/** Overwrites field Index of the layout at Dest */
+	template<uint32 Index>
+	static FORCEINLINE void Set(uint8* Dest, typename TField<Index>::Type Value)
+	{
+		NboByteOrder::Store(Dest + TOffset<Index>::Value, Value);
+	}
+};
@@ -9,8 +9,489 @@
 #include "OnlineKeyValuePair.h"
 #include "IPAddress.h"
 
+/** Whether arrays are byte swapped with SSE2, which every x86-64 CPU has */
+#if PLATFORM_LITTLE_ENDIAN && PLATFORM_ENABLE_VECTORINTRINSICS && (defined(_M_X64) || defined(__x86_64__))
+	#define NBO_SWAP_WITH_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define NBO_SWAP_WITH_SSE2 0
+#endif
+
+/** How a FNboSerializeToBuffer deals with running out of space */
+namespace ENboWriteMode
+{
+	enum Type
+	{
+		/** Writes past the size fail and set the overflow flag, as packets of a fixed maximum size need */
+		Fixed,
+		/** The buffer doubles when it runs out of space, only owned buffers can grow */
+		Growable
+	};
+}
+
 /**
- * Serializes data in network byte order form into a buffer
+ * UTF-8 conversion straight between TCHARs and packet bytes, without the temporaries of
+ * FTCHARToUTF8 and FUTF8ToTCHAR. Invalid input becomes '?' as with the engine converters
+ */
+namespace NboUtf8
+{
+	/** Replacement for characters that can't be converted */
+	const uint32 BogusChar = '?';
+
+	/**
+	 * Reads the code point at Chars, combining surrogate pairs where TCHAR is UTF-16
+	 *
+	 * @param Chars the character to read, advanced past it
+	 * @param End one past the last character
+	 */
+	FORCEINLINE uint32 ReadCodepoint(const TCHAR*& Chars, const TCHAR* End)
+	{
+		uint32 Codepoint = (uint32)*Chars++;
+		if (sizeof(TCHAR) == 2 && Codepoint >= 0xD800 && Codepoint <= 0xDFFF)
+		{
+			if (Codepoint <= 0xDBFF && Chars < End && (uint32)*Chars >= 0xDC00 && (uint32)*Chars <= 0xDFFF)
+			{
+				Codepoint = 0x10000 + ((Codepoint - 0xD800) << 10) + ((uint32)*Chars++ - 0xDC00);
+			}
+			else
+			{
+				Codepoint = BogusChar;
+			}
+		}
+		else if (Codepoint > 0x10FFFF || (Codepoint >= 0xD800 && Codepoint <= 0xDFFF))
+		{
+			Codepoint = BogusChar;
+		}
+		return Codepoint;
+	}
+
+	/** @return the number of bytes the code point takes as UTF-8 */
+	FORCEINLINE int32 CodepointLength(uint32 Codepoint)
+	{
+		return Codepoint < 0x80 ? 1 : Codepoint < 0x800 ? 2 : Codepoint < 0x10000 ? 3 : 4;
+	}
+
+	/**
+	 * Writes a code point as UTF-8
+	 *
+	 * @param Codepoint a valid code point
+	 * @param Dest where to write, at least CodepointLength bytes
+	 * @return the number of bytes written
+	 */
+	FORCEINLINE int32 EncodeCodepoint(uint32 Codepoint, uint8* Dest)
+	{
+		if (Codepoint < 0x80)
+		{
+			Dest[0] = (uint8)Codepoint;
+			return 1;
+		}
+		if (Codepoint < 0x800)
+		{
+			Dest[0] = (uint8)(0xC0 | (Codepoint >> 6));
+			Dest[1] = (uint8)(0x80 | (Codepoint & 0x3F));
+			return 2;
+		}
+		if (Codepoint < 0x10000)
+		{
+			Dest[0] = (uint8)(0xE0 | (Codepoint >> 12));
+			Dest[1] = (uint8)(0x80 | ((Codepoint >> 6) & 0x3F));
+			Dest[2] = (uint8)(0x80 | (Codepoint & 0x3F));
+			return 3;
+		}
+		Dest[0] = (uint8)(0xF0 | (Codepoint >> 18));
+		Dest[1] = (uint8)(0x80 | ((Codepoint >> 12) & 0x3F));
+		Dest[2] = (uint8)(0x80 | ((Codepoint >> 6) & 0x3F));
+		Dest[3] = (uint8)(0x80 | (Codepoint & 0x3F));
+		return 4;
+	}
+
+	/** @return the number of bytes Encode writes for the characters */
+	inline int32 EncodedLength(const TCHAR* Chars, int32 NumChars)
+	{
+		const TCHAR* End = Chars + NumChars;
+		int32 Length = 0;
+		while (Chars < End)
+		{
+			if ((uint32)*Chars < 0x80)
+			{
+				Chars++;
+				Length++;
+			}
+			else
+			{
+				Length += CodepointLength(ReadCodepoint(Chars, End));
+			}
+		}
+		return Length;
+	}
+
+	/**
+	 * Encodes characters as UTF-8
+	 *
+	 * @param Chars the characters to encode
+	 * @param NumChars the number of characters
+	 * @param Dest where to write, EncodedLength bytes
+	 */
+	inline void Encode(const TCHAR* Chars, int32 NumChars, uint8* Dest)
+	{
+		const TCHAR* End = Chars + NumChars;
+		while (Chars < End)
+		{
+			if ((uint32)*Chars < 0x80)
+			{
+				*Dest++ = (uint8)*Chars++;
+			}
+			else
+			{
+				Dest += EncodeCodepoint(ReadCodepoint(Chars, End), Dest);
+			}
+		}
+	}
+
+	/**
+	 * Decodes UTF-8 up to the first null byte, as the null terminated engine conversion did
+	 *
+	 * @param Bytes the UTF-8 to decode
+	 * @param NumBytes the number of bytes
+	 * @param Dest where to write, room for NumBytes characters is always enough
+	 * @return the number of characters written
+	 */
+	inline int32 Decode(const uint8* Bytes, int32 NumBytes, TCHAR* Dest)
+	{
+		const uint8* End = Bytes + NumBytes;
+		TCHAR* Start = Dest;
+		while (Bytes < End)
+		{
+			const uint32 Lead = *Bytes;
+			if (Lead < 0x80)
+			{
+				if (Lead == 0)
+				{
+					break;
+				}
+				*Dest++ = (TCHAR)Lead;
+				Bytes++;
+				continue;
+			}
+
+			const int32 Length = Lead >= 0xF0 ? 4 : Lead >= 0xE0 ? 3 : Lead >= 0xC0 ? 2 : 0;
+			uint32 Codepoint = BogusChar;
+			int32 Consumed = 1;
+			if (Length > 0 && Lead < 0xF8 && End - Bytes >= Length)
+			{
+				uint32 Value = Lead & (0x7F >> Length);
+				int32 Index = 1;
+				for (; Index < Length && (Bytes[Index] & 0xC0) == 0x80; Index++)
+				{
+					Value = (Value << 6) | (Bytes[Index] & 0x3F);
+				}
+				// Reject truncated and overlong sequences, surrogates and values past the Unicode range
+				if (Index == Length && CodepointLength(Value) == Length && Value <= 0x10FFFF && (Value < 0xD800 || Value > 0xDFFF))
+				{
+					Codepoint = Value;
+					Consumed = Length;
+				}
+			}
+			Bytes += Consumed;
+
+			if (sizeof(TCHAR) == 2 && Codepoint >= 0x10000)
+			{
+				Codepoint -= 0x10000;
+				*Dest++ = (TCHAR)(0xD800 + (Codepoint >> 10));
+				*Dest++ = (TCHAR)(0xDC00 + (Codepoint & 0x3FF));
+			}
+			else
+			{
+				*Dest++ = (TCHAR)Codepoint;
+			}
+		}
+		return (int32)(Dest - Start);
+	}
+
+	/**
+	 * Decodes UTF-8 into a string, reusing its allocation
+	 *
+	 * @param Bytes the UTF-8 to decode
+	 * @param NumBytes the number of bytes
+	 * @param OutString the string to replace
+	 */
+	inline void DecodeToString(const uint8* Bytes, int32 NumBytes, FString& OutString)
+	{
+		TArray<TCHAR>& Chars = OutString.GetCharArray();
+		if (NumBytes <= 0)
+		{
+			Chars.Reset();
+			return;
+		}
+		Chars.SetNumUninitialized(NumBytes + 1, false);
+		const int32 NumChars = Decode(Bytes, NumBytes, Chars.GetData());
+		if (NumChars == 0)
+		{
+			Chars.Reset();
+			return;
+		}
+		Chars[NumChars] = 0;
+		Chars.SetNum(NumChars + 1, false);
+	}
+
+	/**
+	 * Finds or adds the name for UTF-8 bytes. ASCII names, which nearly all keys are, go to
+	 * the name table as ANSI straight from a stack copy, others are decoded on the stack
+	 *
+	 * @param Bytes the UTF-8 of the name, with an optional _Number suffix
+	 * @param NumBytes the number of bytes
+	 * @param FindType FNAME_Find to only look up names that already exist, NAME_None otherwise
+	 */
+	inline FName ToName(const uint8* Bytes, int32 NumBytes, EFindName FindType = FNAME_Add)
+	{
+		if (NumBytes <= 0)
+		{
+			return NAME_None;
+		}
+		if (NumBytes < NAME_SIZE)
+		{
+			bool bIsAnsi = true;
+			for (int32 Index = 0; Index < NumBytes && bIsAnsi; Index++)
+			{
+				bIsAnsi = Bytes[Index] < 0x80;
+			}
+			if (bIsAnsi)
+			{
+				ANSICHAR AnsiName[NAME_SIZE];
+				FMemory::Memcpy(AnsiName, Bytes, NumBytes);
+				AnsiName[NumBytes] = '\0';
+				return FName(AnsiName, FindType);
+			}
+			TCHAR WideName[NAME_SIZE];
+			WideName[Decode(Bytes, NumBytes, WideName)] = 0;
+			return FName(WideName, FindType);
+		}
+		// Longer than any name can be, let FName deal with it the usual way
+		FString NameString;
+		DecodeToString(Bytes, NumBytes, NameString);
+		return FName(*NameString, FindType);
+	}
+}
+
+/**
+ * Conversion of contiguous numbers between host and network byte order, for WriteArray and ReadArray
+ */
+namespace NboByteOrder
+{
+	/** Unsigned word of each element size */
+	template<uint32 ElementSize> struct TWord;
+	template<> struct TWord<1> { typedef uint8 Type; };
+	template<> struct TWord<2> { typedef uint16 Type; };
+	template<> struct TWord<4> { typedef uint32 Type; };
+	template<> struct TWord<8> { typedef uint64 Type; };
+
+	FORCEINLINE uint8 Swap(uint8 Value)
+	{
+		return Value;
+	}
+
+	FORCEINLINE uint16 Swap(uint16 Value)
+	{
+		return (uint16)((Value << 8) | (Value >> 8));
+	}
+
+	FORCEINLINE uint32 Swap(uint32 Value)
+	{
+		return (Value >> 24) | ((Value >> 8) & 0xFF00) | ((Value << 8) & 0xFF0000) | (Value << 24);
+	}
+
+	FORCEINLINE uint64 Swap(uint64 Value)
+	{
+		return ((uint64)Swap((uint32)Value) << 32) | Swap((uint32)(Value >> 32));
+	}
+
+#if NBO_SWAP_WITH_SSE2
+	/** Reverses the bytes of each element in 16 bytes */
+	template<uint32 ElementSize>
+	FORCEINLINE __m128i SwapVector(__m128i Vector)
+	{
+		// Reverse the 16 bit words of each element first, then the bytes of each word
+		if (ElementSize == 4)
+		{
+			Vector = _mm_shufflelo_epi16(Vector, _MM_SHUFFLE(2, 3, 0, 1));
+			Vector = _mm_shufflehi_epi16(Vector, _MM_SHUFFLE(2, 3, 0, 1));
+		}
+		else if (ElementSize == 8)
+		{
+			Vector = _mm_shufflelo_epi16(Vector, _MM_SHUFFLE(0, 1, 2, 3));
+			Vector = _mm_shufflehi_epi16(Vector, _MM_SHUFFLE(0, 1, 2, 3));
+		}
+		return _mm_or_si128(_mm_slli_epi16(Vector, 8), _mm_srli_epi16(Vector, 8));
+	}
+#endif
+
+	/**
+	 * Copies elements reversing the bytes of each
+	 *
+	 * @param Dest where to write Count elements, must not overlap Source
+	 * @param Source the elements to copy
+	 * @param Count the number of elements
+	 */
+	template<uint32 ElementSize>
+	inline void CopySwapped(uint8* Dest, const uint8* Source, int32 Count)
+	{
+		typedef typename TWord<ElementSize>::Type WordType;
+		int32 Index = 0;
+#if NBO_SWAP_WITH_SSE2
+		const int32 PerVector = 16 / ElementSize;
+		for (; Index + 2 * PerVector <= Count; Index += 2 * PerVector)
+		{
+			const __m128i First = _mm_loadu_si128((const __m128i*)(Source + Index * ElementSize));
+			const __m128i Second = _mm_loadu_si128((const __m128i*)(Source + Index * ElementSize + 16));
+			_mm_storeu_si128((__m128i*)(Dest + Index * ElementSize), SwapVector<ElementSize>(First));
+			_mm_storeu_si128((__m128i*)(Dest + Index * ElementSize + 16), SwapVector<ElementSize>(Second));
+		}
+#endif
+		for (; Index < Count; Index++)
+		{
+			WordType Word;
+			FMemory::Memcpy(&Word, Source + Index * ElementSize, ElementSize);
+			Word = Swap(Word);
+			FMemory::Memcpy(Dest + Index * ElementSize, &Word, ElementSize);
+		}
+	}
+
+	/**
+	 * Copies elements between host and network byte order, which is the same operation both ways
+	 *
+	 * @param Dest where to write Count elements, must not overlap Source
+	 * @param Source the elements to copy
+	 * @param Count the number of elements
+	 */
+	template<typename ElementType>
+	inline void Copy(uint8* Dest, const uint8* Source, int32 Count)
+	{
+		static_assert(TIsArithmetic<ElementType>::Value || TIsEnum<ElementType>::Value, "Only numbers and enums can be copied in bulk");
+		static_assert(sizeof(ElementType) == 1 || sizeof(ElementType) == 2 || sizeof(ElementType) == 4 || sizeof(ElementType) == 8, "Unsupported element size");
+
+		// Host order already is network order for bytes and on big endian hosts
+		if (sizeof(ElementType) == 1 || !PLATFORM_LITTLE_ENDIAN)
+		{
+			FMemory::Memcpy(Dest, Source, Count * sizeof(ElementType));
+		}
+		else
+		{
+			CopySwapped<sizeof(ElementType) == 1 ? 2 : sizeof(ElementType)>(Dest, Source, Count);
+		}
+	}
+
+	/** Writes a single number or enum in network byte order to unaligned memory */
+	template<typename ValueType>
+	FORCEINLINE void Store(uint8* Dest, ValueType Value)
+	{
+		static_assert(TIsArithmetic<ValueType>::Value || TIsEnum<ValueType>::Value, "Only numbers and enums can be stored");
+		typedef typename TWord<sizeof(ValueType)>::Type WordType;
+		WordType Word;
+		FMemory::Memcpy(&Word, &Value, sizeof(Word));
+		if (PLATFORM_LITTLE_ENDIAN)
+		{
+			Word = Swap(Word);
+		}
+		FMemory::Memcpy(Dest, &Word, sizeof(Word));
+	}
+
+	/** @return a single number or enum read in network byte order from unaligned memory */
+	template<typename ValueType>
+	FORCEINLINE ValueType Load(const uint8* Source)
+	{
+		static_assert(TIsArithmetic<ValueType>::Value || TIsEnum<ValueType>::Value, "Only numbers and enums can be loaded");
+		typedef typename TWord<sizeof(ValueType)>::Type WordType;
+		WordType Word;
+		FMemory::Memcpy(&Word, Source, sizeof(Word));
+		if (PLATFORM_LITTLE_ENDIAN)
+		{
+			Word = Swap(Word);
+		}
+		ValueType Value;
+		FMemory::Memcpy(&Value, &Word, sizeof(Value));
+		return Value;
+	}
+}
+
+/**
+ * UTF-8 string still in the packet it was read from, for comparing keys without converting them.
+ * Only valid as long as the packet buffer is
+ */
+struct FNboStringView
+{
+	/** First byte of the string in the packet */
+	const uint8* Data;
+	/** Number of bytes of the string */
+	int32 NumBytes;
+
+	FNboStringView()
+		: Data(nullptr)
+		, NumBytes(0)
+	{
+	}
+
+	FNboStringView(const uint8* InData, int32 InNumBytes)
+		: Data(InData)
+		, NumBytes(InNumBytes)
+	{
+	}
+
+	/** @return true if the string has no characters */
+	inline bool IsEmpty() const
+	{
+		return NumBytes == 0;
+	}
+
+	/** @return true if the bytes match the null terminated UTF-8 or ASCII string exactly */
+	inline bool Equals(const ANSICHAR* Other) const
+	{
+		const int32 OtherLen = FCStringAnsi::Strlen(Other);
+		return OtherLen == NumBytes && FMemory::Memcmp(Data, Other, NumBytes) == 0;
+	}
+
+	/** @return true if the string matches the characters exactly, encoding them as it goes */
+	inline bool Equals(const TCHAR* Other) const
+	{
+		const TCHAR* End = Other + FCString::Strlen(Other);
+		int32 Offset = 0;
+		while (Other < End)
+		{
+			uint8 Encoded[4];
+			const int32 Length = NboUtf8::EncodeCodepoint(NboUtf8::ReadCodepoint(Other, End), Encoded);
+			if (Offset + Length > NumBytes || FMemory::Memcmp(Data + Offset, Encoded, Length) != 0)
+			{
+				return false;
+			}
+			Offset += Length;
+		}
+		return Offset == NumBytes;
+	}
+
+	/** @return the string decoded */
+	inline FString ToString() const
+	{
+		FString Result;
+		NboUtf8::DecodeToString(Data, NumBytes, Result);
+		return Result;
+	}
+
+	/** @return the name with this string, added to the name table if needed */
+	inline FName ToName() const
+	{
+		return NboUtf8::ToName(Data, NumBytes);
+	}
+
+	/** @return the name with this string if the name table has it, NAME_None otherwise. Use for untrusted input */
+	inline FName FindName() const
+	{
+		return NboUtf8::ToName(Data, NumBytes, FNAME_Find);
+	}
+};
+
+/**
+ * Serializes data in network byte order form into a buffer.
+ * The buffer is either owned or supplied by the caller, e.g. on the stack, and is never
+ * zero filled: only the first GetByteCount() bytes hold data
  */
 class FNboSerializeToBuffer
 {
@@ -19,9 +500,17 @@ class FNboSerializeToBuffer
 
 protected:
 	/**
-	 * Holds the data as it is serialized
+	 * Holds the data as it is serialized, unused when writing to an external buffer
 	 */
 	TArray<uint8> Data;
+	/**
+	 * Where the data is written, Data or the external buffer
+	 */
+	uint8* Buffer;
+	/**
+	 * Number of bytes that can be written to Buffer
+	 */
+	uint32 Capacity;
 	/**
 	 * Tracks how many bytes have been written in the packet
 	 */
@@ -30,16 +519,148 @@ protected:
 	/** Indicates whether writing to the buffer caused an overflow or not */
 	bool bHasOverflowed;
 
+	/** Whether Buffer points at Data, which may grow */
+	bool bIsOwned;
+
+	/** Whether the buffer doubles instead of overflowing */
+	bool bCanGrow;
+
+	/**
+	 * Makes room for a write, the only bounds check of each primitive
+	 *
+	 * @param Count the number of bytes about to be written
+	 * @return where to write them, nullptr once the buffer has overflowed
+	 */
+	FORCEINLINE uint8* BeginWrite(uint32 Count)
+	{
+		if (!bHasOverflowed && NumBytes + Count <= Capacity)
+		{
+			return Buffer + NumBytes;
+		}
+		return GrowForWrite(Count);
+	}
+
+	/** Slow path of BeginWrite, grows a growable buffer or flags the overflow */
+	uint8* GrowForWrite(uint32 Count)
+	{
+		if (!bHasOverflowed && bCanGrow)
+		{
+			const uint32 NewCapacity = FMath::Max<uint32>(FMath::Max<uint32>(Capacity * 2, 64), NumBytes + Count);
+			Data.SetNumUninitialized(NewCapacity, false);
+			Buffer = Data.GetData();
+			Capacity = NewCapacity;
+			return Buffer + NumBytes;
+		}
+		bHasOverflowed = true;
+		return nullptr;
+	}
+
+	/** Points Buffer back at Data after Data was copied or moved */
+	void RebaseOwnedBuffer()
+	{
+		if (bIsOwned)
+		{
+			Buffer = Data.GetData();
+		}
+	}
+
 public:
 	/**
-	 * Inits the write tracking
+	 * Inits the write tracking with an owned buffer
+	 *
+	 * @param Size the number of bytes to allocate up front
+	 * @param Mode whether writes past Size overflow or grow the buffer
 	 */
-	FNboSerializeToBuffer(uint32 Size) :
+	FNboSerializeToBuffer(uint32 Size, ENboWriteMode::Type Mode = ENboWriteMode::Fixed) :
+		Buffer(nullptr),
+		Capacity(Size),
 		NumBytes(0),
-		bHasOverflowed(false)
+		bHasOverflowed(false),
+		bIsOwned(true),
+		bCanGrow(Mode == ENboWriteMode::Growable)
 	{
 		Data.Empty(Size);
-		Data.AddZeroed(Size);
+		Data.AddUninitialized(Size);
+		Buffer = Data.GetData();
+	}
+
+	/**
+	 * Inits the write tracking with a buffer owned by the caller, such as a stack array.
+	 * The buffer must outlive the serializer and is never grown
+	 *
+	 * @param ExternalBuffer the memory to write to
+	 * @param Size the number of bytes that can be written to it
+	 */
+	FNboSerializeToBuffer(uint8* ExternalBuffer, uint32 Size) :
+		Buffer(ExternalBuffer),
+		Capacity(Size),
+		NumBytes(0),
+		bHasOverflowed(false),
+		bIsOwned(false),
+		bCanGrow(false)
+	{
+	}
+
+	FNboSerializeToBuffer(const FNboSerializeToBuffer& Other) :
+		Data(Other.Data),
+		Buffer(Other.Buffer),
+		Capacity(Other.Capacity),
+		NumBytes(Other.NumBytes),
+		bHasOverflowed(Other.bHasOverflowed),
+		bIsOwned(Other.bIsOwned),
+		bCanGrow(Other.bCanGrow)
+	{
+		RebaseOwnedBuffer();
+	}
+
+	FNboSerializeToBuffer(FNboSerializeToBuffer&& Other) :
+		Data(MoveTemp(Other.Data)),
+		Buffer(Other.Buffer),
+		Capacity(Other.Capacity),
+		NumBytes(Other.NumBytes),
+		bHasOverflowed(Other.bHasOverflowed),
+		bIsOwned(Other.bIsOwned),
+		bCanGrow(Other.bCanGrow)
+	{
+		RebaseOwnedBuffer();
+		Other.Buffer = nullptr;
+		Other.Capacity = 0;
+		Other.NumBytes = 0;
+	}
+
+	FNboSerializeToBuffer& operator=(const FNboSerializeToBuffer& Other)
+	{
+		if (this != &Other)
+		{
+			Data = Other.Data;
+			Buffer = Other.Buffer;
+			Capacity = Other.Capacity;
+			NumBytes = Other.NumBytes;
+			bHasOverflowed = Other.bHasOverflowed;
+			bIsOwned = Other.bIsOwned;
+			bCanGrow = Other.bCanGrow;
+			RebaseOwnedBuffer();
+		}
+		return *this;
+	}
+
+	FNboSerializeToBuffer& operator=(FNboSerializeToBuffer&& Other)
+	{
+		if (this != &Other)
+		{
+			Data = MoveTemp(Other.Data);
+			Buffer = Other.Buffer;
+			Capacity = Other.Capacity;
+			NumBytes = Other.NumBytes;
+			bHasOverflowed = Other.bHasOverflowed;
+			bIsOwned = Other.bIsOwned;
+			bCanGrow = Other.bCanGrow;
+			RebaseOwnedBuffer();
+			Other.Buffer = nullptr;
+			Other.Capacity = 0;
+			Other.NumBytes = 0;
+		}
+		return *this;
 	}
 
 	/**
@@ -47,14 +668,16 @@ public:
 	 */
 	inline operator uint8*(void) const
 	{
-		return (uint8*)Data.GetData();
+		return Buffer;
 	}
 
 	/**
-	 * Cast operator to get at the formatted buffer data
+	 * Cast operator to get at the formatted buffer data, only valid for owned buffers.
+	 * Holds GetBufferSize() bytes, of which only the first GetByteCount() were written unless trimmed
 	 */
 	inline const TArray<uint8>& GetBuffer(void) const
 	{
+		checkf(bIsOwned, TEXT("GetBuffer needs an owned buffer, use GetRawBuffer for external buffers"));
 		return Data;
 	}
 
@@ -67,11 +690,11 @@ public:
 	}
 
 	/**
-	 * Returns the number of bytes preallocated in the array
+	 * Returns the number of bytes preallocated in the buffer
 	 */
 	inline uint32 GetBufferSize(void) const
 	{
-		return (uint32)Data.Num();
+		return Capacity;
 	}
 
 	/**
@@ -81,7 +704,12 @@ public:
 	{
 		if (GetBufferSize() > GetByteCount())
 		{
-			Data.RemoveAt(GetByteCount(), GetBufferSize()-GetByteCount());
+			if (bIsOwned)
+			{
+				Data.RemoveAt(GetByteCount(), GetBufferSize()-GetByteCount());
+				Buffer = Data.GetData();
+			}
+			Capacity = NumBytes;
 		}
 	}
 
@@ -90,13 +718,10 @@ public:
 	 */
 	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const char Ch)
 	{
-		if (!Ar.HasOverflow() && Ar.NumBytes + 1 <= Ar.GetBufferSize())
-		{
-			Ar.Data[Ar.NumBytes++] = Ch;
-		}
-		else
+		if (uint8* Ptr = Ar.BeginWrite(1))
 		{
-			Ar.bHasOverflowed = true;
+			*Ptr = Ch;
+			Ar.NumBytes++;
 		}
 
 		return Ar;
@@ -107,13 +732,10 @@ public:
 	 */
 	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const uint8& B)
 	{
-		if (!Ar.HasOverflow() && Ar.NumBytes + 1 <= Ar.GetBufferSize())
-		{
-			Ar.Data[Ar.NumBytes++] = B;
-		}
-		else
+		if (uint8* Ptr = Ar.BeginWrite(1))
 		{
-			Ar.bHasOverflowed = true;
+			*Ptr = B;
+			Ar.NumBytes++;
 		}
 
 		return Ar;
@@ -141,18 +763,14 @@ public:
 	 */
 	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const uint32& D)
 	{
-		if (!Ar.HasOverflow() && Ar.NumBytes + 4 <= Ar.GetBufferSize())
+		if (uint8* Ptr = Ar.BeginWrite(4))
 		{
-			Ar.Data[Ar.NumBytes + 0] = (D >> 24) & 0xFF;
-			Ar.Data[Ar.NumBytes + 1] = (D >> 16) & 0xFF;
-			Ar.Data[Ar.NumBytes + 2] = (D >> 8) & 0xFF;
-			Ar.Data[Ar.NumBytes + 3] = D & 0xFF;
+			Ptr[0] = (D >> 24) & 0xFF;
+			Ptr[1] = (D >> 16) & 0xFF;
+			Ptr[2] = (D >> 8) & 0xFF;
+			Ptr[3] = D & 0xFF;
 			Ar.NumBytes += 4;
 		}
-		else
-		{
-			Ar.bHasOverflowed = true;
-		}
 
 		return Ar;
 	}
@@ -162,22 +780,18 @@ public:
 	 */
 	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const uint64& Q)
 	{
-		if (!Ar.HasOverflow() && Ar.NumBytes + 8 <= Ar.GetBufferSize())
+		if (uint8* Ptr = Ar.BeginWrite(8))
 		{
-			Ar.Data[Ar.NumBytes + 0] = (Q >> 56) & 0xFF;
-			Ar.Data[Ar.NumBytes + 1] = (Q >> 48) & 0xFF;
-			Ar.Data[Ar.NumBytes + 2] = (Q >> 40) & 0xFF;
-			Ar.Data[Ar.NumBytes + 3] = (Q >> 32) & 0xFF;
-			Ar.Data[Ar.NumBytes + 4] = (Q >> 24) & 0xFF;
-			Ar.Data[Ar.NumBytes + 5] = (Q >> 16) & 0xFF;
-			Ar.Data[Ar.NumBytes + 6] = (Q >> 8) & 0xFF;
-			Ar.Data[Ar.NumBytes + 7] = Q & 0xFF;
+			Ptr[0] = (Q >> 56) & 0xFF;
+			Ptr[1] = (Q >> 48) & 0xFF;
+			Ptr[2] = (Q >> 40) & 0xFF;
+			Ptr[3] = (Q >> 32) & 0xFF;
+			Ptr[4] = (Q >> 24) & 0xFF;
+			Ptr[5] = (Q >> 16) & 0xFF;
+			Ptr[6] = (Q >> 8) & 0xFF;
+			Ptr[7] = Q & 0xFF;
 			Ar.NumBytes += 8;
 		}
-		else
-		{
-			Ar.bHasOverflowed = true;
-		}
 
 		return Ar;
 	}
@@ -206,28 +820,7 @@ public:
 	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const FString& String)
 	{
 		// We send strings length prefixed
-		FTCHARToUTF8 Converted(*String);
-		int32 Len = Converted.Length();
-
-		Ar << Len;
-
-		if (!Ar.HasOverflow() && Ar.NumBytes + Len <= Ar.GetBufferSize())
-		{
-			// Handle empty strings
-			if (Len > 0)
-			{
-				ANSICHAR* Ptr = (ANSICHAR*)Converted.Get();
-
-				// memcpy it into the buffer
-				FMemory::Memcpy(&Ar.Data[Ar.NumBytes], Ptr,Len);
-				Ar.NumBytes += Len;
-			}
-		}
-		else
-		{
-			Ar.bHasOverflowed = true;
-		}
-
+		Ar.WriteUtf8(*String, String.Len());
 		return Ar;
 	}
 
@@ -236,29 +829,8 @@ public:
 	 */
 	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const TCHAR* String)
 	{
-		// We send strings length prefixed (conversion handles null pointers)
-		FTCHARToUTF8 Converted(String);
-		int32 Len = Converted.Length();
-
-		Ar << Len;
-
-		if (!Ar.HasOverflow() && Ar.NumBytes + Len <= Ar.GetBufferSize())
-		{
-			// Handle empty/null strings
-			if (Len > 0)
-			{
-				ANSICHAR* Ptr = (ANSICHAR*)Converted.Get();
-
-				// memcpy it into the buffer
-				FMemory::Memcpy(&Ar.Data[Ar.NumBytes], Ptr, Len);
-				Ar.NumBytes += Len;
-			}
-		}
-		else
-		{
-			Ar.bHasOverflowed = true;
-		}
-
+		// We send strings length prefixed, null strings as empty ones
+		Ar.WriteUtf8(String, String ? FCString::Strlen(String) : 0);
 		return Ar;
 	}
 
@@ -271,19 +843,13 @@ public:
 		int32 Len = Length;
 		(*this) << Len;
 
-		if (!HasOverflow() && NumBytes + Len <= GetBufferSize())
-		{
-			// Don't process if null
-			if (String)
-			{
-				// memcpy it into the buffer
-				FMemory::Memcpy(&Data[NumBytes],String,Len);
-				NumBytes += Len;
-			}
-		}
-		else
+		uint8* Ptr = BeginWrite(Len);
+		// Don't process if null
+		if (Ptr != nullptr && String)
 		{
-			bHasOverflowed = true;
+			// memcpy it into the buffer
+			FMemory::Memcpy(Ptr,String,Len);
+			NumBytes += Len;
 		}
 
 		return *this;
@@ -294,8 +860,35 @@ public:
 	 */
 	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const FName& Name)
 	{
-		const FString NameString = Name.ToString();
-		Ar << NameString;
+		// Written straight from the name table entry, ANSI entries are already valid UTF-8
+		const int32 Number = Name.GetNumber();
+		ANSICHAR Suffix[16];
+		int32 SuffixLen = 0;
+		if (Number != NAME_NO_NUMBER_INTERNAL)
+		{
+			SuffixLen = FCStringAnsi::Sprintf(Suffix, "_%d", NAME_INTERNAL_TO_EXTERNAL(Number));
+		}
+
+		if (Name.GetDisplayNameEntry()->IsWide())
+		{
+			const WIDECHAR* Chars = Name.GetPlainWIDEString();
+			const int32 NumChars = FCStringWide::Strlen(Chars);
+			const int32 Len = NboUtf8::EncodedLength(Chars, NumChars);
+			Ar << (int32)(Len + SuffixLen);
+			if (uint8* Ptr = Ar.BeginWrite(Len))
+			{
+				NboUtf8::Encode(Chars, NumChars, Ptr);
+				Ar.NumBytes += Len;
+			}
+		}
+		else
+		{
+			const ANSICHAR* Chars = Name.GetPlainANSIString();
+			const int32 Len = FCStringAnsi::Strlen(Chars);
+			Ar << (int32)(Len + SuffixLen);
+			Ar.WriteBinary((const uint8*)Chars, Len);
+		}
+		Ar.WriteBinary((const uint8*)Suffix, SuffixLen);
 		return Ar;
 	}
 
@@ -355,24 +948,21 @@ public:
 			}
 		case EOnlineKeyValuePairDataType::Blob:
 			{
-				TArray<uint8> Value;
-				KeyValuePair.GetValue(Value);
-
+				// Written from the variant's storage, without a copy
+				const int32 Size = (int32)KeyValuePair.GetBlobSize();
 				// Write the length
-				Ar << Value.Num();
-				// Followed by each byte of data
-				for (int32 Index = 0; Index < Value.Num(); Index++)
+				Ar << Size;
+				// Followed by the data
+				if (Size > 0)
 				{
-					Ar << Value[Index];
+					Ar.WriteBinary(KeyValuePair.GetBlobData(), Size);
 				}
 				break;
 			}
 		case EOnlineKeyValuePairDataType::String:
 			{
-				FString Value;
-				KeyValuePair.GetValue(Value);
 				// This will write a length prefixed string
-				Ar << (TCHAR*)*Value;
+				Ar << KeyValuePair.GetStringData();
 				break;
 			}
 		case EOnlineKeyValuePairDataType::Bool:
@@ -404,6 +994,20 @@ public:
 		return Ar;
 	}
 
+	/**
+	 * Adds a single session search parameter to the buffer
+	 */
+	friend inline FNboSerializeToBuffer& operator<<(FNboSerializeToBuffer& Ar,const FOnlineSessionSearchParam& SearchParam)
+	{
+		Ar << SearchParam.Data;
+
+		uint8 ComparisonOp;
+		ComparisonOp = SearchParam.ComparisonOp;
+		Ar << ComparisonOp;
+
+		return Ar;
+	}
+
 	/**
 	 * Adds an ip address to the buffer
 	 */
@@ -433,19 +1037,138 @@ public:
 	/**
 	 * Writes a blob of data to the buffer
 	 *
-	 * @param Buffer the source data to append
+	 * @param Source the source data to append
 	 * @param NumToWrite the size of the blob to write
 	 */
-	inline void WriteBinary(const uint8* Buffer,uint32 NumToWrite)
+	inline void WriteBinary(const uint8* Source,uint32 NumToWrite)
 	{
-		if (!HasOverflow() && NumBytes + NumToWrite <= GetBufferSize())
+		if (uint8* Ptr = BeginWrite(NumToWrite))
 		{
-			FMemory::Memcpy(&Data[NumBytes],Buffer,NumToWrite);
+			FMemory::Memcpy(Ptr,Source,NumToWrite);
 			NumBytes += NumToWrite;
 		}
-		else
+	}
+
+	/**
+	 * Claims the next bytes of the buffer for the caller to fill in, as TNboPacketLayout does
+	 *
+	 * @param Count the number of bytes
+	 * @return where to write them, nullptr once the buffer has overflowed
+	 */
+	inline uint8* WriteUninitialized(uint32 Count)
+	{
+		uint8* Ptr = BeginWrite(Count);
+		if (Ptr != nullptr)
 		{
-			bHasOverflowed = true;
+			NumBytes += Count;
+		}
+		return Ptr;
+	}
+
+	/**
+	 * Writes contiguous numbers in network byte order, in one bounds check and without a count
+	 *
+	 * @param Elements the numbers to write
+	 * @param Count the number of elements
+	 */
+	template<typename ElementType>
+	inline void WriteArray(const ElementType* Elements, int32 Count)
+	{
+		const uint32 Size = (uint32)Count * sizeof(ElementType);
+		if (Count > 0)
+		{
+			if (uint8* Ptr = BeginWrite(Size))
+			{
+				NboByteOrder::Copy<ElementType>(Ptr, (const uint8*)Elements, Count);
+				NumBytes += Size;
+			}
+		}
+	}
+
+	/**
+	 * Writes an array of numbers in network byte order, prefixed with its count
+	 *
+	 * @param Elements the numbers to write
+	 */
+	template<typename ElementType, typename AllocatorType>
+	inline void WriteArray(const TArray<ElementType, AllocatorType>& Elements)
+	{
+		(*this) << (int32)Elements.Num();
+		WriteArray(Elements.GetData(), Elements.Num());
+	}
+
+	/**
+	 * Writes an unsigned integer 7 bits at a time, values below 128 take a single byte
+	 *
+	 * @param Value the value to write
+	 */
+	inline void WritePackedUInt(uint64 Value)
+	{
+		do
+		{
+			uint8 Byte = Value & 0x7F;
+			Value >>= 7;
+			// The high bit marks that more bytes follow
+			if (Value != 0)
+			{
+				Byte |= 0x80;
+			}
+			(*this) << Byte;
+		}
+		while (Value != 0 && !HasOverflow());
+	}
+
+	/**
+	 * Writes a signed integer zigzag encoded, so small negative values stay small as well
+	 *
+	 * @param Value the value to write
+	 */
+	inline void WritePackedInt(int64 Value)
+	{
+		WritePackedUInt(((uint64)Value << 1) ^ (uint64)(Value >> 63));
+	}
+
+	/**
+	 * Writes a string as UTF-8 with a packed length prefix
+	 *
+	 * @param String the string to write
+	 */
+	inline void WritePackedString(const FString& String)
+	{
+		WritePackedUtf8(*String, String.Len());
+	}
+
+	/**
+	 * Writes characters as UTF-8 with a packed length prefix, encoding them straight into the buffer
+	 *
+	 * @param Chars the characters to write
+	 * @param NumChars the number of characters
+	 */
+	inline void WritePackedUtf8(const TCHAR* Chars, int32 NumChars)
+	{
+		const int32 Len = NboUtf8::EncodedLength(Chars, NumChars);
+		WritePackedUInt((uint64)Len);
+		if (uint8* Ptr = BeginWrite(Len))
+		{
+			NboUtf8::Encode(Chars, NumChars, Ptr);
+			NumBytes += Len;
+		}
+	}
+
+	/**
+	 * Writes characters as UTF-8 with a length prefix, encoding them straight into the buffer
+	 *
+	 * @param Chars the characters to write
+	 * @param NumChars the number of characters
+	 */
+	inline void WriteUtf8(const TCHAR* Chars, int32 NumChars)
+	{
+		const int32 Len = NboUtf8::EncodedLength(Chars, NumChars);
+		(*this) << Len;
+		if (uint8* Ptr = BeginWrite(Len))
+		{
+			NboUtf8::Encode(Chars, NumChars, Ptr);
+			NumBytes += Len;
 		}
 	}
 
@@ -454,7 +1177,8 @@ public:
 	 */
 	inline uint8* GetRawBuffer(uint32 Offset)
 	{
-		return &Data[Offset];
+		check(Offset <= Capacity);
+		return Buffer + Offset;
 	}
 
 	/**
@@ -464,14 +1188,12 @@ public:
 	 */
 	inline void SkipAheadBy(uint32 Amount)
 	{
-		if (!HasOverflow() && NumBytes + Amount <= GetBufferSize())
+		if (uint8* Ptr = BeginWrite(Amount))
 		{
+			// The buffer isn't zero filled, keep skipped bytes deterministic
+			FMemory::Memzero(Ptr, Amount);
 			NumBytes += Amount;
 		}
-		else
-		{
-			bHasOverflowed = true;
-		}
 	}
 
 	/** Returns whether the buffer had an overflow when writing to it */
@@ -503,6 +1225,20 @@ protected:
 	/** Hidden on purpose */
 	FNboSerializeFromBuffer(void);
 
+	/** Points the view at the next Len bytes and skips them, overflowing if there aren't that many */
+	bool ReadViewBytes(int32 Len, FNboStringView& OutView)
+	{
+		if (!HasOverflow() && Len >= 0 && Len <= AvailableToRead())
+		{
+			OutView = FNboStringView(Data + CurrentOffset, Len);
+			CurrentOffset += Len;
+			return true;
+		}
+		OutView = FNboStringView();
+		bHasOverflowed = true;
+		return false;
+	}
+
 public:
 	/**
 	 * Initializes the buffer, size, and zeros the read offset
@@ -632,35 +1368,12 @@ public:
 	 */
 	friend inline FNboSerializeFromBuffer& operator>>(FNboSerializeFromBuffer& Ar,FString& String)
 	{
-		// We send strings length prefixed
-		int32 Len = 0;
-		Ar >> Len;
-
-		if (!Ar.HasOverflow() && Ar.CurrentOffset + Len <= Ar.NumBytes)
-		{
-			// Handle strings of zero length
-			if (Len > 0)
-			{
-				char* Temp = (char*)FMemory_Alloca(Len + 1);
-				// memcpy it in from the buffer
-				FMemory::Memcpy(Temp, &Ar.Data[Ar.CurrentOffset], Len);
-				Temp[Len] = '\0';
-
-				FUTF8ToTCHAR Converted(Temp);
-				TCHAR* Ptr = (TCHAR*)Converted.Get();
-				String = Ptr;
-				Ar.CurrentOffset += Len;
-			}
-			else
-			{
-				String.Empty();
-			}
-		}
-		else
+		// Decoded straight into the string, which keeps its allocation
+		FNboStringView View;
+		if (Ar.ReadStringView(View))
 		{
-			Ar.bHasOverflowed = true;
+			NboUtf8::DecodeToString(View.Data, View.NumBytes, String);
 		}
-
 		return Ar;
 	}
 
@@ -669,12 +1382,41 @@ public:
 	 */
 	friend inline FNboSerializeFromBuffer& operator>>(FNboSerializeFromBuffer& Ar,FName& Name)
 	{
-		FString NameString; 
-		Ar >> NameString;
-		Name = FName(*NameString);
+		FNboStringView View;
+		if (Ar.ReadStringView(View))
+		{
+			Name = View.ToName();
+		}
 		return Ar;
 	}
 
+	/**
+	 * Reads a length prefixed string without converting it, see FNboStringView
+	 *
+	 * @param OutView the string in the buffer, empty on overflow
+	 * @return false if the buffer overflowed
+	 */
+	bool ReadStringView(FNboStringView& OutView)
+	{
+		// We send strings length prefixed
+		int32 Len = 0;
+		(*this) >> Len;
+		return ReadViewBytes(Len, OutView);
+	}
+
+	/**
+	 * Reads a string written by FNboSerializeToBuffer::WritePackedString without converting it
+	 *
+	 * @param OutView the string in the buffer, empty on overflow
+	 * @return false if the buffer overflowed
+	 */
+	bool ReadPackedStringView(FNboStringView& OutView)
+	{
+		uint64 Len = 0;
+		ReadPackedUInt(Len);
+		return ReadViewBytes(Len <= (uint64)MAX_int32 ? (int32)Len : -1, OutView);
+	}
+
 	/**
 	 * Reads a list of key value pairs from the buffer
 	 */
@@ -742,7 +1484,8 @@ public:
 					int32 Length;
 					Ar >> Length;
 
-					if (!Ar.HasOverflow() && Ar.CurrentOffset + Length <= Ar.NumBytes)
+					// A negative length would pass the bounds check and turn into a huge size
+					if (!Ar.HasOverflow() && Length >= 0 && Ar.CurrentOffset + Length <= Ar.NumBytes)
 					{
 						// Now directly copy the blob data
 						KeyValuePair.SetValue(Length,&Ar.Data[Ar.CurrentOffset]);
@@ -757,9 +1500,11 @@ public:
 				}
 			case EOnlineKeyValuePairDataType::String:
 				{
-					FString Value;
-					Ar >> Value;
-					KeyValuePair.SetValue(Value);
+					FNboStringView View;
+					if (Ar.ReadStringView(View))
+					{
+						Ar.ReadUtf8Into(View, KeyValuePair);
+					}
 					break;
 				}
 			case EOnlineKeyValuePairDataType::Bool:
@@ -772,7 +1517,9 @@ public:
 			case EOnlineKeyValuePairDataType::Empty:
 				break;
 			default:
-				checkfSlow(false, TEXT("Unsupported EOnlineKeyValuePairDataType: %d"), Type);
+				// Search queries come from anyone on the network, an unknown type can't be skipped so the rest is unreadable
+				Ar.bHasOverflowed = true;
+				break;
 			}
 		}
 
@@ -796,6 +1543,23 @@ public:
 		return Ar;
 	}
 
+	/**
+	 * Reads a single session search parameter from the buffer
+	 */
+	friend inline FNboSerializeFromBuffer& operator>>(FNboSerializeFromBuffer& Ar,FOnlineSessionSearchParam& SearchParam)
+	{
+		Ar >> SearchParam.Data;
+
+		if (!Ar.HasOverflow())
+		{
+			uint8 ComparisonOp;
+			Ar >> ComparisonOp;
+			SearchParam.ComparisonOp = (EB3atZOnlineComparisonOp::Type) ComparisonOp;
+		}
+
+		return Ar;
+	}
+
 	/**
 	 * Reads an ip address from the buffer
 	 */
@@ -841,6 +1605,133 @@ public:
 		}
 	}
 
+	/**
+	 * Skips over the next bytes for the caller to read in place, as TNboPacketLayout does
+	 *
+	 * @param Count the number of bytes
+	 * @return the bytes in the buffer, nullptr if there aren't that many
+	 */
+	inline const uint8* ReadInPlace(int32 Count)
+	{
+		if (!HasOverflow() && Count >= 0 && Count <= AvailableToRead())
+		{
+			const uint8* Ptr = Data + CurrentOffset;
+			CurrentOffset += Count;
+			return Ptr;
+		}
+		bHasOverflowed = true;
+		return nullptr;
+	}
+
+	/**
+	 * Reads numbers written by FNboSerializeToBuffer::WriteArray without a count
+	 *
+	 * @param OutElements where to read to
+	 * @param Count the number of elements to read
+	 */
+	template<typename ElementType>
+	void ReadArray(ElementType* OutElements, int32 Count)
+	{
+		if (!HasOverflow() && Count >= 0 && (int64)Count * sizeof(ElementType) <= (int64)AvailableToRead())
+		{
+			NboByteOrder::Copy<ElementType>((uint8*)OutElements, Data + CurrentOffset, Count);
+			CurrentOffset += Count * sizeof(ElementType);
+		}
+		else
+		{
+			bHasOverflowed = true;
+		}
+	}
+
+	/**
+	 * Reads an array written by FNboSerializeToBuffer::WriteArray with its count
+	 *
+	 * @param OutElements the array to replace
+	 */
+	template<typename ElementType, typename AllocatorType>
+	void ReadArray(TArray<ElementType, AllocatorType>& OutElements)
+	{
+		int32 Count = 0;
+		(*this) >> Count;
+		// Check the count against what's left before allocating for it
+		if (!HasOverflow() && Count >= 0 && (int64)Count * sizeof(ElementType) <= (int64)AvailableToRead())
+		{
+			OutElements.SetNumUninitialized(Count);
+			ReadArray(OutElements.GetData(), Count);
+		}
+		else
+		{
+			bHasOverflowed = true;
+		}
+	}
+
+	/**
+	 * Reads an unsigned integer written by FNboSerializeToBuffer::WritePackedUInt
+	 *
+	 * @param OutValue the value read
+	 */
+	void ReadPackedUInt(uint64& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; !HasOverflow(); Shift += 7)
+		{
+			uint8 Byte = 0;
+			(*this) >> Byte;
+			// More than ten bytes can't be a 64 bit value
+			if (Shift >= 64)
+			{
+				bHasOverflowed = true;
+			}
+			else if (!HasOverflow())
+			{
+				OutValue |= (uint64)(Byte & 0x7F) << Shift;
+				if ((Byte & 0x80) == 0)
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	/**
+	 * Reads a signed integer written by FNboSerializeToBuffer::WritePackedInt
+	 *
+	 * @param OutValue the value read
+	 */
+	void ReadPackedInt(int64& OutValue)
+	{
+		uint64 Value = 0;
+		ReadPackedUInt(Value);
+		OutValue = (int64)(Value >> 1) ^ -(int64)(Value & 1);
+	}
+
+	/**
+	 * Decodes a string in the buffer straight into a variant, without an intermediate FString
+	 *
+	 * @param View the string in the buffer
+	 * @param OutData receives the string
+	 */
+	static void ReadUtf8Into(const FNboStringView& View, FVariantData& OutData)
+	{
+		// UTF-8 never decodes to more characters than it has bytes
+		TCHAR* Chars = OutData.SetStringUninitialized(View.NumBytes);
+		Chars[NboUtf8::Decode(View.Data, View.NumBytes, Chars)] = TEXT('\0');
+	}
+
+	/**
+	 * Reads a string written by FNboSerializeToBuffer::WritePackedString
+	 *
+	 * @param OutString the string read
+	 */
+	void ReadPackedString(FString& OutString)
+	{
+		FNboStringView View;
+		if (ReadPackedStringView(View))
+		{
+			NboUtf8::DecodeToString(View.Data, View.NumBytes, OutString);
+		}
+	}
+
 	/**
 	 * Seek to the desired position in the buffer
 	 *
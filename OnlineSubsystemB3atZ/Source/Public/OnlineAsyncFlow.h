@@ -0,0 +1,151 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineAsyncTaskManager.h"
+
+/** Thread a step of an async flow runs on */
+namespace EOnlineAsyncResume
+{
+	enum Type
+	{
+		/** Right after the previous step on the online thread, for steps that don't touch game state */
+		OnlineThread,
+		/** On the game thread, costs a round trip through the out queue */
+		GameThread
+	};
+}
+
+/** Outcome of a single run of a step */
+namespace EOnlineAsyncStepResult
+{
+	enum Type
+	{
+		/** Not done yet, the step is run again on the next pass */
+		Pending,
+		/** Done, the flow continues with the next step */
+		Succeeded,
+		/** Done, the flow stops and completes unsuccessfully */
+		Failed
+	};
+}
+
+/**
+ * Runs a chain of steps one after another as a single async task, so a multi step flow
+ * (login, then query achievements, then create a session) reads sequentially instead of
+ * as nested delegates. A step resumed on the online thread follows the previous one in the
+ * same pass, without the game thread hop a delegate callback would need
+ *
+ *	(new FOnlineAsyncFlow(TaskManager))
+ *		->Then([=]() { return StartLogin() ? EOnlineAsyncStepResult::Succeeded : EOnlineAsyncStepResult::Failed; })
+ *		.Then([=]() { return IsLoggedIn() ? EOnlineAsyncStepResult::Succeeded : EOnlineAsyncStepResult::Pending; })
+ *		.Then([=]() { UpdateUI(); return EOnlineAsyncStepResult::Succeeded; }, EOnlineAsyncResume::GameThread)
+ *		.OnComplete([=](bool bWasSuccessful) { ... })
+ *		.Start();
+ */
+class ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncFlow : public FOnlineAsyncTask
+{
+public:
+	/** A step of the flow, run until it no longer returns Pending */
+	typedef TFunction<EOnlineAsyncStepResult::Type()> FStep;
+
+	/** Called on the game thread once the flow has completed, failed or was cancelled */
+	typedef TFunction<void(bool)> FOnComplete;
+
+	/**
+	 * Constructor
+	 *
+	 * @param InTaskManager the manager the flow is queued on
+	 * @param InLane serialization lane the flow runs in
+	 */
+	explicit FOnlineAsyncFlow(FOnlineAsyncTaskManager& InTaskManager, FName InLane = NAME_None);
+
+	/**
+	 * Appends a step, only valid before Start
+	 *
+	 * @param Step the work to run
+	 * @param ResumeOn the thread to run the step on
+	 * @return the flow, to chain further steps
+	 */
+	FOnlineAsyncFlow& Then(const FStep& Step, EOnlineAsyncResume::Type ResumeOn = EOnlineAsyncResume::OnlineThread);
+
+	/**
+	 * Sets the callback fired on the game thread once the flow is done, only valid before Start
+	 * @return the flow
+	 */
+	FOnlineAsyncFlow& OnComplete(const FOnComplete& InCompleteCallback);
+
+	/**
+	 * Queues the flow on the task manager, which owns it from then on
+	 * @return handle to cancel the flow with
+	 */
+	FOnlineAsyncTaskHandle Start();
+
+	/** @return the index of the step being run */
+	int32 GetCurrentStep() const
+	{
+		return CurrentStep;
+	}
+
+	// FOnlineAsyncTask
+	virtual FName GetSerializationLane() const override { return Lane; }
+	virtual double GetNextTickTime() const override;
+	virtual void Tick() override;
+	virtual void Abandon() override;
+	virtual bool IsDone() override { return bIsComplete; }
+	virtual bool WasSuccessful() override { return bWasSuccessful; }
+
+	// FOnlineAsyncItem
+	virtual FString ToString() const override;
+	virtual FName GetStatName() const override { return FName(TEXT("FOnlineAsyncFlow")); }
+	virtual void TriggerDelegates() override;
+
+private:
+	/** A step and where it runs */
+	struct FFlowStep
+	{
+		FStep Function;
+		EOnlineAsyncResume::Type ResumeOn;
+	};
+
+	/**
+	 * State of a step handed to the game thread, shared with the out queue item
+	 * so the flow can be cancelled and deleted while the item is still queued
+	 */
+	struct FGameThreadCall
+	{
+		FStep Function;
+		volatile int32 Result;
+		volatile int32 bIsDone;
+		volatile int32 bIsAbandoned;
+
+		FGameThreadCall()
+			: Result(EOnlineAsyncStepResult::Pending)
+			, bIsDone(0)
+			, bIsAbandoned(0)
+		{
+		}
+	};
+
+	/** Queues the current step for the game thread */
+	void PostToGameThread(const FFlowStep& Step);
+
+	/** Manager the flow runs on */
+	FOnlineAsyncTaskManager& TaskManager;
+	/** Serialization lane the flow runs in */
+	FName Lane;
+	/** Steps in run order */
+	TArray<FFlowStep> Steps;
+	/** Index of the step being run */
+	int32 CurrentStep;
+	/** The current step while it waits for the game thread */
+	TSharedPtr<FGameThreadCall, ESPMode::ThreadSafe> PendingCall;
+	/** Fired once the flow is done */
+	FOnComplete CompleteCallback;
+	/** Whether all steps ran or one failed */
+	bool bIsComplete;
+	/** Whether every step succeeded */
+	bool bWasSuccessful;
+};
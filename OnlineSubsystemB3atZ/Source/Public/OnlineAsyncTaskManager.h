@@ -10,20 +10,84 @@
 #include "Misc/SingleThreadRunnable.h"
 #include "OnlineSubsystemPackage.h"
 
+template<class ItemType> class TOnlineAsyncQueue;
+class FOnlineAsyncWorkerPool;
+
+/** Refers to a queued async task, used to cancel it */
+struct FOnlineAsyncTaskHandle
+{
+	/** Id of the task, 0 for none */
+	uint32 Id;
+
+	FOnlineAsyncTaskHandle()
+		: Id(0)
+	{
+	}
+
+	explicit FOnlineAsyncTaskHandle(uint32 InId)
+		: Id(InId)
+	{
+	}
+
+	/** @return true if the handle refers to a task */
+	bool IsValid() const
+	{
+		return Id != 0;
+	}
+};
+
+/** Order in which completed items are dispatched on the game thread when the frame budget is tight */
+namespace EOnlineAsyncPriority
+{
+	enum Type
+	{
+		/** Session and identity completions the game flow waits on */
+		High,
+		/** Everything that does not say otherwise */
+		Normal,
+		/** Cosmetic results that can wait a few frames */
+		Low,
+		/** Number of priority classes */
+		Count
+	};
+}
+
 /**
  * Base class of any async task that can be returned to the game thread by the async task manager
  * May originate on the game thread, or generated by an external platform service callback from the online thread itself
  */
 class ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncItem
 {
+	template<class ItemType> friend class TOnlineAsyncQueue;
+	friend class FOnlineAsyncTaskManager;
+
+	/** Link to the next item while queued in a TOnlineAsyncQueue */
+	FOnlineAsyncItem* NextQueuedItem;
+
+	/** Time the online thread started ticking the item, for latency stats */
+	double ActivatedTime;
+
+	/** Time the item was queued for the game thread, for latency stats */
+	double CompletedTime;
+
+	/** Serialization lane of a completed serial task, whose items are finalized in completion order */
+	FName OutLane;
+
+	/** Whether the item was completed by a serial task and is ordered within OutLane */
+	bool bHasOutLane;
+
 protected:
 	/** Time the task was created */
 	double StartTime;
 
 	/** Hidden on purpose */
 	FOnlineAsyncItem() 
+		: NextQueuedItem(nullptr)
+		, CompletedTime(0.0)
+		, bHasOutLane(false)
 	{
 		StartTime = FPlatformTime::Seconds();
+		ActivatedTime = StartTime;
 	}
 
 public:
@@ -32,11 +96,25 @@ public:
 	{
 	}
 
+	/**
+	 * Items are created and destroyed at a high rate from several threads, so they are recycled
+	 * through fixed size lock free pools. Generic callables are stored inline in the item, only
+	 * items larger than the biggest pool block go to the heap
+	 */
+	static void* operator new(size_t Size);
+	static void operator delete(void* Ptr, size_t Size);
+
 	/**
 	 *	Get a human readable description of task
 	 */
 	virtual FString ToString() const = 0;
 
+	/**
+	 * Latency stats are grouped by this name, so it must not contain per task details
+	 * @return the type name, the first word of ToString() unless overridden
+	 */
+	virtual FName GetStatName() const;
+
 	/**
 	 * Updates the amount of elapsed time this task has taken
 	 */
@@ -45,6 +123,16 @@ public:
 		return FPlatformTime::Seconds() - StartTime;
 	}
 
+	/**
+	 * Completed items of higher priority are dispatched first when GameTick runs out of its time budget.
+	 * Serial tasks of one lane still finalize in order, a task waits behind an earlier one of lower priority
+	 * @return the dispatch priority of this item
+	 */
+	virtual EOnlineAsyncPriority::Type GetPriority() const
+	{
+		return EOnlineAsyncPriority::Normal;
+	}
+
 	/**
 	 * Give the async task a chance to marshal its data back to the game thread
 	 * Can only be called on the game thread by the async task manager
@@ -97,10 +185,54 @@ public:
  */
 class ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncTask : public FOnlineAsyncItem
 {
+	friend class FOnlineAsyncTaskManager;
+
+	/** Id handed out by the task manager, 0 until queued */
+	uint32 TaskId;
+
+	/** Set by FOnlineAsyncTaskManager::Cancel from any thread */
+	volatile int32 bCancelRequested;
+
+	/** Whether the task was finalized early by a cancel or its deadline */
+	bool bWasCancelled;
+	bool bHasTimedOut;
+
+	/** Whether the task was queued with AddToParallelTasks */
+	bool bIsParallel;
+
+	/** Whether the task waits in the pending list of its lane */
+	bool bIsPendingInLane;
+
+	/** Whether the task was queued on a deterministic manager, which ticks it on the game thread */
+	bool bIsDeterministic;
+
+	/** Previous task in its serialization lane, the lane keeps a doubly linked list to unlink cancelled tasks */
+	FOnlineAsyncTask* PrevInLane;
+
+	/** Position in the manager's ParallelTasks, so a finished task is swapped out without a search */
+	int32 ParallelIndex;
+
+	/** Time the task may take from being queued, 0 for no deadline */
+	double Timeout;
+
+	/** Manager clock time after which the task is given up, 0 for no deadline */
+	double Deadline;
+
 protected:
 
 	/** Hidden on purpose */
 	FOnlineAsyncTask() 
+		: TaskId(0)
+		, bCancelRequested(0)
+		, bWasCancelled(false)
+		, bHasTimedOut(false)
+		, bIsParallel(false)
+		, bIsPendingInLane(false)
+		, bIsDeterministic(false)
+		, PrevInLane(nullptr)
+		, ParallelIndex(INDEX_NONE)
+		, Timeout(0.0)
+		, Deadline(0.0)
 	{
 	}
 
@@ -111,10 +243,75 @@ public:
 	}
 
 	/**
-	 * Initialize the task - called on game thread when queued
+	 * Gives the task a deadline, counted from when it is queued and covering the time spent queued.
+	 * A task still not done by then is finalized with HasTimedOut() set. Call before queueing
+	 *
+	 * @param Seconds time the task may take, 0 or less for no deadline
+	 */
+	void SetTimeout(double Seconds)
+	{
+		Timeout = FMath::Max(Seconds, 0.0);
+	}
+
+	/** @return true if the task was cancelled before it was done, valid from Finalize on */
+	bool WasCancelled() const
+	{
+		return bWasCancelled;
+	}
+
+	/** @return true if the task missed its deadline, valid from Finalize on */
+	bool HasTimedOut() const
+	{
+		return bHasTimedOut;
+	}
+
+	/**
+	 * Called on the online thread when the task is cancelled or times out, before it is
+	 * finalized. Tasks waiting on external callbacks must detach from them here,
+	 * the task is deleted once it has been finalized
+	 */
+	virtual void Abandon() {}
+
+	/**
+	 * Initialize the task - called on the online thread when it becomes the active task of its lane
 	 */
 	virtual void Initialize() {}
 
+	/**
+	 * Serial tasks sharing a lane run one at a time in queue order, tasks in different
+	 * lanes run concurrently. Override with a per user or per interface name so
+	 * unrelated requests don't wait for each other
+	 *
+	 * @return the lane of this task, NAME_None for the shared default lane
+	 */
+	virtual FName GetSerializationLane() const
+	{
+		return NAME_None;
+	}
+
+	/**
+	 * Lets the online thread sleep until the task has work to do. Tasks waiting on an
+	 * external callback return MAX_dbl and have the callback call FOnlineAsyncTaskManager::WakeUp
+	 *
+	 * @return the FPlatformTime::Seconds() at which the task next needs a Tick, 0 to be polled every PollingInterval
+	 */
+	virtual double GetNextTickTime() const
+	{
+		return 0.0;
+	}
+
+	/**
+	 * CPU bound parallel tasks are ticked on the async worker pool when one is configured,
+	 * instead of the online thread. Such a task is ticked again right away until it is done,
+	 * so each Tick should make progress rather than wait on a service
+	 *
+	 * @return true if the task mostly burns CPU, like parsing or merging large results
+	 */
+	virtual bool IsCpuBound() const
+	{
+		return false;
+	}
+
 	/**
 	 * Check the state of the async task
 	 * @return true if complete, false otherwise
@@ -133,8 +330,8 @@ public:
 	 */
 	virtual void Tick()
 	{
-		// assert that we're not on the game thread
-		check(!IsInGameThread() || !FPlatformProcess::SupportsMultithreading());
+		// assert that we're not on the game thread, unless the manager is stepped from it
+		check(!IsInGameThread() || !FPlatformProcess::SupportsMultithreading() || bIsDeterministic);
 	}
 };
 
@@ -153,21 +350,28 @@ public:
 	 * Constructor.
 	 *
 	 * @param InCallable any object that can be called with no parameters, usually a lambda
+	 * @param InLane serialization lane to queue the callable in
 	 */
-	explicit FOnlineAsyncTaskGenericCallable(const CallableType& InCallable)
-		: CallableObject(InCallable) {}
+	explicit FOnlineAsyncTaskGenericCallable(const CallableType& InCallable, FName InLane = NAME_None)
+		: Lane(InLane)
+		, CallableObject(InCallable) {}
 
 	virtual void Finalize() override
 	{
 		CallableObject();
 	}
 
+	virtual FName GetSerializationLane() const override { return Lane; }
+
 	virtual FString ToString() const override { return FString("FOnlineAsyncTaskGenericCallable"); }
+	virtual FName GetStatName() const override { return FName(TEXT("FOnlineAsyncTaskGenericCallable")); }
 
 	virtual bool IsDone() override { return true; }
 	virtual bool WasSuccessful() override { return true; }
 
 private:
+	/** Serialization lane the callable was queued in */
+	FName Lane;
 	/** Stored copy of the object to invoke on the game thread. */
 	CallableType CallableObject;
 };
@@ -185,13 +389,17 @@ public:
 	* Constructor.
 	*
 	* @param InCallable any object that can be called with no parameters, usually a lambda
+	* @param InLane serialization lane to queue the callable in
 	*/
-	explicit FOnlineAsyncTaskThreadedGenericCallable(const CallableType& InCallable)
+	explicit FOnlineAsyncTaskThreadedGenericCallable(const CallableType& InCallable, FName InLane = NAME_None)
 		: bHasTicked(false)
+		, Lane(InLane)
 		, CallableObject(InCallable)
 	{
 	}
 
+	virtual FName GetSerializationLane() const override { return Lane; }
+
 	virtual void Tick() override
 	{
 		CallableObject();
@@ -199,6 +407,7 @@ public:
 	}
 
 	virtual FString ToString() const override { return FString("FOnlineAsyncTaskThreadedGenericCallable"); }
+	virtual FName GetStatName() const override { return FName(TEXT("FOnlineAsyncTaskThreadedGenericCallable")); }
 
 	virtual bool IsDone() override { return bHasTicked; }
 	virtual bool WasSuccessful() override { return true; }
@@ -206,6 +415,8 @@ public:
 private:
 	/** True after it has ticked once and run the Callable on the online thred */
 	bool bHasTicked;
+	/** Serialization lane the callable was queued in */
+	FName Lane;
 	/** Stored copy of the object to invoke on the game thread. */
 	CallableType CallableObject;
 };
@@ -262,33 +473,204 @@ public:
 	}
 };
 
+/**
+ * Intrusive lock free queue with any number of producers and a single consumer.
+ * Producers push onto a stack with a compare and swap, the consumer takes the whole
+ * stack with one exchange and restores the push order, so neither side ever blocks
+ * and the consumer pays for synchronization once per batch instead of once per item
+ */
+template<class ItemType>
+class TOnlineAsyncQueue
+{
+public:
+	TOnlineAsyncQueue()
+		: Head(nullptr)
+	{
+	}
+
+	/**
+	 * Adds an item, safe to call from any thread
+	 * @param Item the item to queue, must not be in any other queue
+	 */
+	void Push(ItemType* Item)
+	{
+		FOnlineAsyncItem* NewHead = Item;
+		FOnlineAsyncItem* OldHead;
+		do
+		{
+			OldHead = Head;
+			NewHead->NextQueuedItem = OldHead;
+		}
+		while (FPlatformAtomics::InterlockedCompareExchangePointer((void**)&Head, NewHead, OldHead) != OldHead);
+	}
+
+	/**
+	 * Removes all queued items, call only from the consumer thread
+	 *
+	 * @param OutTail receives the last item of the batch
+	 * @param OutNum receives the number of items in the batch
+	 *
+	 * @return the first item of the batch in push order, linked through GetNext
+	 */
+	ItemType* PopAll(ItemType*& OutTail, int32& OutNum)
+	{
+		FOnlineAsyncItem* Item = (FOnlineAsyncItem*)FPlatformAtomics::InterlockedExchangePtr((void**)&Head, nullptr);
+		OutTail = static_cast<ItemType*>(Item);
+		OutNum = 0;
+
+		// The stack holds the newest item first
+		FOnlineAsyncItem* Reversed = nullptr;
+		while (Item != nullptr)
+		{
+			FOnlineAsyncItem* Next = Item->NextQueuedItem;
+			Item->NextQueuedItem = Reversed;
+			Reversed = Item;
+			Item = Next;
+			OutNum++;
+		}
+		return static_cast<ItemType*>(Reversed);
+	}
+
+	/** @return true if nothing is queued, only a hint while producers are active */
+	bool IsEmpty() const
+	{
+		return Head == nullptr;
+	}
+
+	/** @return the item following Item in a batch returned by PopAll */
+	static ItemType* GetNext(const ItemType* Item)
+	{
+		return static_cast<ItemType*>(Item->NextQueuedItem);
+	}
+
+	/** Links Next after Item, to append batches on the consumer side */
+	static void SetNext(ItemType* Item, ItemType* Next)
+	{
+		Item->NextQueuedItem = Next;
+	}
+
+private:
+	/** Most recently pushed item */
+	FOnlineAsyncItem* volatile Head;
+};
+
 /**
  *	
  */
 class ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncTaskManager : public FRunnable, FSingleThreadRunnable 
 {
+	friend class FOnlineAsyncWorkerPool;
+
 protected:
 
 	/** Game thread async tasks are queued up here for processing on the online thread */
-	TArray<FOnlineAsyncTask*> InQueue;
-	/** Critical section for thread safe operation of the event in queue */
-	FCriticalSection InQueueLock;
+	TOnlineAsyncQueue<FOnlineAsyncTask> InQueue;
+
+	/** Serial tasks sharing a serialization lane */
+	struct FSerialLane
+	{
+		/** Task currently being ticked */
+		FOnlineAsyncTask* ActiveTask;
+		/** Tasks waiting behind the active one, linked in queue order */
+		FOnlineAsyncTask* PendingHead;
+		FOnlineAsyncTask* PendingTail;
+		/** Earliest deadline of the pending tasks, MAX_dbl for none. May be early once tasks left the list */
+		double PendingDeadline;
+
+		FSerialLane()
+			: ActiveTask(nullptr)
+			, PendingHead(nullptr)
+			, PendingTail(nullptr)
+			, PendingDeadline(MAX_dbl)
+		{
+		}
+	};
+
+	/** Lanes with queued or active tasks by lane name, only used by the online thread */
+	TMap<FName, FSerialLane> SerialLanes;
+
+	/** Number of serial tasks queued or active across all lanes */
+	volatile int32 NumSerialTasks;
+
+	/** Guards LiveTasks and CancelledTaskIds */
+	FCriticalSection LiveTasksLock;
+
+	/** Queued tasks that can still be cancelled, by task id */
+	TMap<uint32, FOnlineAsyncTask*> LiveTasks;
+
+	/** Serial tasks to take out of their lanes on the next online thread pass */
+	TArray<uint32> CancelledTaskIds;
+
+	/** Id of the next queued task, shared by all task managers so ids stay unique in async task recordings */
+	static volatile int32 NextTaskId;
 
-	/** blah */
-	FOnlineAsyncTask* ActiveTask;
+	/** Gives the task an id and makes it cancellable */
+	FOnlineAsyncTaskHandle RegisterTask(FOnlineAsyncTask* Task);
 
-	/** blah */
-	FCriticalSection ActiveTaskLock;
+	/**
+	 * Hands a finished, cancelled or expired task to the game thread
+	 * Can only be called on the online thread
+	 */
+	void CompleteTask(FOnlineAsyncTask* Task);
+
+	/**
+	 * Checks for a cancel request or a missed deadline and abandons the task if so
+	 * @return true if the task was abandoned and must not be ticked anymore
+	 */
+	bool AbandonIfExpired(FOnlineAsyncTask* Task, double Now);
+
+	/** Abandons a task that will never run and hands it to the game thread with WasCancelled() set */
+	void CompleteCancelledTask(FOnlineAsyncTask* Task);
+
+	/** Takes a task out of the pending list of its lane */
+	static void UnlinkPendingTask(FSerialLane& Lane, FOnlineAsyncTask* Task);
+
+	/** Removes cancelled tasks waiting in their lanes, can only be called on the online thread */
+	void RemoveCancelledTasks();
+
+	/**
+	 * Removes the pending tasks of a lane whose deadline passed while they waited behind the active task
+	 * Can only be called on the online thread
+	 */
+	void RemoveExpiredTasks(FSerialLane& Lane, double Now);
 
-	/** This queue is for tasks that are safe to run in parallel with one another */
+	/** This queue is for tasks that are safe to run in parallel with one another, unordered, each task knows its index */
 	TArray<FOnlineAsyncTask*> ParallelTasks;
+	/** Copy of ParallelTasks ticked by the online thread, kept to reuse its allocation */
+	TArray<FOnlineAsyncTask*> ParallelTasksSnapshot;
+	/** Workers ticking CPU bound parallel tasks, null unless AsyncWorkerPoolSize is set */
+	FOnlineAsyncWorkerPool* WorkerPool;
 	/** Critical section for thread safe operation of the list */
 	FCriticalSection ParallelTasksLock;
 
 	/** Completed online requests are queued up here for processing on the game thread */
-	TArray<FOnlineAsyncItem*> OutQueue;
-    /** Critical section for thread safe operation of the out queue */
-	FCriticalSection OutQueueLock;
+	TOnlineAsyncQueue<FOnlineAsyncItem> OutQueue;
+
+	/** Items taken from OutQueue that have not been finalized yet by priority, game thread only */
+	FOnlineAsyncItem* PendingOutHead[EOnlineAsyncPriority::Count];
+	FOnlineAsyncItem* PendingOutTail[EOnlineAsyncPriority::Count];
+	int32 NumPendingOut;
+
+	/** Serialization lane with items waiting in the pending out lists */
+	struct FPendingOutLane
+	{
+		/** Priority list holding the newest item of the lane, later items of the lane are not queued ahead of it */
+		int32 Priority;
+		/** Number of items of the lane not finalized yet */
+		int32 NumItems;
+
+		FPendingOutLane()
+			: Priority(0)
+			, NumItems(0)
+		{
+		}
+	};
+
+	/** Lanes of the items waiting in the pending out lists by lane name, game thread only */
+	TMap<FName, FPendingOutLane> PendingOutLanes;
+
+	/** Time GameTick may spend finalizing items per frame in seconds, 0 for no limit */
+	double GameTickBudget;
 
 	/** Trigger event to signal the queue has tasks that need processing */
 	FEvent* WorkEvent;
@@ -296,9 +678,28 @@ protected:
 	/** Min amount of time to poll for the current task to complete */
 	uint32 PollingInterval;
 
+	/** Wait time in ms for the next online thread pass, MAX_uint32 parks the thread until woken up */
+	uint32 GetWaitTime();
+
+	/**
+	 * Lets the online service tell the online thread when OnlineTick next needs to run
+	 *
+	 * @return the FPlatformTime::Seconds() of the next OnlineTick, 0 to tick every PollingInterval, MAX_dbl to only tick when there is work
+	 */
+	virtual double GetNextOnlineTickTime() const
+	{
+		return 0.0;
+	}
+
 	/** Should this manager and the thread exit */
 	int32 bRequestingExit;
 
+	/** Whether the manager is stepped by hand on a virtual clock, see SetDeterministic */
+	bool bIsDeterministic;
+
+	/** Current time of the virtual clock in seconds */
+	double VirtualTime;
+
 	/** Number of async task managers running currently */
 	static int32 InvocationCount;
 
@@ -308,6 +709,19 @@ protected:
 	 */
 	void RemoveFromParallelTasks(FOnlineAsyncTask* OldTask);
 
+	/**
+	 * Ticks every parallel task and hands finished ones to the game thread
+	 * Can only be called on the online thread
+	 */
+	void TickParallelTasks();
+
+	/**
+	 * Moves newly queued tasks into their lanes and ticks the active task of every lane.
+	 * A finished task is replaced by the next one in its lane right away
+	 * Can only be called on the online thread
+	 */
+	void TickSerialLanes();
+
 PACKAGE_SCOPE:
 
 	/** Set by FOnlineAsyncTaskManager::Run */
@@ -316,7 +730,7 @@ PACKAGE_SCOPE:
 public:
 
 	FOnlineAsyncTaskManager();
-	virtual ~FOnlineAsyncTaskManager() {}
+	virtual ~FOnlineAsyncTaskManager();
 
 	/**
 	 * Init the online async task manager
@@ -352,8 +766,54 @@ public:
 	/**
 	 * Add online async tasks that need processing onto the incoming queue
 	 * @param NewTask - some request of the online services
+	 * @return handle to cancel the task with
+	 */
+	FOnlineAsyncTaskHandle AddToInQueue(FOnlineAsyncTask* NewTask);
+
+	/**
+	 * Cancels a queued or running task, safe to call from any thread. The task is
+	 * abandoned on the next online thread pass and finalized with WasCancelled() set
+	 *
+	 * @param Handle the handle returned when the task was queued
+	 * @return false if the task already finished
+	 */
+	bool Cancel(FOnlineAsyncTaskHandle Handle);
+
+	/**
+	 * Switches the manager to deterministic stepping: no online thread is started, time only
+	 * advances in Step and every pass ticks every task, so the order of completions only depends
+	 * on the order tasks were queued in. The calling thread stands in for the online thread,
+	 * call from the thread that steps the manager before anything is queued
+	 *
+	 * @param StartTime the initial time of the virtual clock
+	 */
+	void SetDeterministic(double StartTime = 0.0);
+
+	/** @return true if the manager runs on a virtual clock */
+	bool IsDeterministic() const
+	{
+		return bIsDeterministic;
+	}
+
+	/** @return the time deadlines and activations are measured in, the virtual clock when deterministic */
+	double GetClockTime() const
+	{
+		return bIsDeterministic ? VirtualTime : FPlatformTime::Seconds();
+	}
+
+	/**
+	 * Advances the virtual clock and runs one online pass followed by one game tick.
+	 * Only valid in deterministic mode, from the game thread
+	 *
+	 * @param DeltaSeconds the time to advance the virtual clock by
+	 */
+	void Step(double DeltaSeconds);
+
+	/**
+	 * Wakes the online thread for an immediate pass, safe to call from any thread.
+	 * Used by service callbacks that complete tasks waiting without a deadline
 	 */
-	void AddToInQueue(FOnlineAsyncTask* NewTask);
+	void WakeUp();
 
 	/**
 	 * Add completed online async tasks that need processing onto the queue
@@ -383,11 +843,12 @@ public:
 	 * the callable will only execute after any existing tasks in the queue are complete.
 	 *
 	 * @param InCallable the callable object to execute on the game thread.
+	 * @param Lane serialization lane to run the callable in, after earlier tasks of that lane
 	 */
 	template<class CallableType>
-	void AddGenericToInQueue(const CallableType& InCallable)
+	FOnlineAsyncTaskHandle AddGenericToInQueue(const CallableType& InCallable, FName Lane = NAME_None)
 	{
-		AddToInQueue(new FOnlineAsyncTaskGenericCallable<CallableType>(InCallable));
+		return AddToInQueue(new FOnlineAsyncTaskGenericCallable<CallableType>(InCallable, Lane));
 	}
 
 	/**
@@ -399,18 +860,20 @@ public:
 	* instead of Finalize on the game thread.
 	*
 	* @param InCallable the callable object to execute on the game thread.
+	* @param Lane serialization lane to run the callable in, after earlier tasks of that lane
 	*/
 	template<class CallableType>
-	void AddGenericToInQueueOnlineThread(const CallableType& InCallable)
+	FOnlineAsyncTaskHandle AddGenericToInQueueOnlineThread(const CallableType& InCallable, FName Lane = NAME_None)
 	{
-		AddToInQueue(new FOnlineAsyncTaskThreadedGenericCallable<CallableType>(InCallable));
+		return AddToInQueue(new FOnlineAsyncTaskThreadedGenericCallable<CallableType>(InCallable, Lane));
 	}
 
 	/**
 	 * Add a new online async task that is safe to run in parallel
 	 * @param NewTask - some request of the online services
+	 * @return handle to cancel the task with
 	 */
-	void AddToParallelTasks(FOnlineAsyncTask* NewTask);
+	FOnlineAsyncTaskHandle AddToParallelTasks(FOnlineAsyncTask* NewTask);
 
 	/**
 	 *	** CALL ONLY FROM GAME THREAD **
@@ -0,0 +1,193 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineAsyncTaskManager.h"
+
+/** Version of the async task recording format, 2 since task ids are unique across task managers */
+#define ONLINE_ASYNC_RECORDING_VERSION 2
+
+/** Events stored in an async task recording */
+namespace EOnlineAsyncRecordEvent
+{
+	enum Type
+	{
+		/** Adds a name to the name table, later events refer to it by index */
+		Name,
+		/** A task was queued */
+		Enqueue,
+		/** A task became the active task of its lane, or was queued as a parallel task */
+		Activate,
+		/** A task was handed back to the game thread */
+		Complete,
+		/** A task was finalized on the game thread */
+		Finalize
+	};
+}
+
+/** Life of a single task read back from a recording, times are relative to the start of the recording */
+struct ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncRecordedTask
+{
+	/** Id the task had while recording */
+	uint32 TaskId;
+	/** Type of the task */
+	FName Name;
+	/** Serialization lane of the task */
+	FName Lane;
+	/** Whether the task was queued with AddToParallelTasks */
+	bool bIsParallel;
+	/** Dispatch priority of the task */
+	EOnlineAsyncPriority::Type Priority;
+	/** Whether the task succeeded */
+	bool bWasSuccessful;
+	/** Event times, negative if the event wasn't recorded */
+	double EnqueueTime;
+	double ActivateTime;
+	double CompleteTime;
+	double FinalizeTime;
+	/** Position of the task in finalize order, -1 if it wasn't finalized */
+	int32 FinalizeOrder;
+
+	FOnlineAsyncRecordedTask()
+		: TaskId(0)
+		, bIsParallel(false)
+		, Priority(EOnlineAsyncPriority::Normal)
+		, bWasSuccessful(false)
+		, EnqueueTime(-1.0)
+		, ActivateTime(-1.0)
+		, CompleteTime(-1.0)
+		, FinalizeTime(-1.0)
+		, FinalizeOrder(-1)
+	{
+	}
+};
+
+/** Outcome of replaying a recording */
+struct FOnlineAsyncReplayResult
+{
+	/** Number of tasks replayed */
+	int32 NumTasks;
+	/** Number of Step calls it took */
+	int32 NumSteps;
+	/** Virtual time from the first enqueue to the last finalize */
+	double VirtualSeconds;
+	/** Wall time the replay took, the measure of task manager overhead */
+	double WallSeconds;
+	/** Number of tasks finalized at another position than in the recording */
+	int32 NumReordered;
+	/** Recorded ids of the tasks in the order they were finalized */
+	TArray<uint32> FinalizeOrder;
+
+	FOnlineAsyncReplayResult()
+		: NumTasks(0)
+		, NumSteps(0)
+		, VirtualSeconds(0.0)
+		, WallSeconds(0.0)
+		, NumReordered(0)
+	{
+	}
+};
+
+/**
+ * Records the enqueue, activate, complete and finalize events of every async task manager
+ * to a compact binary file, and replays such recordings on a deterministic task manager.
+ * A replay runs synthetic tasks with the recorded lanes, priorities and durations, so
+ * ordering bugs from a production capture reproduce without the network and scheduler
+ * changes can be benchmarked on the same workload. Controlled with "ONLINE ASYNCRECORD"
+ */
+class ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncTaskRecorder
+{
+public:
+	/** @return the process wide instance */
+	static FOnlineAsyncTaskRecorder& Get();
+
+	/** @return true if events are being written */
+	bool IsRecording() const
+	{
+		return bIsRecording;
+	}
+
+	/**
+	 * Starts writing events, stopping any previous recording
+	 * @param Filename the file to write, in the profiling dir if empty
+	 * @return true if the file could be opened
+	 */
+	bool StartRecording(FString Filename);
+
+	/** Stops writing events and closes the file */
+	void StopRecording();
+
+	/**
+	 * Records a queued task
+	 *
+	 * @param TaskId id the task manager gave the task
+	 * @param Time the clock time of the task manager
+	 * @param TaskName the type of the task
+	 * @param Lane serialization lane of the task
+	 * @param bIsParallel whether the task was queued as a parallel task
+	 * @param Priority dispatch priority of the task
+	 */
+	void RecordEnqueue(uint32 TaskId, double Time, FName TaskName, FName Lane, bool bIsParallel, EOnlineAsyncPriority::Type Priority);
+
+	/** Records a task starting to run */
+	void RecordActivate(uint32 TaskId, double Time);
+
+	/** Records a task handed back to the game thread, the item is remembered until finalized */
+	void RecordComplete(const FOnlineAsyncItem* Item, uint32 TaskId, double Time, bool bWasSuccessful);
+
+	/** Records an item being finalized, ignored for items that weren't recorded as completed */
+	void RecordFinalize(const FOnlineAsyncItem* Item, double Time);
+
+	/**
+	 * Reads a recording back
+	 *
+	 * @param Filename the file to read
+	 * @param OutTasks the recorded tasks in enqueue order
+	 * @return false if the file is missing or not a recording
+	 */
+	static bool LoadRecording(const FString& Filename, TArray<FOnlineAsyncRecordedTask>& OutTasks);
+
+	/**
+	 * Queues synthetic tasks with the recorded timing on a deterministic task manager and steps it until all of them were finalized
+	 *
+	 * @param TaskManager a task manager in deterministic mode
+	 * @param Tasks the recorded tasks, only those that completed are replayed
+	 * @param StepSeconds virtual time per Step
+	 * @return the replay statistics and finalize order
+	 */
+	static FOnlineAsyncReplayResult Replay(FOnlineAsyncTaskManager& TaskManager, const TArray<FOnlineAsyncRecordedTask>& Tasks, double StepSeconds);
+
+	/**
+	 * Handles START [Filename] and STOP
+	 * @return true if the command was handled
+	 */
+	bool Exec(const TCHAR* Cmd, FOutputDevice& Ar);
+
+private:
+	FOnlineAsyncTaskRecorder();
+
+	/** Writes the common part of an event, Lock must be held */
+	void WriteEvent(EOnlineAsyncRecordEvent::Type Type, uint32 TaskId, double Time);
+
+	/** @return the index of the name in the name table, written out on first use. Lock must be held */
+	uint32 GetNameIndex(FName InName);
+
+	/** Guards everything below, events come from the online, worker and game threads */
+	FCriticalSection Lock;
+	/** File being written */
+	FArchive* Writer;
+	/** Time of the first event */
+	double StartTime;
+	/** Time of the last event in microseconds since StartTime, times are written as deltas */
+	uint64 LastMicros;
+	/** Name table written so far */
+	TMap<FName, uint32> NameIndices;
+	/** Items handed back to the game thread by task id, to recognize them when finalized */
+	TMap<const FOnlineAsyncItem*, uint32> CompletedItems;
+	/** Number of events written */
+	int32 NumEvents;
+	/** Whether events are being written */
+	volatile bool bIsRecording;
+};
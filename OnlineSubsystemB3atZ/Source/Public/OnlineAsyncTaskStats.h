@@ -0,0 +1,192 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Sub buckets per power of two, 8 keeps every bucket within 12.5% of its value */
+#define ONLINE_LATENCY_SUB_BUCKET_BITS 3
+#define ONLINE_LATENCY_SUB_BUCKETS (1 << ONLINE_LATENCY_SUB_BUCKET_BITS)
+
+/** Largest power of two tracked in microseconds, 2^40 us is about 12 days */
+#define ONLINE_LATENCY_MAX_EXPONENT 40
+
+/** Number of buckets of a latency histogram */
+#define ONLINE_LATENCY_NUM_BUCKETS ((ONLINE_LATENCY_MAX_EXPONENT - ONLINE_LATENCY_SUB_BUCKET_BITS + 2) * ONLINE_LATENCY_SUB_BUCKETS)
+
+/** Number of trace events kept while tracing, older events are overwritten */
+#define ONLINE_ASYNC_TRACE_CAPACITY 65536
+
+/** Timed phases in the life of an async item */
+namespace EOnlineAsyncTaskPhase
+{
+	enum Type
+	{
+		/** From creation until the online thread starts ticking it */
+		QueueWait,
+		/** From the first tick until it is handed back to the game thread */
+		Execute,
+		/** Finalize and TriggerDelegates on the game thread */
+		Finalize,
+		/** Number of phases */
+		Count
+	};
+
+	/** @return a printable name of the phase */
+	ONLINESUBSYSTEMB3ATZ_API const TCHAR* ToString(EOnlineAsyncTaskPhase::Type Phase);
+}
+
+/**
+ * Log linear latency histogram in the spirit of HdrHistogram. Values are bucketed by their
+ * power of two and the next ONLINE_LATENCY_SUB_BUCKET_BITS bits, recording is lock free
+ */
+class ONLINESUBSYSTEMB3ATZ_API FOnlineLatencyHistogram
+{
+public:
+	FOnlineLatencyHistogram();
+
+	/**
+	 * Adds a sample, safe to call from any thread
+	 * @param Seconds the latency to record
+	 */
+	void Record(double Seconds);
+
+	/** Clears all samples */
+	void Reset();
+
+	/** @return the number of samples */
+	int64 GetCount() const
+	{
+		return Count;
+	}
+
+	/** @return the largest sample in microseconds */
+	int64 GetMax() const
+	{
+		return MaxMicros;
+	}
+
+	/** @return the average sample in microseconds */
+	double GetMean() const
+	{
+		return Count > 0 ? (double)TotalMicros / Count : 0.0;
+	}
+
+	/**
+	 * @param Percentile the fraction of samples to cover, between 0 and 1
+	 * @return the value in microseconds at or below which the fraction of samples fall
+	 */
+	int64 GetPercentile(double Percentile) const;
+
+	/** @return the bucket a value in microseconds falls into */
+	static int32 GetBucketIndex(uint64 Micros);
+
+	/** @return the largest value in microseconds of a bucket */
+	static uint64 GetBucketUpperBound(int32 Index);
+
+private:
+	volatile int32 Buckets[ONLINE_LATENCY_NUM_BUCKETS];
+	volatile int64 Count;
+	volatile int64 TotalMicros;
+	volatile int64 MaxMicros;
+};
+
+/**
+ * Latency histograms of the async task manager by task type, plus an optional trace
+ * of individual tasks exportable to the Chrome trace event format (chrome://tracing, Perfetto).
+ * Enabled with OSS.AsyncTaskStats, inspected with the "ONLINE ASYNCSTATS" exec command
+ */
+class ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncTaskStats
+{
+public:
+	/** Histograms of a single task type */
+	struct FTaskTypeStats
+	{
+		/** Name the type is reported as */
+		FName Name;
+		/** One histogram per EOnlineAsyncTaskPhase */
+		FOnlineLatencyHistogram Phases[EOnlineAsyncTaskPhase::Count];
+	};
+
+	/** @return the process wide instance */
+	static FOnlineAsyncTaskStats& Get();
+
+	/** @return true if task latencies should be recorded */
+	static bool IsEnabled();
+
+	/** @return true if individual tasks are being traced */
+	bool IsTracing() const
+	{
+		return bIsTracing;
+	}
+
+	/**
+	 * Records the phases of a finished task
+	 *
+	 * @param TaskName the type of the task
+	 * @param CreatedTime when the task was created
+	 * @param ActivatedTime when the online thread started ticking it
+	 * @param CompletedTime when it was handed back to the game thread
+	 * @param FinalizeStartTime when Finalize started
+	 * @param FinalizeEndTime when TriggerDelegates returned
+	 * @param ExecuteThreadId the thread the task ran on
+	 */
+	void RecordTask(FName TaskName, double CreatedTime, double ActivatedTime, double CompletedTime, double FinalizeStartTime, double FinalizeEndTime, uint32 ExecuteThreadId);
+
+	/** Writes the percentiles of every task type to the output device */
+	void Dump(FOutputDevice& Ar);
+
+	/** Clears all histograms */
+	void Reset();
+
+	/** Starts recording individual tasks, dropping any previous trace */
+	void StartTrace();
+
+	/** Stops recording individual tasks, the trace is kept until saved or restarted */
+	void StopTrace();
+
+	/**
+	 * Writes the trace in the Chrome trace event format
+	 * @param Filename the file to write, in the profiling dir if empty
+	 * @return true if the file was written
+	 */
+	bool SaveTrace(FString Filename);
+
+	/**
+	 * Handles DUMP, RESET, TRACE START, TRACE STOP and TRACE SAVE [Filename]
+	 * @return true if the command was handled
+	 */
+	bool Exec(const TCHAR* Cmd, FOutputDevice& Ar);
+
+private:
+	FOnlineAsyncTaskStats();
+
+	/** @return the histograms of the task type, created on first use */
+	FTaskTypeStats& FindOrAddType(FName TaskName);
+
+	/** Appends a span to the trace ring */
+	void AddTraceEvent(FName TaskName, EOnlineAsyncTaskPhase::Type Phase, double StartTime, double EndTime, uint32 ThreadId);
+
+	/** A single traced span */
+	struct FTraceEvent
+	{
+		FName Name;
+		EOnlineAsyncTaskPhase::Type Phase;
+		uint32 ThreadId;
+		double StartTime;
+		double EndTime;
+	};
+
+	/** Guards TaskTypes, only taken to find a type */
+	FCriticalSection TaskTypesLock;
+	/** Histograms by task type, never removed so pointers stay valid */
+	TMap<FName, FTaskTypeStats*> TaskTypes;
+
+	/** Ring of traced spans, allocated when tracing starts */
+	TArray<FTraceEvent> TraceEvents;
+	/** Total number of spans written into the ring */
+	volatile int32 NumTraceEvents;
+	/** Whether spans are being recorded */
+	volatile bool bIsTracing;
+};
@@ -0,0 +1,91 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+class FEvent;
+class FRunnableThread;
+class FOnlineAsyncTask;
+class FOnlineAsyncTaskManager;
+
+/**
+ * Worker threads ticking the CPU bound parallel tasks of an async task manager, so a
+ * large JSON parse or leaderboard merge doesn't hold up the online thread or each other.
+ * Every worker owns a deque it takes its newest task from, idle workers steal the oldest
+ * task of another worker. Each deque has its own lock, so workers only contend while stealing.
+ * Sized with AsyncWorkerPoolSize in the [OnlineSubsystemB3atZ] section of the engine ini
+ */
+class ONLINESUBSYSTEMB3ATZ_API FOnlineAsyncWorkerPool
+{
+public:
+	/**
+	 * Starts the worker threads
+	 *
+	 * @param InTaskManager the manager finished tasks are handed back to
+	 * @param NumWorkers the number of threads to start
+	 */
+	FOnlineAsyncWorkerPool(FOnlineAsyncTaskManager& InTaskManager, int32 NumWorkers);
+
+	/** Stops the worker threads, tasks that didn't finish yet are handed back to the task manager as cancelled */
+	~FOnlineAsyncWorkerPool();
+
+	/**
+	 * Queues an initialized task on an idle worker if there is one, safe to call from any thread
+	 * @param Task the task to tick until done
+	 */
+	void AddTask(FOnlineAsyncTask* Task);
+
+	/** @return the number of worker threads */
+	int32 GetNumWorkers() const
+	{
+		return Workers.Num();
+	}
+
+private:
+	/** A worker thread and its deque */
+	class FWorker : public FRunnable
+	{
+	public:
+		FWorker(FOnlineAsyncWorkerPool& InPool, int32 InIndex);
+		virtual ~FWorker();
+
+		// FRunnable
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+
+		/** Owning pool */
+		FOnlineAsyncWorkerPool& Pool;
+		/** Index in the pool, used to pick steal victims */
+		int32 Index;
+		/** Guards Tasks */
+		FCriticalSection TasksLock;
+		/** Oldest task first, the owner pops from the back and thieves take from the front */
+		TArray<FOnlineAsyncTask*> Tasks;
+		/** Signaled when a task is queued on this worker */
+		FEvent* WorkEvent;
+		/** Whether the worker waits for work */
+		volatile int32 bIsIdle;
+		/** Whether the worker should exit */
+		volatile int32 bRequestingExit;
+		/** The thread running the worker */
+		FRunnableThread* Thread;
+	};
+
+	/** @return the newest task of the worker or one stolen from another worker, nullptr if there is none */
+	FOnlineAsyncTask* FindWork(FWorker& Worker);
+
+	/** Ticks a task once, hands it back to the task manager when done and requeues it otherwise */
+	void RunTask(FWorker& Worker, FOnlineAsyncTask* Task);
+
+	/** Manager the tasks belong to */
+	FOnlineAsyncTaskManager& TaskManager;
+	/** The worker threads */
+	TArray<FWorker*> Workers;
+	/** Worker to start looking for an idle one at */
+	volatile int32 NextWorker;
+	/** Number of tasks waiting in the deques, idle workers only look for work to steal while there are any */
+	volatile int32 NumQueuedTasks;
+};
@@ -81,6 +81,9 @@ public:
 
 };
 
+/** Strings and blobs up to this many bytes (string terminator included) are stored inside FVariantData without allocating */
+#define VARIANT_DATA_INLINE_SIZE 22
+
 /**
  *	Container for storing data of variable type
  */
@@ -91,6 +94,8 @@ private:
 
 	/** Current data type */
 	EOnlineKeyValuePairDataType::Type Type;
+	/** Whether a string or blob lives in Value.AsInline instead of on the heap */
+	bool bIsInline;
 	/** Union of all possible types that can be stored */
 	union ValueUnion
 	{
@@ -107,22 +112,56 @@ private:
 			uint8* BlobData;
 			uint32 BlobSize;
 		} AsBlob;
+		/** Short strings (with terminator) and blobs, Size is only used by blobs */
+		struct
+		{
+			uint8 Data[VARIANT_DATA_INLINE_SIZE];
+			uint8 Size;
+		} AsInline;
 
 		ValueUnion() { FMemory::Memset( this, 0, sizeof( ValueUnion ) ); }
 	} Value;
 
+	/** Forgets the payload without freeing it, used once its ownership moved elsewhere */
+	FORCEINLINE void ResetWithoutFree()
+	{
+		Type = EOnlineKeyValuePairDataType::Empty;
+		bIsInline = false;
+		FMemory::Memset(&Value, 0, sizeof(ValueUnion));
+	}
+
 public:
 
+	/** @return the string payload wherever it is stored without copying it, NULL if it was set from a NULL string. Only valid for String data */
+	FORCEINLINE const TCHAR* GetStringData() const
+	{
+		return bIsInline ? (const TCHAR*)Value.AsInline.Data : Value.AsTCHAR;
+	}
+
+	/** @return the blob payload wherever it is stored without copying it. Only valid for Blob data */
+	FORCEINLINE const uint8* GetBlobData() const
+	{
+		return bIsInline ? Value.AsInline.Data : Value.AsBlob.BlobData;
+	}
+
+	/** @return the size of the blob payload. Only valid for Blob data */
+	FORCEINLINE uint32 GetBlobSize() const
+	{
+		return bIsInline ? (uint32)Value.AsInline.Size : Value.AsBlob.BlobSize;
+	}
+
 	/** Constructor */
 	FVariantData() :
-		Type(EOnlineKeyValuePairDataType::Empty)
+		Type(EOnlineKeyValuePairDataType::Empty),
+		bIsInline(false)
 	{
 	}
 
 	/** Constructor starting with an initialized value/type */
 	template<typename ValueType> 
 	FVariantData(const ValueType& InData) :
-		Type(EOnlineKeyValuePairDataType::Empty)
+		Type(EOnlineKeyValuePairDataType::Empty),
+		bIsInline(false)
 	{
 		SetValue(InData);
 	}
@@ -141,6 +180,38 @@ public:
 	 */
 	FVariantData& operator=(const FVariantData& Other);
 
+	/**
+	 * Move constructor. Takes over the other's string or blob buffer, leaving it empty
+	 *
+	 * @param Other the other structure to move from
+	 */
+	FVariantData(FVariantData&& Other) :
+		Type(Other.Type),
+		bIsInline(Other.bIsInline)
+	{
+		// Heap payloads change owner, inline ones are copied along with the union
+		FMemory::Memcpy(&Value, &Other.Value, sizeof(ValueUnion));
+		Other.ResetWithoutFree();
+	}
+
+	/**
+	 * Move assignment operator. Frees this object's data and takes over the other's, leaving it empty
+	 *
+	 * @param Other the other structure to move from
+	 */
+	FVariantData& operator=(FVariantData&& Other)
+	{
+		if (this != &Other)
+		{
+			Empty();
+			Type = Other.Type;
+			bIsInline = Other.bIsInline;
+			FMemory::Memcpy(&Value, &Other.Value, sizeof(ValueUnion));
+			Other.ResetWithoutFree();
+		}
+		return *this;
+	}
+
 	/**
 	 * Cleans up the data to prevent leaks
 	 */
@@ -176,6 +247,15 @@ public:
 	 */
 	void SetValue(const TCHAR* InData);
 
+	/**
+	 * Makes this a string and leaves the characters to the caller, so decoders can write straight into the storage
+	 *
+	 * @param MaxChars the most characters the caller writes, the terminator excluded
+	 *
+	 * @return room for MaxChars characters and their terminator, holding an empty string
+	 */
+	TCHAR* SetStringUninitialized(int32 MaxChars);
+
 	/**
 	 * Copies the data and sets the type
 	 *
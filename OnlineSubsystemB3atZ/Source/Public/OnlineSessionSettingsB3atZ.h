@@ -338,6 +338,15 @@ public:
 	 */
 	void Set(FName Key, const FOnlineSessionSetting& SrcSetting);
 
+	/**
+	 *	Sets a key value pair combination that defines a session setting
+	 * by taking over an existing session setting's data
+	 *
+	 * @param Key key for the setting
+	 * @param SrcSetting setting values, left empty
+	 */
+	void Set(FName Key, FOnlineSessionSetting&& SrcSetting);
+
 	/**
 	 *	Gets a key value pair combination that defines a session setting
 	 *
@@ -50,10 +50,32 @@ DECLARE_STATS_GROUP(TEXT("Online"), STATGROUP_B3atZOnline, STATCAT_Advanced);
 DECLARE_CYCLE_STAT_EXTERN(TEXT("OnlineAsync"), STAT_B3atZOnline_Async, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
 /** Number of async tasks in queue */
 DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("NumTasks"), STAT_B3atZOnline_AsyncTasks, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Time GameTick spends finalizing completed async items */
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnlineAsyncDispatch"), STAT_B3atZOnline_AsyncDispatch, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of completed async items finalized per frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AsyncDispatched"), STAT_B3atZOnline_AsyncDispatched, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of completed async items carried over to the next frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AsyncDeferred"), STAT_B3atZOnline_AsyncDeferred, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of frames in which finalizing async items ran past GameTickBudgetInMs */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AsyncBudgetOverruns"), STAT_B3atZOnline_AsyncBudgetOverruns, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of async items allocated from the item pools per frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AsyncItemPoolAllocs"), STAT_B3atZOnline_AsyncItemPoolAllocs, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of async items too large for the item pools allocated from the heap per frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AsyncItemHeapAllocs"), STAT_B3atZOnline_AsyncItemHeapAllocs, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of async items currently allocated */
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("AsyncItemsLive"), STAT_B3atZOnline_AsyncItemsLive, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of CPU bound tasks async workers took from another worker per frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AsyncWorkerSteals"), STAT_B3atZOnline_AsyncWorkerSteals, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
 /** Total time to process session interface */
 DECLARE_CYCLE_STAT_EXTERN(TEXT("SessionInt"), STAT_B3atZSession_Interface, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
 /** Total time to process both local/remote voice */
 DECLARE_CYCLE_STAT_EXTERN(TEXT("VoiceInt"), STAT_B3atZVoice_Interface, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of LAN beacon queries handed to the session per frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("LanQueriesAnswered"), STAT_B3atZOnline_LanQueriesAnswered, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of LAN beacon queries dropped by the per source rate limit per frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("LanQueriesDropped"), STAT_B3atZOnline_LanQueriesDropped, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
+/** Number of LAN beacon queries folded into an earlier answer with the same nonce per frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("LanQueriesCoalesced"), STAT_B3atZOnline_LanQueriesCoalesced, STATGROUP_B3atZOnline, ONLINESUBSYSTEMB3ATZ_API);
 
 #define ONLINE_LOG_PREFIX TEXT("OSS: ")
 #define UE_LOG_ONLINEB3ATZ(Verbosity, Format, ...) \
@@ -6,6 +6,66 @@
 #include "CoreMinimal.h"
 #include "OnlineSubsystemB3atZDirectTypes.h"
 #include "NboSerializer.h"
+#include "B3atZBeacon.h"
+
+/** Bits of the session flags in the compact settings encoding and the session header */
+namespace ECompactSessionFlags
+{
+	enum Type
+	{
+		ShouldAdvertise = 1 << 0,
+		IsLANMatch = 1 << 1,
+		IsDedicated = 1 << 2,
+		UsesStats = 1 << 3,
+		AllowJoinInProgress = 1 << 4,
+		AllowInvites = 1 << 5,
+		UsesPresence = 1 << 6,
+		AllowJoinViaPresence = 1 << 7,
+		AllowJoinViaPresenceFriendsOnly = 1 << 8,
+		AntiCheatProtected = 1 << 9
+	};
+}
+
+/** Fields of FDirectSessionHeader */
+namespace EDirectSessionHeaderField
+{
+	enum Type
+	{
+		HostIp,
+		HostPort,
+		NumOpenPrivateConnections,
+		NumOpenPublicConnections,
+		NumPublicConnections,
+		NumPrivateConnections,
+		/** ECompactSessionFlags bits */
+		Flags,
+		BuildUniqueId
+	};
+}
+
+/**
+ * Session body of host responses since LAN_BEACON_SESSION_LAYOUT_VERSION, written by AppendSessionToPacket
+ * and read by ReadSessionFromPacket:
+ *
+ *	<FHeader><owner id><owner name><session id><settings count><settings>
+ *
+ * The strings are packed strings and the settings use the compact encoding
+ */
+struct FDirectSessionPacket
+{
+	/** Fixed fields the body starts with */
+	typedef TNboPacketLayout<uint32, int32, int32, int32, int32, int32, uint16, int32> FHeader;
+
+	/** Largest body a host sends, what is left of the largest response after the beacon header */
+	static constexpr uint32 MaxSize = LAN_BEACON_MAX_RESPONSE_SIZE - LAN_BEACON_PACKET_HEADER_SIZE;
+};
+
+/** The header size is part of the wire format, keep it in sync with the layout */
+#define LAN_SESSION_HEADER_SIZE 30
+
+static_assert(FDirectSessionPacket::FHeader::Size == LAN_SESSION_HEADER_SIZE, "Session header size changed");
+static_assert(ECompactSessionFlags::AntiCheatProtected <= MAX_uint16, "Session flags no longer fit the header");
+static_assert(LAN_BEACON_PACKET_HEADER_SIZE + LAN_SESSION_HEADER_SIZE <= LAN_BEACON_MAX_PACKET_SIZE, "Session header must fit the first packet");
 
 /**
  * Serializes data in network byte order form into a buffer
@@ -20,8 +80,14 @@ public:
 	}
 
 	/** Constructor specifying the size to use */
-	FNboSerializeToBufferDirect(uint32 Size) :
-		FNboSerializeToBuffer(Size)
+	FNboSerializeToBufferDirect(uint32 Size, ENboWriteMode::Type Mode = ENboWriteMode::Fixed) :
+		FNboSerializeToBuffer(Size, Mode)
+	{
+	}
+
+	/** Constructor writing to a buffer owned by the caller */
+	FNboSerializeToBufferDirect(uint8* ExternalBuffer, uint32 Size) :
+		FNboSerializeToBuffer(ExternalBuffer, Size)
 	{
 	}
 
@@ -45,6 +111,89 @@ public:
 		Ar << UniqueId.UniqueNetIdStr;
 		return Ar;
 	}
+
+	/**
+	 * Adds a session setting in the compact encoding: one tag byte holding the data type,
+	 * the advertisement type and bool values, followed by packed numbers or strings
+	 */
+	void WriteCompactSetting(const FOnlineSessionSetting& Setting)
+	{
+		const EOnlineKeyValuePairDataType::Type Type = Setting.Data.GetType();
+		uint8 Tag = (uint8)Type | ((uint8)Setting.AdvertisementType << 4);
+		if (Type == EOnlineKeyValuePairDataType::Bool)
+		{
+			bool Value;
+			Setting.Data.GetValue(Value);
+			Tag |= Value ? 0x40 : 0;
+		}
+		(*this) << Tag;
+
+		switch (Type)
+		{
+		case EOnlineKeyValuePairDataType::Int32:
+			{
+				int32 Value;
+				Setting.Data.GetValue(Value);
+				WritePackedInt(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::UInt32:
+			{
+				uint32 Value;
+				Setting.Data.GetValue(Value);
+				WritePackedUInt(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Int64:
+			{
+				int64 Value;
+				Setting.Data.GetValue(Value);
+				WritePackedInt(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::UInt64:
+			{
+				uint64 Value;
+				Setting.Data.GetValue(Value);
+				WritePackedUInt(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Float:
+			{
+				float Value;
+				Setting.Data.GetValue(Value);
+				(*this) << Value;
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Double:
+			{
+				double Value;
+				Setting.Data.GetValue(Value);
+				(*this) << Value;
+				break;
+			}
+		case EOnlineKeyValuePairDataType::String:
+			{
+				// Encoded from the variant's storage, without a copy
+				const TCHAR* Value = Setting.Data.GetStringData();
+				WritePackedUtf8(Value, Value != NULL ? FCString::Strlen(Value) : 0);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Blob:
+			{
+				const uint32 Size = Setting.Data.GetBlobSize();
+				WritePackedUInt(Size);
+				if (Size > 0)
+				{
+					WriteBinary(Setting.Data.GetBlobData(), Size);
+				}
+				break;
+			}
+		default:
+			// Empty and bool carry everything in the tag
+			break;
+		}
+	}
 };
 
 /**
@@ -61,6 +210,14 @@ public:
 	{
 	}
 
+	/**
+	 * Flags data that was read fine but makes no sense, so the packet is dropped like a truncated one
+	 */
+	void MarkOverflowed()
+	{
+		bHasOverflowed = true;
+	}
+
 	/**
 	 * Reads Direct session info from the buffer
 	 */
@@ -81,4 +238,103 @@ public:
 		Ar >> UniqueId.UniqueNetIdStr;
 		return Ar;
 	}
+
+	/**
+	 * Reads a session setting written by FNboSerializeToBufferDirect::WriteCompactSetting
+	 */
+	void ReadCompactSetting(FOnlineSessionSetting& Setting)
+	{
+		uint8 Tag = 0;
+		(*this) >> Tag;
+		if (HasOverflow())
+		{
+			return;
+		}
+
+		Setting.AdvertisementType = (EB3atZOnlineDataAdvertisementType::Type)((Tag >> 4) & 0x3);
+		switch ((EOnlineKeyValuePairDataType::Type)(Tag & 0xF))
+		{
+		case EOnlineKeyValuePairDataType::Empty:
+			{
+				Setting.Data.Empty();
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Int32:
+			{
+				int64 Value;
+				ReadPackedInt(Value);
+				Setting.Data.SetValue((int32)Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::UInt32:
+			{
+				uint64 Value;
+				ReadPackedUInt(Value);
+				Setting.Data.SetValue((uint32)Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Int64:
+			{
+				int64 Value;
+				ReadPackedInt(Value);
+				Setting.Data.SetValue(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::UInt64:
+			{
+				uint64 Value;
+				ReadPackedUInt(Value);
+				Setting.Data.SetValue(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Float:
+			{
+				float Value;
+				(*this) >> Value;
+				Setting.Data.SetValue(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Double:
+			{
+				double Value;
+				(*this) >> Value;
+				Setting.Data.SetValue(Value);
+				break;
+			}
+		case EOnlineKeyValuePairDataType::String:
+			{
+				// Decoded straight into the setting
+				FNboStringView View;
+				if (ReadPackedStringView(View))
+				{
+					ReadUtf8Into(View, Setting.Data);
+				}
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Blob:
+			{
+				uint64 Length = 0;
+				ReadPackedUInt(Length);
+				if (!HasOverflow() && Length <= (uint64)AvailableToRead())
+				{
+					Setting.Data.SetValue((uint32)Length, &Data[CurrentOffset]);
+					CurrentOffset += (int32)Length;
+				}
+				else
+				{
+					bHasOverflowed = true;
+				}
+				break;
+			}
+		case EOnlineKeyValuePairDataType::Bool:
+			{
+				Setting.Data.SetValue((Tag & 0x40) != 0);
+				break;
+			}
+		default:
+			// Unknown types can't be skipped, so the rest of the packet is unreadable
+			bHasOverflowed = true;
+			break;
+		}
+	}
 };
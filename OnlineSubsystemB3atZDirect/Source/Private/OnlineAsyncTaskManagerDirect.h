@@ -29,4 +29,10 @@ public:
 
 	// FOnlineAsyncTaskManager
 	virtual void OnlineTick() override;
+
+	/** Nothing is polled on the online thread, so it only needs to run for queued tasks */
+	virtual double GetNextOnlineTickTime() const override
+	{
+		return MAX_dbl;
+	}
 };
@@ -3,6 +3,7 @@
 
 #include "OnlineSessionInterfaceDirect.h"
 #include "Misc/Guid.h"
+#include "Misc/ConfigCacheIni.h"
 #include "OnlineSubsystemB3atZ.h"
 #include "OnlineSubsystemB3atZUtils.h"
 #include "OnlineSubsystemB3atZDirect.h"
@@ -10,6 +11,7 @@
 #include "OnlineAsyncTaskManager.h"
 #include "SocketSubsystem.h"
 #include "NboSerializerDirect.h"
+#include "OnlineSubsystemSessionSettings.h"
 #include "Engine/EngineBaseTypes.h"
 
 
@@ -78,6 +80,12 @@ public:
 		return FString::Printf(TEXT("FOnlineAsyncTaskDirectEndSession bWasSuccessful: %d SessionName: %s"), bWasSuccessful, *SessionName.ToString());
 	}
 
+	/** Session state changes go out before cosmetic completions */
+	virtual EOnlineAsyncPriority::Type GetPriority() const override
+	{
+		return EOnlineAsyncPriority::High;
+	}
+
 	/**
 	 * Give the async task time to do its work
 	 * Can only be called on the async task manager thread
@@ -143,6 +151,12 @@ public:
 		return FString::Printf(TEXT("FOnlineAsyncTaskDirectDestroySession bWasSuccessful: %d SessionName: %s"), bWasSuccessful, *SessionName.ToString());
 	}
 
+	/** Session state changes go out before cosmetic completions */
+	virtual EOnlineAsyncPriority::Type GetPriority() const override
+	{
+		return EOnlineAsyncPriority::High;
+	}
+
 	/**
 	 * Give the async task time to do its work
 	 * Can only be called on the async task manager thread
@@ -382,6 +396,7 @@ bool FOnlineSessionDirect::StartSession(FName SessionName)
 			// If this lan match has join in progress disabled, shut down the beacon
 			Result = UpdateLANStatus();
 			Session->SessionState = EB3atZOnlineSessionState::InProgress;
+			InvalidateCachedQueryResponse(SessionName);
 		}
 		else
 		{
@@ -419,6 +434,7 @@ bool FOnlineSessionDirect::UpdateSession(FName SessionName, FOnlineSessionSettin
 	{
 		// @TODO ONLINE update LAN settings
 		Session->SessionSettings = UpdatedSessionSettings;
+		InvalidateCachedQueryResponse(SessionName);
 		TriggerOnUpdateSessionCompleteDelegates(SessionName, bWasSuccessful);
 	}
 
@@ -439,6 +455,7 @@ bool FOnlineSessionDirect::EndSession(FName SessionName)
 		if (Session->SessionState == EB3atZOnlineSessionState::InProgress)
 		{
 			Session->SessionState = EB3atZOnlineSessionState::Ended;
+			InvalidateCachedQueryResponse(SessionName);
 
 			// If the session should be advertised and the lan beacon was destroyed, recreate
 			Result = UpdateLANStatus();
@@ -532,6 +549,13 @@ bool FOnlineSessionDirect::FindSessions(int32 SearchingPlayerNum, const TSharedR
 	{
 		// Free up previous results
 		SearchSettings->SearchResults.Empty();
+		SearchResultIndices.Empty();
+		ResetSearchPings();
+
+		if (!GConfig->GetInt(TEXT("OnlineSubsystemB3atZ"), TEXT("LanBeaconMaxConcurrentPings"), MaxConcurrentPings, GEngineIni) || MaxConcurrentPings <= 0)
+		{
+			MaxConcurrentPings = B3atZ_MAX_CONCURRENT_PINGS;
+		}
 
 		// Copy the search pointer so we can keep it around
 		CurrentSessionSearch = SearchSettings;
@@ -598,9 +622,22 @@ uint32 FOnlineSessionDirect::FindLANSession()
 	FOnValidResponsePacketDelegate ResponseDelegate = FOnValidResponsePacketDelegate::CreateRaw(this, &FOnlineSessionDirect::OnValidResponsePacketReceived);
 	FOnSearchingTimeoutDelegate TimeoutDelegate = FOnSearchingTimeoutDelegate::CreateRaw(this, &FOnlineSessionDirect::OnLANSearchTimeout);
 
-	FNboSerializeToBufferDirect Packet(LAN_BEACON_MAX_PACKET_SIZE);
+	uint8 PacketBuffer[LAN_BEACON_MAX_PACKET_SIZE];
+	FNboSerializeToBufferDirect Packet(PacketBuffer, LAN_BEACON_MAX_PACKET_SIZE);
 	B3atZSessionManager.CreateClientQueryPacket(Packet, B3atZSessionManager.B3atZNonce);
-	if (B3atZSessionManager.Search(Packet, ResponseDelegate, TimeoutDelegate) == false)
+	// Hosts only answer if one of their sessions matches our search
+	AppendSearchParamsToPacket(Packet, CurrentSessionSearch->QuerySettings);
+	if (Packet.HasOverflow())
+	{
+		UE_LOG_ONLINEB3ATZ(Warning, TEXT("Search parameters do not fit into a LAN query packet, searching unfiltered"));
+		Packet = FNboSerializeToBufferDirect(PacketBuffer, LAN_BEACON_MAX_PACKET_SIZE);
+		B3atZSessionManager.CreateClientQueryPacket(Packet, B3atZSessionManager.B3atZNonce);
+	}
+	if (B3atZSessionManager.Search(Packet, ResponseDelegate, TimeoutDelegate))
+	{
+		B3atZSessionManager.AddOnPingResponseDelegate_Handle(FOnPingResponseDelegate::CreateRaw(this, &FOnlineSessionDirect::OnPingResponseReceived));
+	}
+	else
 	{
 		UE_LOG_ONLINEB3ATZ(Verbose, TEXT("OSID FindLANSession Search in LANSessionManager failed"));
 
@@ -790,9 +827,88 @@ uint32 FOnlineSessionDirect::JoinLANSession(int32 PlayerNum, FNamedOnlineSession
 
 bool FOnlineSessionDirect::PingSearchResults(const FOnlineSessionSearchResult& SearchResult)
 {
+	// Pings travel over the search beacon, so only results of the running search can be pinged
+	if (CurrentSessionSearch.IsValid() &&
+		B3atZSessionManager.GetBeaconState() == EB3atZBeaconState::Searching &&
+		SearchResult.Session.SessionInfo.IsValid())
+	{
+		const int32* ResultIdx = SearchResultIndices.Find(FSearchResultKey(SearchResult.Session));
+		if (ResultIdx != NULL)
+		{
+			PendingPings.AddUnique(*ResultIdx);
+			bPingSearchResultsPending = true;
+			SendPendingPings();
+			return true;
+		}
+	}
+
 	return false;
 }
 
+void FOnlineSessionDirect::SendPendingPings()
+{
+	const double Now = FPlatformTime::Seconds();
+
+	// Lost pings must not hold on to their slot
+	for (TMap<int32, double>::TIterator It(OutstandingPings); It; ++It)
+	{
+		if (Now - It.Value() > B3atZ_PING_TIMEOUT)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	while (PendingPings.Num() > 0 && OutstandingPings.Num() < MaxConcurrentPings)
+	{
+		const int32 ResultIdx = PendingPings[0];
+		PendingPings.RemoveAt(0, 1, false);
+
+		if (SearchResultBeaconAddrs.IsValidIndex(ResultIdx) &&
+			B3atZSessionManager.SendPing(*SearchResultBeaconAddrs[ResultIdx], ResultIdx))
+		{
+			OutstandingPings.Add(ResultIdx, Now);
+		}
+	}
+
+	if (bPingSearchResultsPending && PendingPings.Num() == 0 && OutstandingPings.Num() == 0)
+	{
+		bPingSearchResultsPending = false;
+		TriggerOnPingSearchResultsCompleteDelegates(true);
+	}
+}
+
+void FOnlineSessionDirect::ResetSearchPings()
+{
+	SearchResultBeaconAddrs.Empty();
+	PendingPings.Empty();
+	OutstandingPings.Empty();
+
+	if (bPingSearchResultsPending)
+	{
+		bPingSearchResultsPending = false;
+		TriggerOnPingSearchResultsCompleteDelegates(false);
+	}
+}
+
+bool FOnlineSessionDirect::HasReachedMaxSearchResults() const
+{
+	// Zero or less means no limit
+	return CurrentSessionSearch.IsValid() &&
+		CurrentSessionSearch->MaxSearchResults > 0 &&
+		CurrentSessionSearch->SearchResults.Num() >= CurrentSessionSearch->MaxSearchResults;
+}
+
+void FOnlineSessionDirect::OnPingResponseReceived(int32 PingId, double RoundTripSeconds)
+{
+	// Pongs arriving after their ping timed out still carry a valid measurement
+	if (CurrentSessionSearch.IsValid() && CurrentSessionSearch->SearchResults.IsValidIndex(PingId))
+	{
+		CurrentSessionSearch->SearchResults[PingId].PingInMs = static_cast<int32>(RoundTripSeconds * 1000);
+		OutstandingPings.Remove(PingId);
+		SendPendingPings();
+	}
+}
+
 /** Get a resolved connection string from a session info */
 static bool GetConnectStringFromSessionInfo(TSharedPtr<FOnlineSessionInfoDirect>& SessionInfo, FString& ConnectInfo, int32 PortOverride=0)
 {
@@ -978,6 +1094,9 @@ bool FOnlineSessionDirect::RegisterPlayers(FName SessionName, const TArray< TSha
 				UE_LOG_ONLINEB3ATZ(Log, TEXT("Player %s already registered in session %s"), *PlayerId->ToDebugString(), *SessionName.ToString());
 			}			
 		}
+
+		// Open connection counts are part of the advertised data
+		InvalidateCachedQueryResponse(SessionName);
 	}
 	else
 	{
@@ -1028,6 +1147,9 @@ bool FOnlineSessionDirect::UnregisterPlayers(FName SessionName, const TArray< TS
 				UE_LOG_ONLINEB3ATZ(Verbose, TEXT("Player %s is not part of session (%s)"), *PlayerId->ToDebugString(), *SessionName.ToString());
 			}
 		}
+
+		// Open connection counts are part of the advertised data
+		InvalidateCachedQueryResponse(SessionName);
 	}
 	else
 	{
@@ -1052,29 +1174,137 @@ void FOnlineSessionDirect::Tick(float DeltaTime)
 void FOnlineSessionDirect::TickLanTasks(float DeltaTime)
 {
 	B3atZSessionManager.Tick(DeltaTime);
+
+	if (OutstandingPings.Num() > 0)
+	{
+		// Expire unanswered pings so the rest of the queue keeps moving
+		SendPendingPings();
+	}
+
+	// No need to wait for the timeout once the search has all it asked for and the results have their ping
+	if (B3atZSessionManager.GetBeaconState() == EB3atZBeaconState::Searching &&
+		HasReachedMaxSearchResults() &&
+		PendingPings.Num() == 0 && OutstandingPings.Num() == 0)
+	{
+		UE_LOG_ONLINEB3ATZ(Verbose, TEXT("OSID TickLanTasks MaxSearchResults reached, completing search"));
+		OnLANSearchTimeout();
+	}
 }
 
-void FOnlineSessionDirect::AppendSessionToPacket(FNboSerializeToBufferDirect& Packet, FOnlineSession* Session)
+/** @return the ECompactSessionFlags bits of the session settings */
+static uint16 GetCompactSessionFlags(const FOnlineSessionSettings& SessionSettings)
 {
-	UE_LOG(LogB3atZOnline, Verbose, TEXT("OnlineSessionInterfaceDirect AppendSessionToPacket"));
+	return (uint16)(
+		(SessionSettings.bShouldAdvertise ? ECompactSessionFlags::ShouldAdvertise : 0) |
+		(SessionSettings.bIsLANMatch ? ECompactSessionFlags::IsLANMatch : 0) |
+		(SessionSettings.bIsDedicated ? ECompactSessionFlags::IsDedicated : 0) |
+		(SessionSettings.bUsesStats ? ECompactSessionFlags::UsesStats : 0) |
+		(SessionSettings.bAllowJoinInProgress ? ECompactSessionFlags::AllowJoinInProgress : 0) |
+		(SessionSettings.bAllowInvites ? ECompactSessionFlags::AllowInvites : 0) |
+		(SessionSettings.bUsesPresence ? ECompactSessionFlags::UsesPresence : 0) |
+		(SessionSettings.bAllowJoinViaPresence ? ECompactSessionFlags::AllowJoinViaPresence : 0) |
+		(SessionSettings.bAllowJoinViaPresenceFriendsOnly ? ECompactSessionFlags::AllowJoinViaPresenceFriendsOnly : 0) |
+		(SessionSettings.bAntiCheatProtected ? ECompactSessionFlags::AntiCheatProtected : 0));
+}
 
-	/** Owner of the session */
-	Packet << *StaticCastSharedPtr<const FB3atZUniqueNetIdString>(Session->OwningUserId)
-		<< Session->OwningUserName
-		<< Session->NumOpenPrivateConnections
-		<< Session->NumOpenPublicConnections;
+/** Sets the session flags from ECompactSessionFlags bits */
+static void SetCompactSessionFlags(FOnlineSessionSettings& SessionSettings, uint32 Flags)
+{
+	SessionSettings.bShouldAdvertise = (Flags & ECompactSessionFlags::ShouldAdvertise) != 0;
+	SessionSettings.bIsLANMatch = (Flags & ECompactSessionFlags::IsLANMatch) != 0;
+	SessionSettings.bIsDedicated = (Flags & ECompactSessionFlags::IsDedicated) != 0;
+	SessionSettings.bUsesStats = (Flags & ECompactSessionFlags::UsesStats) != 0;
+	SessionSettings.bAllowJoinInProgress = (Flags & ECompactSessionFlags::AllowJoinInProgress) != 0;
+	SessionSettings.bAllowInvites = (Flags & ECompactSessionFlags::AllowInvites) != 0;
+	SessionSettings.bUsesPresence = (Flags & ECompactSessionFlags::UsesPresence) != 0;
+	SessionSettings.bAllowJoinViaPresence = (Flags & ECompactSessionFlags::AllowJoinViaPresence) != 0;
+	SessionSettings.bAllowJoinViaPresenceFriendsOnly = (Flags & ECompactSessionFlags::AllowJoinViaPresenceFriendsOnly) != 0;
+	SessionSettings.bAntiCheatProtected = (Flags & ECompactSessionFlags::AntiCheatProtected) != 0;
+}
+
+void FOnlineSessionDirect::AppendSessionToPacket(FNboSerializeToBufferDirect& Packet, FOnlineSession* Session, uint8 PacketVersion)
+{
+	UE_LOG(LogB3atZOnline, Verbose, TEXT("OnlineSessionInterfaceDirect AppendSessionToPacket"));
 
 	// Try to get the actual port the netdriver is using
 	SetPortFromNetDriver(*DirectSubsystem, Session->SessionInfo);
 
-	// Write host info (host addr, session id, and key)
-	Packet << *StaticCastSharedPtr<FOnlineSessionInfoDirect>(Session->SessionInfo);
+	/** Owner of the session */
+	const FB3atZUniqueNetIdString& OwnerId = *StaticCastSharedPtr<const FB3atZUniqueNetIdString>(Session->OwningUserId);
+	const FOnlineSessionInfoDirect& SessionInfo = *StaticCastSharedPtr<FOnlineSessionInfoDirect>(Session->SessionInfo);
+
+	if (PacketVersion >= LAN_BEACON_SESSION_LAYOUT_VERSION)
+	{
+		// All fixed fields in one write, ReadSessionFromPacket reads them back with the same layout
+		check(SessionInfo.HostAddr.IsValid());
+		uint32 HostIp = 0;
+		SessionInfo.HostAddr->GetIp(HostIp);
+		const FOnlineSessionSettings& SessionSettings = Session->SessionSettings;
+		FDirectSessionPacket::FHeader::Write(Packet,
+			HostIp,
+			SessionInfo.HostAddr->GetPort(),
+			Session->NumOpenPrivateConnections,
+			Session->NumOpenPublicConnections,
+			SessionSettings.NumPublicConnections,
+			SessionSettings.NumPrivateConnections,
+			GetCompactSessionFlags(SessionSettings),
+			SessionSettings.BuildUniqueId);
+
+		Packet.WritePackedString(OwnerId.UniqueNetIdStr);
+		Packet.WritePackedString(Session->OwningUserName);
+		Packet.WritePackedString(SessionInfo.SessionId.UniqueNetIdStr);
+	}
+	else
+	{
+		Packet << OwnerId
+			<< Session->OwningUserName
+			<< Session->NumOpenPrivateConnections
+			<< Session->NumOpenPublicConnections;
+
+		// Write host info (host addr, session id, and key)
+		Packet << SessionInfo;
+	}
 
 	// Now append per game settings
-	AppendSessionSettingsToPacket(Packet, &Session->SessionSettings);
+	AppendSessionSettingsToPacket(Packet, &Session->SessionSettings, PacketVersion);
 }
 
-void FOnlineSessionDirect::AppendSessionSettingsToPacket(FNboSerializeToBufferDirect& Packet, FOnlineSessionSettings* SessionSettings)
+/**
+ * Setting names hosts and clients both know, sent as their index instead of the name.
+ * Only ever append to this list, the indices are part of the beacon format
+ */
+static const TArray<FName>& GetSharedSettingKeys()
+{
+	static const TArray<FName> SharedSettingKeys =
+	{
+		SETTING_MAPNAME,
+		SETTING_NUMBOTS,
+		SETTING_GAMEMODE,
+		SETTING_BEACONPORT,
+		SETTING_QOS,
+		SETTING_REGION,
+		SETTING_DCID,
+		SETTING_NEEDS,
+		SETTING_NEEDSSORT,
+		SETTING_CUSTOMSEARCHINT1,
+		SETTING_CUSTOMSEARCHINT2,
+		SETTING_CUSTOMSEARCHINT3,
+		SETTING_CUSTOMSEARCHINT4,
+		SETTING_CUSTOMSEARCHINT5,
+		SETTING_CUSTOMSEARCHINT6,
+		SETTING_CUSTOMSEARCHINT7,
+		SETTING_CUSTOMSEARCHINT8,
+		SETTING_CUSTOM,
+		SETTING_PARTY_ENABLED_SESSION,
+		SETTING_MATCHING_HOPPER,
+		SETTING_MATCHING_TIMEOUT,
+		SEARCH_PRESENCE,
+		SEARCH_KEYWORDS
+	};
+	return SharedSettingKeys;
+}
+
+void FOnlineSessionDirect::AppendSessionSettingsToPacket(FNboSerializeToBufferDirect& Packet, FOnlineSessionSettings* SessionSettings, uint8 PacketVersion)
 {
 #if DEBUG_LAN_BEACON
 	UE_LOG_ONLINEB3ATZ(Verbose, TEXT("Sending session settings to client"));
@@ -1082,20 +1312,34 @@ void FOnlineSessionDirect::AppendSessionSettingsToPacket(FNboSerializeToBufferDi
 
 	UE_LOG(LogB3atZOnline, Verbose, TEXT("OnlineSessionInterfaceDirect AppendSessionSettingsToPacket"));
 
-	// Members of the session settings class
-	Packet << SessionSettings->NumPublicConnections
-		<< SessionSettings->NumPrivateConnections
-		<< (uint8)SessionSettings->bShouldAdvertise
-		<< (uint8)SessionSettings->bIsLANMatch
-		<< (uint8)SessionSettings->bIsDedicated
-		<< (uint8)SessionSettings->bUsesStats
-		<< (uint8)SessionSettings->bAllowJoinInProgress
-		<< (uint8)SessionSettings->bAllowInvites
-		<< (uint8)SessionSettings->bUsesPresence
-		<< (uint8)SessionSettings->bAllowJoinViaPresence
-		<< (uint8)SessionSettings->bAllowJoinViaPresenceFriendsOnly
-		<< (uint8)SessionSettings->bAntiCheatProtected
-	    << SessionSettings->BuildUniqueId;
+	// Since LAN_BEACON_SESSION_LAYOUT_VERSION the members of the session settings class are part of the session header
+	const bool bIsCompact = PacketVersion >= LAN_BEACON_COMPACT_SETTINGS_VERSION;
+	if (bIsCompact && PacketVersion < LAN_BEACON_SESSION_LAYOUT_VERSION)
+	{
+		// Members of the session settings class, flags packed into a single bitfield
+		Packet.WritePackedInt(SessionSettings->NumPublicConnections);
+		Packet.WritePackedInt(SessionSettings->NumPrivateConnections);
+		Packet.WritePackedUInt(GetCompactSessionFlags(*SessionSettings));
+		// The build id is a hash, packing would only make it longer
+		Packet << SessionSettings->BuildUniqueId;
+	}
+	else if (!bIsCompact)
+	{
+		// Members of the session settings class
+		Packet << SessionSettings->NumPublicConnections
+			<< SessionSettings->NumPrivateConnections
+			<< (uint8)SessionSettings->bShouldAdvertise
+			<< (uint8)SessionSettings->bIsLANMatch
+			<< (uint8)SessionSettings->bIsDedicated
+			<< (uint8)SessionSettings->bUsesStats
+			<< (uint8)SessionSettings->bAllowJoinInProgress
+			<< (uint8)SessionSettings->bAllowInvites
+			<< (uint8)SessionSettings->bUsesPresence
+			<< (uint8)SessionSettings->bAllowJoinViaPresence
+			<< (uint8)SessionSettings->bAllowJoinViaPresenceFriendsOnly
+			<< (uint8)SessionSettings->bAntiCheatProtected
+			<< SessionSettings->BuildUniqueId;
+	}
 
 	// First count number of advertised keys
 	int32 NumAdvertisedProperties = 0;
@@ -1109,14 +1353,37 @@ void FOnlineSessionDirect::AppendSessionSettingsToPacket(FNboSerializeToBufferDi
 	}
 
 	// Add count of advertised keys and the data
-	Packet << (int32)NumAdvertisedProperties;
+	if (bIsCompact)
+	{
+		Packet.WritePackedUInt(NumAdvertisedProperties);
+	}
+	else
+	{
+		Packet << (int32)NumAdvertisedProperties;
+	}
+
+	const TArray<FName>& SharedSettingKeys = GetSharedSettingKeys();
 	for (FSessionSettings::TConstIterator It(SessionSettings->Settings); It; ++It)
 	{
 		const FOnlineSessionSetting& Setting = It.Value();
 		if (Setting.AdvertisementType >= EB3atZOnlineDataAdvertisementType::ViaOnlineService)
 		{
-			Packet << It.Key();
-			Packet << Setting;
+			if (bIsCompact)
+			{
+				// Well known names become their index + 1, zero is followed by the name itself
+				const int32 KeyIndex = SharedSettingKeys.IndexOfByKey(It.Key());
+				Packet.WritePackedUInt(KeyIndex + 1);
+				if (KeyIndex == INDEX_NONE)
+				{
+					Packet.WritePackedString(It.Key().ToString());
+				}
+				Packet.WriteCompactSetting(Setting);
+			}
+			else
+			{
+				Packet << It.Key();
+				Packet << Setting;
+			}
 #if DEBUG_LAN_BEACON
 			UE_LOG_ONLINEB3ATZ(Verbose, TEXT("%s"), *Setting.ToString());
 #endif
@@ -1124,12 +1391,22 @@ void FOnlineSessionDirect::AppendSessionSettingsToPacket(FNboSerializeToBufferDi
 	}
 }
 
-void FOnlineSessionDirect::OnValidQueryPacketReceived(uint8* PacketData, int32 PacketLength, uint64 ClientNonce)
+void FOnlineSessionDirect::OnValidQueryPacketReceived(uint8* PacketData, int32 PacketLength, uint64 ClientNonce, uint8 ClientVersion)
 {
 	UE_LOG(LogB3atZOnline, Verbose, TEXT("OSID OnValidQueryPacketReceived"));
 
 
+	// An empty payload is a query without filter, which every session matches
+	FSearchParams SearchParams;
+	FNboSerializeFromBufferDirect SearchPacket(PacketData, PacketLength);
+	if (PacketLength > 0 && !ReadSearchParamsFromPacket(SearchPacket, SearchParams))
+	{
+		UE_LOG_ONLINEB3ATZ(Verbose, TEXT("Ignoring LAN query with malformed search parameters"));
+		return;
+	}
+
 	// Iterate through all registered sessions and respond for each one that can be joinable
+	bool bWasAnswered = false;
 	FScopeLock ScopeLock(&SessionLock);
 	for (int32 SessionIndex = 0; SessionIndex < Sessions.Num(); SessionIndex++)
 	{
@@ -1148,32 +1425,50 @@ void FOnlineSessionDirect::OnValidQueryPacketReceived(uint8* PacketData, int32 P
 
 			const bool bIsMatchJoinable = /*Settings.bIsLANMatch &&*/
 				(!bIsMatchInProgress || Settings.bAllowJoinInProgress) &&
-				Settings.NumPublicConnections > 0;
+				Settings.NumPublicConnections > 0 &&
+				DoesSessionMatchSearch(*Session, SearchParams);
 
 			if (bIsMatchJoinable)
 			{
 				UE_LOG(LogB3atZOnline, Verbose, TEXT("OSID OnValidQueryPacketReceived Match is joinabale"));
 
-				FNboSerializeToBufferDirect Packet(LAN_BEACON_MAX_PACKET_SIZE);
-				// Create the basic header before appending additional information
-				B3atZSessionManager.CreateHostResponsePacket(Packet, ClientNonce);
-
-				// Add all the session details
-				AppendSessionToPacket(Packet, Session);
+				FCachedQueryResponse& Response = GetCachedQueryResponse(*Session, ClientVersion);
 
 				// Broadcast this response so the client can see us
-				if (!Packet.HasOverflow())
+				if (!Response.bHasOverflowed && Response.Fragments.Num() == 0)
 				{	
+					// Only the nonce differs between clients, and the version between legacy clients
+					B3atZSessionManager.SetHostResponsePacketNonce(Response.Packet.GetData(), ClientNonce);
+					Response.Packet[LAN_BEACON_VER_OFFSET] = ClientVersion;
+
 					if (!B3atZSessionManager.IsLANMatch)
 					{
-						B3atZSessionManager.BroadcastPacketFromSocket(Packet, Packet.GetByteCount());
+						bWasAnswered |= B3atZSessionManager.BroadcastPacketFromSocket(Response.Packet.GetData(), Response.Packet.Num());
 					}
 					else
 					{
-						B3atZSessionManager.BroadcastPacket(Packet, Packet.GetByteCount());
+						bWasAnswered |= B3atZSessionManager.BroadcastPacket(Response.Packet.GetData(), Response.Packet.Num());
 					}
 
 				}
+				else if (!Response.bHasOverflowed && ClientVersion >= LAN_BEACON_FRAGMENT_VERSION)
+				{
+					// A fresh response id keeps fragments of concurrent answers apart on the client
+					const uint64 ResponseId = B3atZSessionManager.MakeResponseId(ClientNonce);
+					for (TArray<uint8>& Fragment : Response.Fragments)
+					{
+						B3atZSessionManager.SetHostResponsePacketNonce(Fragment.GetData(), ResponseId);
+
+						if (!B3atZSessionManager.IsLANMatch)
+						{
+							bWasAnswered |= B3atZSessionManager.BroadcastPacketFromSocket(Fragment.GetData(), Fragment.Num());
+						}
+						else
+						{
+							bWasAnswered |= B3atZSessionManager.BroadcastPacket(Fragment.GetData(), Fragment.Num());
+						}
+					}
+				}
 				else
 				{
 					UE_LOG_ONLINEB3ATZ(Verbose, TEXT("LAN broadcast packet overflow, cannot broadcast on LAN"));
@@ -1181,6 +1476,79 @@ void FOnlineSessionDirect::OnValidQueryPacketReceived(uint8* PacketData, int32 P
 			}
 		}
 	}
+
+	// Queries no session matched (or whose answer couldn't be sent) don't count as answered
+	if (bWasAnswered)
+	{
+		B3atZSessionManager.NotifyQueryAnswered();
+	}
+}
+
+FOnlineSessionDirect::FSearchResultKey::FSearchResultKey(const FOnlineSession& Session) :
+	HostIp(0),
+	HostPort(0)
+{
+	const FOnlineSessionInfoDirect* SessionInfo = static_cast<const FOnlineSessionInfoDirect*>(Session.SessionInfo.Get());
+	if (SessionInfo != NULL)
+	{
+		if (SessionInfo->HostAddr.IsValid())
+		{
+			SessionInfo->HostAddr->GetIp(HostIp);
+			HostPort = SessionInfo->HostAddr->GetPort();
+		}
+		SessionId = SessionInfo->SessionId.UniqueNetIdStr;
+	}
+}
+
+FOnlineSessionDirect::FCachedQueryResponse& FOnlineSessionDirect::GetCachedQueryResponse(FNamedOnlineSession& Session, uint8 PacketVersion)
+{
+	// Everything older than the compact encoding shares the legacy format
+	const bool bIsCompact = PacketVersion >= LAN_BEACON_COMPACT_SETTINGS_VERSION;
+	TMap<FName, FCachedQueryResponse>& Responses =
+		PacketVersion >= LAN_BEACON_SESSION_LAYOUT_VERSION ? CachedQueryResponses :
+		bIsCompact ? CachedCompactQueryResponses : CachedLegacyQueryResponses;
+
+	// Encoding picks up the net driver port, StartSession and UpdateSession drop the
+	// response so a driver that started listening after CreateSession is advertised
+	FCachedQueryResponse* Response = Responses.Find(Session.SessionName);
+	if (Response == NULL)
+	{
+		UE_LOG(LogB3atZOnline, Verbose, TEXT("OSID GetCachedQueryResponse encoding session %s for version %d"), *Session.SessionName.ToString(), PacketVersion);
+
+		// Compact responses may span several beacon packets and usually fit one, legacy clients only understand one
+		uint8 PacketBuffer[LAN_BEACON_MAX_PACKET_SIZE];
+		FNboSerializeToBufferDirect Packet = bIsCompact ?
+			FNboSerializeToBufferDirect(LAN_BEACON_MAX_PACKET_SIZE, ENboWriteMode::Growable) :
+			FNboSerializeToBufferDirect(PacketBuffer, LAN_BEACON_MAX_PACKET_SIZE);
+		// Create the basic header, the nonce is filled in per query
+		B3atZSessionManager.CreateHostResponsePacket(Packet, 0, PacketVersion);
+
+		// Add all the session details
+		AppendSessionToPacket(Packet, &Session, PacketVersion);
+
+		Response = &Responses.Add(Session.SessionName);
+		Response->bHasOverflowed = Packet.HasOverflow() || Packet.GetByteCount() - LAN_BEACON_PACKET_HEADER_SIZE > FDirectSessionPacket::MaxSize;
+		if (!Response->bHasOverflowed)
+		{
+			Response->Packet.Append((uint8*)Packet, Packet.GetByteCount());
+
+			if (Response->Packet.Num() > LAN_BEACON_MAX_PACKET_SIZE)
+			{
+				Response->bHasOverflowed = !B3atZSessionManager.CreateHostResponseFragments(Response->Packet.GetData(), Response->Packet.Num(), Response->Fragments);
+				UE_LOG(LogB3atZOnline, Verbose, TEXT("OSID GetCachedQueryResponse session %s needs %d fragments"), *Session.SessionName.ToString(), Response->Fragments.Num());
+			}
+		}
+	}
+
+	return *Response;
+}
+
+void FOnlineSessionDirect::InvalidateCachedQueryResponse(FName SessionName)
+{
+	FScopeLock ScopeLock(&SessionLock);
+	CachedQueryResponses.Remove(SessionName);
+	CachedCompactQueryResponses.Remove(SessionName);
+	CachedLegacyQueryResponses.Remove(SessionName);
 }
 
 void FOnlineSessionDirect::ReadSessionFromPacket(FNboSerializeFromBufferDirect& Packet, FOnlineSession* Session)
@@ -1191,23 +1559,50 @@ void FOnlineSessionDirect::ReadSessionFromPacket(FNboSerializeFromBufferDirect&
 	UE_LOG_ONLINEB3ATZ(Verbose, TEXT("Reading session information from server"));
 #endif
 
+	// Fragments reassemble to at most this much, anything longer wasn't written by a host
+	if ((uint32)Packet.AvailableToRead() > FDirectSessionPacket::MaxSize)
+	{
+		Packet.MarkOverflowed();
+		return;
+	}
+
+	// Hosts answer in our version, which always starts with the session header
+	FOnlineSessionSettings& SessionSettings = Session->SessionSettings;
+	uint32 HostIp = 0;
+	int32 HostPort = 0;
+	uint16 Flags = 0;
+	FDirectSessionPacket::FHeader::Read(Packet,
+		HostIp,
+		HostPort,
+		Session->NumOpenPrivateConnections,
+		Session->NumOpenPublicConnections,
+		SessionSettings.NumPublicConnections,
+		SessionSettings.NumPrivateConnections,
+		Flags,
+		SessionSettings.BuildUniqueId);
+	SetCompactSessionFlags(SessionSettings, Flags);
+
 	/** Owner of the session */
-	FB3atZUniqueNetIdString* UniqueId = new FB3atZUniqueNetIdString;
-	Packet >> *UniqueId
-		>> Session->OwningUserName
-		>> Session->NumOpenPrivateConnections
-		>> Session->NumOpenPublicConnections;
+	FNboStringView OwnerId;
+	FNboStringView OwningUserName;
+	FNboStringView SessionId;
+	Packet.ReadPackedStringView(OwnerId);
+	Packet.ReadPackedStringView(OwningUserName);
+	Packet.ReadPackedStringView(SessionId);
 
-	Session->OwningUserId = MakeShareable(UniqueId);
+	Session->OwningUserId = MakeShareable(new FB3atZUniqueNetIdString(OwnerId.ToString()));
+	Session->OwningUserName = OwningUserName.ToString();
 
-	// Allocate and read the connection data
+	// Allocate the connection data
 	FOnlineSessionInfoDirect* DirectSessionInfo = new FOnlineSessionInfoDirect();
 	DirectSessionInfo->HostAddr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
-	Packet >> *DirectSessionInfo;
+	DirectSessionInfo->HostAddr->SetIp(HostIp);
+	DirectSessionInfo->HostAddr->SetPort(HostPort);
+	DirectSessionInfo->SessionId = FB3atZUniqueNetIdString(SessionId.ToString());
 	Session->SessionInfo = MakeShareable(DirectSessionInfo); 
 
 	// Read any per object data using the server object
-	ReadSettingsFromPacket(Packet, Session->SessionSettings);
+	ReadSettingsFromPacket(Packet, SessionSettings);
 }
 
 void FOnlineSessionDirect::ReadSettingsFromPacket(FNboSerializeFromBufferDirect& Packet, FOnlineSessionSettings& SessionSettings)
@@ -1221,55 +1616,52 @@ void FOnlineSessionDirect::ReadSettingsFromPacket(FNboSerializeFromBufferDirect&
 	// Clear out any old settings
 	SessionSettings.Settings.Empty();
 
-	// Members of the session settings class
-	Packet >> SessionSettings.NumPublicConnections
-		>> SessionSettings.NumPrivateConnections;
-	uint8 Read = 0;
-	// Read all the bools as bytes
-	Packet >> Read;
-	SessionSettings.bShouldAdvertise = !!Read;
-	Packet >> Read;
-	SessionSettings.bIsLANMatch = !!Read;
-	Packet >> Read;
-	SessionSettings.bIsDedicated = !!Read;
-	Packet >> Read;
-	SessionSettings.bUsesStats = !!Read;
-	Packet >> Read;
-	SessionSettings.bAllowJoinInProgress = !!Read;
-	Packet >> Read;
-	SessionSettings.bAllowInvites = !!Read;
-	Packet >> Read;
-	SessionSettings.bUsesPresence = !!Read;
-	Packet >> Read;
-	SessionSettings.bAllowJoinViaPresence = !!Read;
-	Packet >> Read;
-	SessionSettings.bAllowJoinViaPresenceFriendsOnly = !!Read;
-	Packet >> Read;
-	SessionSettings.bAntiCheatProtected = !!Read;
-
-	// BuildId
-	Packet >> SessionSettings.BuildUniqueId;
-
-	// Now read the contexts and properties from the settings class
-	int32 NumAdvertisedProperties = 0;
+	// Now read the contexts and properties from the settings class, its members came with the session header
+	uint64 NumAdvertisedProperties = 0;
 	// First, read the number of advertised properties involved, so we can presize the array
-	Packet >> NumAdvertisedProperties;
+	Packet.ReadPackedUInt(NumAdvertisedProperties);
 	if (Packet.HasOverflow() == false)
 	{
+		const TArray<FName>& SharedSettingKeys = GetSharedSettingKeys();
 		FName Key;
 		// Now read each context individually
-		for (int32 Index = 0;
+		for (uint64 Index = 0;
 			Index < NumAdvertisedProperties && Packet.HasOverflow() == false;
 			Index++)
 		{
+			uint64 KeyId = 0;
+			Packet.ReadPackedUInt(KeyId);
+			if (KeyId == 0)
+			{
+				// Names the key table from the packet bytes, without an intermediate string
+				FNboStringView KeyName;
+				Packet.ReadPackedStringView(KeyName);
+				Key = KeyName.ToName();
+			}
+			else if (KeyId <= (uint64)SharedSettingKeys.Num())
+			{
+				Key = SharedSettingKeys[(int32)KeyId - 1];
+			}
+			else
+			{
+				// A key from another dictionary, the settings can't be read and the response is dropped
+				UE_LOG_ONLINEB3ATZ(Verbose, TEXT("Unknown shared setting key %llu in ReadGameSettingsFromPacket()"), KeyId);
+				Packet.MarkOverflowed();
+				break;
+			}
+
 			FOnlineSessionSetting Setting;
-			Packet >> Key;
-			Packet >> Setting;
-			SessionSettings.Set(Key, Setting);
+			Packet.ReadCompactSetting(Setting);
 
 #if DEBUG_LAN_BEACON
-			UE_LOG_ONLINEB3ATZ(Verbose, TEXT("%s"), *Setting->ToString());
+			UE_LOG_ONLINEB3ATZ(Verbose, TEXT("%s"), *Setting.ToString());
 #endif
+
+			if (Packet.HasOverflow() == false)
+			{
+				// Hand the decoded string or blob buffer to the settings map instead of copying it
+				SessionSettings.Set(Key, MoveTemp(Setting));
+			}
 		}
 	}
 	
@@ -1281,6 +1673,262 @@ void FOnlineSessionDirect::ReadSettingsFromPacket(FNboSerializeFromBufferDirect&
 	}
 }
 
+void FOnlineSessionDirect::AppendSearchParamsToPacket(FNboSerializeToBufferDirect& Packet, const FOnlineSearchSettings& QuerySettings)
+{
+	// Count and then each key with its value and comparison
+	Packet << QuerySettings.SearchParams;
+}
+
+bool FOnlineSessionDirect::ReadSearchParamsFromPacket(FNboSerializeFromBufferDirect& Packet, FSearchParams& SearchParams)
+{
+	int32 NumSearchParams = 0;
+	Packet >> NumSearchParams;
+	if (NumSearchParams < 0)
+	{
+		return false;
+	}
+
+	for (int32 Index = 0;
+		Index < NumSearchParams && Packet.HasOverflow() == false;
+		Index++)
+	{
+		FNboStringView KeyName;
+		FOnlineSessionSearchParam SearchParam(0);
+		Packet.ReadStringView(KeyName);
+		Packet >> SearchParam;
+		if (SearchParam.ComparisonOp > EB3atZOnlineComparisonOp::NotIn)
+		{
+			return false;
+		}
+
+		// Queries come from anyone on the network, so they must not grow the name table. A key
+		// the host has never named can't be one of its settings, which lets such keys through anyway
+		const FName Key = KeyName.FindName();
+		if (Key != NAME_None)
+		{
+			SearchParams.Add(Key, MoveTemp(SearchParam));
+		}
+	}
+
+	return Packet.HasOverflow() == false;
+}
+
+/** @return true if the value is a number (or bool) and was converted to a double */
+static bool GetNumericSearchValue(const FVariantData& Data, double& OutValue)
+{
+	switch (Data.GetType())
+	{
+	case EOnlineKeyValuePairDataType::Int32:
+		{
+			int32 Value;
+			Data.GetValue(Value);
+			OutValue = Value;
+			return true;
+		}
+	case EOnlineKeyValuePairDataType::UInt32:
+		{
+			uint32 Value;
+			Data.GetValue(Value);
+			OutValue = Value;
+			return true;
+		}
+	case EOnlineKeyValuePairDataType::Int64:
+		{
+			int64 Value;
+			Data.GetValue(Value);
+			OutValue = (double)Value;
+			return true;
+		}
+	case EOnlineKeyValuePairDataType::UInt64:
+		{
+			uint64 Value;
+			Data.GetValue(Value);
+			OutValue = (double)Value;
+			return true;
+		}
+	case EOnlineKeyValuePairDataType::Float:
+		{
+			float Value;
+			Data.GetValue(Value);
+			OutValue = Value;
+			return true;
+		}
+	case EOnlineKeyValuePairDataType::Double:
+		{
+			Data.GetValue(OutValue);
+			return true;
+		}
+	case EOnlineKeyValuePairDataType::Bool:
+		{
+			bool Value;
+			Data.GetValue(Value);
+			OutValue = Value ? 1.0 : 0.0;
+			return true;
+		}
+	default:
+		return false;
+	}
+}
+
+/** @return true if the ordering of a session value against a search value satisfies the comparison */
+template<typename ValueType>
+static bool CompareSearchOrder(const ValueType& SessionValue, const ValueType& SearchValue, EB3atZOnlineComparisonOp::Type ComparisonOp)
+{
+	switch (ComparisonOp)
+	{
+	case EB3atZOnlineComparisonOp::Equals:
+		return SessionValue == SearchValue;
+	case EB3atZOnlineComparisonOp::NotEquals:
+		return !(SessionValue == SearchValue);
+	case EB3atZOnlineComparisonOp::GreaterThan:
+		return SearchValue < SessionValue;
+	case EB3atZOnlineComparisonOp::GreaterThanEquals:
+		return !(SessionValue < SearchValue);
+	case EB3atZOnlineComparisonOp::LessThan:
+		return SessionValue < SearchValue;
+	case EB3atZOnlineComparisonOp::LessThanEquals:
+		return !(SearchValue < SessionValue);
+	default:
+		return false;
+	}
+}
+
+/**
+ * Compares an advertised session setting against a single search parameter
+ *
+ * @param SessionValue the value the session advertises
+ * @param SearchParam the value and comparison the client asked for
+ *
+ * @return true if the session value satisfies the parameter
+ */
+static bool DoesSettingMatchSearchParam(const FVariantData& SessionValue, const FOnlineSessionSearchParam& SearchParam)
+{
+	switch (SearchParam.ComparisonOp)
+	{
+	case EB3atZOnlineComparisonOp::Near:
+		{
+			// Near only orders results, it never excludes any
+			return true;
+		}
+	case EB3atZOnlineComparisonOp::In:
+	case EB3atZOnlineComparisonOp::NotIn:
+		{
+			// The search value is a comma separated list of candidates
+			TArray<FString> Candidates;
+			SearchParam.Data.ToString().ParseIntoArray(Candidates, TEXT(","), true);
+			const FString SessionString = SessionValue.ToString();
+			const bool bIsIn = Candidates.ContainsByPredicate([&SessionString](const FString& Candidate)
+			{
+				return Candidate.Trim().TrimTrailing().Equals(SessionString, ESearchCase::IgnoreCase);
+			});
+			return bIsIn == (SearchParam.ComparisonOp == EB3atZOnlineComparisonOp::In);
+		}
+	default:
+		break;
+	}
+
+	double SessionNumber = 0.0;
+	double SearchNumber = 0.0;
+	if (GetNumericSearchValue(SessionValue, SessionNumber) && GetNumericSearchValue(SearchParam.Data, SearchNumber))
+	{
+		return CompareSearchOrder(SessionNumber, SearchNumber, SearchParam.ComparisonOp);
+	}
+
+	if (SessionValue.GetType() == EOnlineKeyValuePairDataType::String && SearchParam.Data.GetType() == EOnlineKeyValuePairDataType::String)
+	{
+		FString SessionString;
+		SessionValue.GetValue(SessionString);
+		FString SearchString;
+		SearchParam.Data.GetValue(SearchString);
+		return CompareSearchOrder(SessionString.Compare(SearchString, ESearchCase::IgnoreCase), 0, SearchParam.ComparisonOp);
+	}
+
+	// Blobs and mismatched types can only be told apart, not ordered
+	const bool bIsEqual = SessionValue == SearchParam.Data;
+	return SearchParam.ComparisonOp == EB3atZOnlineComparisonOp::Equals ? bIsEqual :
+		SearchParam.ComparisonOp == EB3atZOnlineComparisonOp::NotEquals ? !bIsEqual : false;
+}
+
+bool FOnlineSessionDirect::DoesSessionMatchSearch(const FNamedOnlineSession& Session, const FSearchParams& SearchParams) const
+{
+	const FOnlineSessionSettings& Settings = Session.SessionSettings;
+	const bool bIsEmpty = Session.NumOpenPublicConnections + Session.NumOpenPrivateConnections >= Settings.NumPublicConnections + Settings.NumPrivateConnections;
+
+	for (FSearchParams::TConstIterator It(SearchParams); It; ++It)
+	{
+		const FName Key = It.Key();
+		const FOnlineSessionSearchParam& SearchParam = It.Value();
+
+		bool bFlag = false;
+		if (SearchParam.Data.GetType() == EOnlineKeyValuePairDataType::Bool)
+		{
+			SearchParam.Data.GetValue(bFlag);
+		}
+
+		// Well known search keys map to members of the session rather than to settings
+		if (Key == SEARCH_DEDICATED_ONLY)
+		{
+			if (bFlag && !Settings.bIsDedicated)
+			{
+				return false;
+			}
+		}
+		else if (Key == SEARCH_SECURE_SERVERS_ONLY)
+		{
+			if (bFlag && !Settings.bAntiCheatProtected)
+			{
+				return false;
+			}
+		}
+		else if (Key == SEARCH_EMPTY_SERVERS_ONLY)
+		{
+			if (bFlag && !bIsEmpty)
+			{
+				return false;
+			}
+		}
+		else if (Key == SEARCH_NONEMPTY_SERVERS_ONLY)
+		{
+			if (bFlag && bIsEmpty)
+			{
+				return false;
+			}
+		}
+		else if (Key == SEARCH_MINSLOTSAVAILABLE)
+		{
+			double MinSlots = 0.0;
+			if (GetNumericSearchValue(SearchParam.Data, MinSlots) && Session.NumOpenPublicConnections < MinSlots)
+			{
+				return false;
+			}
+		}
+		else
+		{
+			// Only advertised settings can be searched for, anything else the host cannot judge and lets through
+			const FOnlineSessionSetting* Setting = Settings.Settings.Find(Key);
+			if (Setting == NULL || Setting->AdvertisementType < EB3atZOnlineDataAdvertisementType::ViaOnlineService)
+			{
+				continue;
+			}
+
+			// An empty string means any value, FOnlineSessionSearchB3atZ defaults the map name to it
+			if (SearchParam.ComparisonOp == EB3atZOnlineComparisonOp::Equals &&
+				SearchParam.Data.GetType() == EOnlineKeyValuePairDataType::String &&
+				SearchParam.Data.ToString().IsEmpty())
+			{
+				continue;
+			}
+
+			if (!DoesSettingMatchSearchParam(Setting->Data, SearchParam))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 void FOnlineSessionDirect::OnValidResponsePacketReceived(uint8* PacketData, int32 PacketLength)
 {
 	UE_LOG_ONLINEB3ATZ(Verbose, TEXT("OSIDirect OnValidResponsePacketReceived"));
@@ -1290,19 +1938,48 @@ void FOnlineSessionDirect::OnValidResponsePacketReceived(uint8* PacketData, int3
 	if (CurrentSessionSearch.IsValid())
 	{
 		UE_LOG_ONLINEB3ATZ(Verbose, TEXT("OSIDirect OnValidResponsePacketReceived sessions search is valid"));
-		// Add space in the search results array
-		FOnlineSessionSearchResult* NewResult = new (CurrentSessionSearch->SearchResults) FOnlineSessionSearchResult();
-		// this is not a correct ping, but better than nothing
-		NewResult->PingInMs = static_cast<int32>((FPlatformTime::Seconds() - SessionSearchStartInSeconds) * 1000);
+		if (HasReachedMaxSearchResults())
+		{
+			// Don't pay for parsing a result that would be thrown away
+			UE_LOG_ONLINEB3ATZ(Verbose, TEXT("OSIDirect OnValidResponsePacketReceived ignoring response beyond MaxSearchResults"));
+			return;
+		}
 
-		FOnlineSession* NewSession = &NewResult->Session;
+		FOnlineSessionSearchResult NewResult;
+		// Estimate until the host answers our ping
+		NewResult.PingInMs = static_cast<int32>((FPlatformTime::Seconds() - SessionSearchStartInSeconds) * 1000);
 
 		// Prepare to read data from the packet
 		FNboSerializeFromBufferDirect Packet(PacketData, PacketLength);
 		
-		ReadSessionFromPacket(Packet, NewSession);
+		ReadSessionFromPacket(Packet, &NewResult.Session);
+		if (Packet.HasOverflow())
+		{
+			// A truncated or corrupt response must not show up as a result
+			UE_LOG_ONLINEB3ATZ(Verbose, TEXT("OSIDirect OnValidResponsePacketReceived ignoring malformed response"));
+			return;
+		}
 
-		// NOTE: we don't notify until the timeout happens
+		// Hosts answer every (re)transmitted query, only keep the first response per host and session
+		FSearchResultKey ResultKey(NewResult.Session);
+		if (!SearchResultIndices.Contains(ResultKey))
+		{
+			const int32 ResultIdx = CurrentSessionSearch->SearchResults.Add(MoveTemp(NewResult));
+			SearchResultIndices.Add(MoveTemp(ResultKey), ResultIdx);
+
+			// Remember where the host's beacon answered from, so it can be pinged for a real round trip time
+			const FInternetAddr* SourceAddr = B3atZSessionManager.GetLastPacketSource();
+			SearchResultBeaconAddrs.Add(SourceAddr ? FB3atZBeacon::CopyAddr(*SourceAddr) : ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr());
+			PendingPings.Add(ResultIdx);
+			SendPendingPings();
+
+			// Let the game show the result right away, completion still fires on timeout
+			TriggerOnFindSessionsPartialResultDelegates(CurrentSessionSearch->SearchResults[ResultIdx]);
+		}
+		else
+		{
+			UE_LOG_ONLINEB3ATZ(Verbose, TEXT("OSIDirect OnValidResponsePacketReceived ignoring duplicate response"));
+		}
 	}
 	else
 	{
@@ -1319,6 +1996,9 @@ uint32 FOnlineSessionDirect::FinalizeLANSearch()
 		B3atZSessionManager.StopB3atZSession();
 	}
 
+	// The beacon that carried the pings is gone
+	ResetSearchPings();
+
 	return UpdateLANStatus();
 }
 
@@ -31,7 +31,9 @@ private:
 	/** Hidden on purpose */
 	FOnlineSessionDirect() :
 		DirectSubsystem(NULL),
-		CurrentSessionSearch(NULL)
+		CurrentSessionSearch(NULL),
+		MaxConcurrentPings(B3atZ_MAX_CONCURRENT_PINGS),
+		bPingSearchResultsPending(false)
 	{}
 
 	/**
@@ -89,23 +91,15 @@ private:
 	 */
 	uint32 FinalizeLANSearch();
 
-	/**
-	 * Adds the game session data to the packet that is sent by the host
-	 * in response to a server query
-	 *
-	 * @param Packet the writer object that will encode the data
-	 * @param Session the session to add to the packet
-	 */
-	void AppendSessionToPacket(class FNboSerializeToBufferDirect& Packet, class FOnlineSession* Session);
-
 	/**
 	 * Adds the game settings data to the packet that is sent by the host
 	 * in response to a server query
 	 *
 	 * @param Packet the writer object that will encode the data
 	 * @param SessionSettings the session settings to add to the packet
+	 * @param PacketVersion beacon version of the client the packet is for
 	 */
-	void AppendSessionSettingsToPacket(class FNboSerializeToBufferDirect& Packet, FOnlineSessionSettings* SessionSettings);
+	void AppendSessionSettingsToPacket(class FNboSerializeToBufferDirect& Packet, FOnlineSessionSettings* SessionSettings, uint8 PacketVersion);
 
 	/**
 	 * Reads the settings data from the packet and applies it to the
@@ -114,16 +108,16 @@ private:
 	 * @param Packet the reader object that will read the data
 	 * @param SessionSettings the session settings to copy the data to
 	 */
-	void ReadSessionFromPacket(class FNboSerializeFromBufferDirect& Packet, class FOnlineSession* Session);
+	void ReadSettingsFromPacket(class FNboSerializeFromBufferDirect& Packet, FOnlineSessionSettings& SessionSettings);
 
 	/**
-	 * Reads the settings data from the packet and applies it to the
-	 * specified object
+	 * Adds the search parameters to the query packet sent by the client, so
+	 * hosts can decide whether to answer at all
 	 *
-	 * @param Packet the reader object that will read the data
-	 * @param SessionSettings the session settings to copy the data to
+	 * @param Packet the writer object that will encode the data
+	 * @param QuerySettings the search parameters to add to the packet
 	 */
-	void ReadSettingsFromPacket(class FNboSerializeFromBufferDirect& Packet, FOnlineSessionSettings& SessionSettings);
+	void AppendSearchParamsToPacket(class FNboSerializeToBufferDirect& Packet, const FOnlineSearchSettings& QuerySettings);
 
 	/**
 	 * Delegate triggered when the LAN beacon has detected a valid client request has been received
@@ -131,8 +125,9 @@ private:
 	 * @param PacketData packet data sent by the requesting client with header information removed
 	 * @param PacketLength length of the packet not including header size
 	 * @param ClientNonce the nonce returned by the client to return with the server packet
+	 * @param ClientVersion the beacon version of the client, the response is encoded for it
 	 */
-	void OnValidQueryPacketReceived(uint8* PacketData, int32 PacketLength, uint64 ClientNonce);
+	void OnValidQueryPacketReceived(uint8* PacketData, int32 PacketLength, uint64 ClientNonce, uint8 ClientVersion);
 
 	/**
 	 * Delegate triggered when the LAN beacon has detected a valid host response to a client request has been received
@@ -147,6 +142,18 @@ private:
 	 */
 	void OnLANSearchTimeout();
 
+	/**
+	 * Sends queued pings while fewer than MaxConcurrentPings are in flight and
+	 * gives up on pings that were not answered within B3atZ_PING_TIMEOUT
+	 */
+	void SendPendingPings();
+
+	/** Drops all queued and in flight pings of the current search */
+	void ResetSearchPings();
+
+	/** @return true if the current search has as many results as FOnlineSessionSearchB3atZ::MaxSearchResults asks for */
+	bool HasReachedMaxSearchResults() const;
+
 	/**
 	* Delegate triggered when Default Port for Host had to be changed to be bound
 	*/
@@ -162,6 +169,52 @@ private:
 	 */
 	bool IsHost(const FNamedOnlineSession& Session) const;
 
+	/**
+	 * Encoded query response for a single advertised session. Reused for every client
+	 * query until the session changes, only the nonce in the header is patched per query
+	 */
+	struct FCachedQueryResponse
+	{
+		/** Full response packet including the beacon header */
+		TArray<uint8> Packet;
+		/** Response split into beacon sized fragments when Packet is too large to send whole */
+		TArray<TArray<uint8>> Fragments;
+		/** Whether the session data did not fit into the largest response the beacon can carry */
+		bool bHasOverflowed;
+
+		FCachedQueryResponse() :
+			bHasOverflowed(false)
+		{
+		}
+	};
+
+	/** Cached query responses by session name, guarded by SessionLock */
+	TMap<FName, FCachedQueryResponse> CachedQueryResponses;
+
+	/** Same as CachedQueryResponses, for clients from LAN_BEACON_COMPACT_SETTINGS_VERSION up to LAN_BEACON_SESSION_LAYOUT_VERSION */
+	TMap<FName, FCachedQueryResponse> CachedCompactQueryResponses;
+
+	/** Same as CachedQueryResponses, for clients older than LAN_BEACON_COMPACT_SETTINGS_VERSION */
+	TMap<FName, FCachedQueryResponse> CachedLegacyQueryResponses;
+
+	/**
+	 * Returns the cached query response for the session, encoding it first if needed
+	 * Must be called with SessionLock held
+	 *
+	 * @param Session the session to respond with
+	 * @param PacketVersion beacon version of the client being answered
+	 *
+	 * @return the cached response for this session
+	 */
+	FCachedQueryResponse& GetCachedQueryResponse(FNamedOnlineSession& Session, uint8 PacketVersion);
+
+	/**
+	 * Drops the cached query response so the next query re-encodes the session
+	 *
+	 * @param SessionName name of the session that changed
+	 */
+	void InvalidateCachedQueryResponse(FName SessionName);
+
 	
 
 PACKAGE_SCOPE:
@@ -178,12 +231,100 @@ PACKAGE_SCOPE:
 	/** Current search start time. */
 	double SessionSearchStartInSeconds;
 
+	/** Identifies a search result by the host address it advertises and its session id */
+	struct FSearchResultKey
+	{
+		uint32 HostIp;
+		int32 HostPort;
+		FString SessionId;
+
+		/** Builds the key of a session read from a host response */
+		explicit FSearchResultKey(const FOnlineSession& Session);
+
+		bool operator==(const FSearchResultKey& Other) const
+		{
+			return HostIp == Other.HostIp && HostPort == Other.HostPort && SessionId == Other.SessionId;
+		}
+
+		friend uint32 GetTypeHash(const FSearchResultKey& Key)
+		{
+			return HashCombine(HashCombine(Key.HostIp, (uint32)Key.HostPort), GetTypeHash(Key.SessionId));
+		}
+	};
+
+	/** Index of every result in the current search by its key, used to drop duplicate responses */
+	TMap<FSearchResultKey, int32> SearchResultIndices;
+
+	/** Beacon address each search result answered from, by result index */
+	TArray<TSharedRef<FInternetAddr>> SearchResultBeaconAddrs;
+
+	/** Search results waiting to be pinged */
+	TArray<int32> PendingPings;
+
+	/** Send time of each ping in flight, by search result index */
+	TMap<int32, double> OutstandingPings;
+
+	/** Maximum number of pings in flight at once */
+	int32 MaxConcurrentPings;
+
+	/** Whether PingSearchResults was called and OnPingSearchResultsComplete has not fired yet */
+	bool bPingSearchResultsPending;
+
 	FOnlineSessionDirect(class FOnlineSubsystemB3atZDirect* InSubsystem) :
 		DirectSubsystem(InSubsystem),
 		CurrentSessionSearch(NULL),
-		SessionSearchStartInSeconds(0)
+		SessionSearchStartInSeconds(0),
+		MaxConcurrentPings(B3atZ_MAX_CONCURRENT_PINGS),
+		bPingSearchResultsPending(false)
 	{}
 
+	/**
+	 * Adds the game session data to the packet that is sent by the host
+	 * in response to a server query
+	 *
+	 * @param Packet the writer object that will encode the data
+	 * @param Session the session to add to the packet
+	 * @param PacketVersion beacon version of the client the packet is for
+	 */
+	void AppendSessionToPacket(class FNboSerializeToBufferDirect& Packet, class FOnlineSession* Session, uint8 PacketVersion);
+
+	/**
+	 * Reads the game session data from a host response and applies it to the
+	 * specified object
+	 *
+	 * @param Packet the reader object that will read the data
+	 * @param Session the session to copy the data to
+	 */
+	void ReadSessionFromPacket(class FNboSerializeFromBufferDirect& Packet, class FOnlineSession* Session);
+
+	/**
+	 * Reads the search parameters a client sent along with its query
+	 *
+	 * @param Packet the reader object that will read the data
+	 * @param SearchParams the search parameters to copy the data to
+	 *
+	 * @return true if the parameters were read without error
+	 */
+	bool ReadSearchParamsFromPacket(class FNboSerializeFromBufferDirect& Packet, FSearchParams& SearchParams);
+
+	/**
+	 * Evaluates a client's search parameters against one of our sessions
+	 *
+	 * @param Session the session a response would be sent for
+	 * @param SearchParams the search parameters of the query
+	 *
+	 * @return true if the session satisfies every parameter the host can evaluate
+	 */
+	bool DoesSessionMatchSearch(const FNamedOnlineSession& Session, const FSearchParams& SearchParams) const;
+
+	/**
+	 * Delegate triggered when a host answered one of our latency probes
+	 *
+	 * @param PingId index of the search result that was pinged
+	 * @param RoundTripSeconds measured round trip time
+	 */
+	void OnPingResponseReceived(int32 PingId, double RoundTripSeconds);
+
 	/**
 	 * Session tick for various background tasks
 	 */
@@ -193,12 +334,18 @@ PACKAGE_SCOPE:
 	class FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings) override
 	{
 		FScopeLock ScopeLock(&SessionLock);
+		CachedQueryResponses.Remove(SessionName);
+		CachedCompactQueryResponses.Remove(SessionName);
+		CachedLegacyQueryResponses.Remove(SessionName);
 		return new (Sessions) FNamedOnlineSession(SessionName, SessionSettings);
 	}
 
 	class FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSession& Session) override
 	{
 		FScopeLock ScopeLock(&SessionLock);
+		CachedQueryResponses.Remove(SessionName);
+		CachedCompactQueryResponses.Remove(SessionName);
+		CachedLegacyQueryResponses.Remove(SessionName);
 		return new (Sessions) FNamedOnlineSession(SessionName, Session);
 	}
 
@@ -255,6 +402,9 @@ public:
 			if (Sessions[SearchIndex].SessionName == SessionName)
 			{
 				Sessions.RemoveAtSwap(SearchIndex);
+				CachedQueryResponses.Remove(SessionName);
+				CachedCompactQueryResponses.Remove(SessionName);
+				CachedLegacyQueryResponses.Remove(SessionName);
 				return;
 			}
 		}
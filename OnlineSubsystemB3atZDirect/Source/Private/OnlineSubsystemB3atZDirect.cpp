@@ -3,6 +3,7 @@
 
 #include "OnlineSubsystemB3atZDirect.h"
 #include "HAL/RunnableThread.h"
+#include "Misc/ConfigCacheIni.h"
 #include "OnlineAsyncTaskManagerDirect.h"
 
 #include "OnlineSessionInterfaceDirect.h"
@@ -140,7 +141,14 @@ bool FOnlineSubsystemB3atZDirect::Tick(float DeltaTime)
 
 	if (OnlineAsyncTaskThreadRunnable)
 	{
-		OnlineAsyncTaskThreadRunnable->GameTick();
+		if (OnlineAsyncTaskThreadRunnable->IsDeterministic())
+		{
+			OnlineAsyncTaskThreadRunnable->Step(DeltaTime);
+		}
+		else
+		{
+			OnlineAsyncTaskThreadRunnable->GameTick();
+		}
 	}
 
  	if (SessionInterface.IsValid())
@@ -169,9 +177,21 @@ bool FOnlineSubsystemB3atZDirect::Init()
 		// Create the online async task thread
 		OnlineAsyncTaskThreadRunnable = new FOnlineAsyncTaskManagerDirect(this);
 		check(OnlineAsyncTaskThreadRunnable);
-		OnlineAsyncTaskThread = FRunnableThread::Create(OnlineAsyncTaskThreadRunnable, *FString::Printf(TEXT("OnlineAsyncTaskThreadDirect %s"), *InstanceName.ToString()), 128 * 1024, TPri_Normal);
-		check(OnlineAsyncTaskThread);
-		UE_LOG_ONLINEB3ATZ(Verbose, TEXT("Created thread (ID:%d)."), OnlineAsyncTaskThread->GetThreadID());
+
+		bool bDeterministicAsyncTasks = false;
+		GConfig->GetBool(TEXT("OnlineSubsystemB3atZ"), TEXT("bDeterministicAsyncTasks"), bDeterministicAsyncTasks, GEngineIni);
+		if (bDeterministicAsyncTasks)
+		{
+			// Stepped from Tick on the game thread, for reproducing recorded task orderings
+			OnlineAsyncTaskThreadRunnable->SetDeterministic();
+			UE_LOG_ONLINEB3ATZ(Log, TEXT("Running async tasks deterministically on the game thread."));
+		}
+		else
+		{
+			OnlineAsyncTaskThread = FRunnableThread::Create(OnlineAsyncTaskThreadRunnable, *FString::Printf(TEXT("OnlineAsyncTaskThreadDirect %s"), *InstanceName.ToString()), 128 * 1024, TPri_Normal);
+			check(OnlineAsyncTaskThread);
+			UE_LOG_ONLINEB3ATZ(Verbose, TEXT("Created thread (ID:%d)."), OnlineAsyncTaskThread->GetThreadID());
+		}
 
  		SessionInterface = MakeShareable(new FOnlineSessionDirect(this));
 		LeaderboardsInterface = MakeShareable(new FOnlineLeaderboardsDirect(this));
@@ -243,7 +263,46 @@ bool FOnlineSubsystemB3atZDirect::Exec(UWorld* InWorld, const TCHAR* Cmd, FOutpu
 	{
 		return true;
 	}
-	return false;
+
+	bool bWasHandled = false;
+#if WITH_DEV_AUTOMATION_TESTS
+	// Tests of Direct internals, the shared ONLINE TEST commands are handled by OnlineSubsystemB3atZUtils
+	if (FParse::Command(&Cmd, TEXT("TEST")))
+	{
+		if (FParse::Command(&Cmd, TEXT("ASYNCSTEP")))
+		{
+			int32 NumTasks = FCString::Atoi(*FParse::Token(Cmd, false));
+			extern void TestAsyncTaskManagerDirectStep(FOnlineSubsystemB3atZDirect* Subsystem, int32 NumTasks);
+			TestAsyncTaskManagerDirectStep(this, NumTasks > 0 ? NumTasks : 64);
+			bWasHandled = true;
+		}
+		else if (FParse::Command(&Cmd, TEXT("LANPING")))
+		{
+			extern void TestSessionPingResponses(FOnlineSubsystemB3atZDirect* Subsystem);
+			TestSessionPingResponses(this);
+			bWasHandled = true;
+		}
+		else if (FParse::Command(&Cmd, TEXT("SEARCHFILTER")))
+		{
+			extern void TestSessionSearchFilters(FOnlineSubsystemB3atZDirect* Subsystem);
+			TestSessionSearchFilters(this);
+			bWasHandled = true;
+		}
+		else if (FParse::Command(&Cmd, TEXT("COMPACTSETTINGS")))
+		{
+			extern void TestCompactSessionSettings(FOnlineSubsystemB3atZDirect* Subsystem);
+			TestCompactSessionSettings(this);
+			bWasHandled = true;
+		}
+		else if (FParse::Command(&Cmd, TEXT("SESSIONPACKET")))
+		{
+			extern void TestSessionPacket(FOnlineSubsystemB3atZDirect* Subsystem);
+			TestSessionPacket(this);
+			bWasHandled = true;
+		}
+	}
+#endif
+	return bWasHandled;
 }
 
 bool FOnlineSubsystemB3atZDirect::IsEnabled()
@@ -0,0 +1,170 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTLS.h"
+#include "OnlineSubsystemB3atZDirect.h"
+#include "OnlineAsyncTaskManagerDirect.h"
+#include "OnlineSubsystemB3atZ.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Number of serialization lanes besides the default one the tasks are spread over */
+#define ASYNC_STEP_TEST_LANES 3
+
+/** Virtual time per step in seconds */
+#define ASYNC_STEP_TEST_STEP_SECONDS (1.0 / 60.0)
+
+/** Steps after which the test gives up waiting for the tasks */
+#define ASYNC_STEP_TEST_MAX_STEPS 1000
+
+/** Serial task taking a few passes, recording the order it finalizes in */
+class FTestAsyncStepTask : public FOnlineAsyncTaskBasic<FOnlineSubsystemB3atZDirect>
+{
+public:
+	FTestAsyncStepTask(FOnlineSubsystemB3atZDirect* InSubsystem, int32 InIndex, FName InLane, int32 InNumTicks, EOnlineAsyncPriority::Type InPriority, TArray<int32>& InFinalizeOrder)
+		: FOnlineAsyncTaskBasic(InSubsystem)
+		, Index(InIndex)
+		, Lane(InLane)
+		, NumTicks(InNumTicks)
+		, Priority(InPriority)
+		, FinalizeOrder(InFinalizeOrder)
+	{
+	}
+
+	virtual FString ToString() const override { return FString::Printf(TEXT("FTestAsyncStepTask %d"), Index); }
+	virtual FName GetSerializationLane() const override { return Lane; }
+	virtual EOnlineAsyncPriority::Type GetPriority() const override { return Priority; }
+
+	virtual void Tick() override
+	{
+		FOnlineAsyncTaskBasic::Tick();
+		if (--NumTicks <= 0)
+		{
+			bWasSuccessful = true;
+			bIsComplete = true;
+		}
+	}
+
+	virtual void Finalize() override
+	{
+		FOnlineAsyncTaskBasic::Finalize();
+		FinalizeOrder.Add(HasTimedOut() ? -1 - Index : Index);
+	}
+
+private:
+	/** Position of the task in the queue order */
+	int32 Index;
+	/** Lane the task was queued in */
+	FName Lane;
+	/** Passes left until the task is done, MAX_int32 for a task that never finishes */
+	int32 NumTicks;
+	/** Dispatch priority on the game thread */
+	EOnlineAsyncPriority::Type Priority;
+	/** Receives Index when finalized, -1 - Index when timed out */
+	TArray<int32>& FinalizeOrder;
+};
+
+/** @return the lane of a task, the default lane included */
+static FName GetAsyncStepTestLane(int32 Index)
+{
+	const int32 Lane = Index % (ASYNC_STEP_TEST_LANES + 1);
+	return Lane == 0 ? NAME_None : FName(*FString::Printf(TEXT("User%d"), Lane));
+}
+
+/**
+ * Steps a deterministic Direct task manager from the game thread the way bDeterministicAsyncTasks does.
+ * Checks the online thread checks accept the stepping thread, serial tasks of a lane finalize in queue
+ * order whatever their priority, and a task waiting behind a stuck one times out on its own deadline
+ *
+ * @param Subsystem the subsystem the manager belongs to
+ * @param NumTasks number of serial tasks to queue
+ */
+void TestAsyncTaskManagerDirectStep(FOnlineSubsystemB3atZDirect* Subsystem, int32 NumTasks)
+{
+	FOnlineAsyncTaskManagerDirect TaskManager(Subsystem);
+	TaskManager.SetDeterministic();
+
+	TArray<int32> FinalizeOrder;
+	const uint32 SteppingThreadId = FPlatformTLS::GetCurrentThreadId();
+	uint32 OnlinePassThreadId = 0;
+	TaskManager.AddGenericToInQueueOnlineThread([&OnlinePassThreadId]()
+	{
+		OnlinePassThreadId = FPlatformTLS::GetCurrentThreadId();
+	});
+
+	for (int32 Index = 0; Index < NumTasks; Index++)
+	{
+		// Later tasks of a lane often have the higher priority, they must still wait for the earlier ones
+		const EOnlineAsyncPriority::Type Priority = (Index / (ASYNC_STEP_TEST_LANES + 1)) % 2 == 0 ? EOnlineAsyncPriority::Low : EOnlineAsyncPriority::High;
+		TaskManager.AddToInQueue(new FTestAsyncStepTask(Subsystem, Index, GetAsyncStepTestLane(Index), 1 + Index % 3, Priority, FinalizeOrder));
+	}
+
+	// A stuck task with a task queued behind it that gives up first
+	const FName StuckLane(TEXT("Stuck"));
+	FTestAsyncStepTask* StuckTask = new FTestAsyncStepTask(Subsystem, NumTasks, StuckLane, MAX_int32, EOnlineAsyncPriority::Normal, FinalizeOrder);
+	StuckTask->SetTimeout(1.0);
+	TaskManager.AddToInQueue(StuckTask);
+	FTestAsyncStepTask* WaitingTask = new FTestAsyncStepTask(Subsystem, NumTasks + 1, StuckLane, 1, EOnlineAsyncPriority::Normal, FinalizeOrder);
+	WaitingTask->SetTimeout(0.25);
+	TaskManager.AddToInQueue(WaitingTask);
+
+	const int32 NumExpected = NumTasks + 2;
+	int32 NumSteps = 0;
+	while (FinalizeOrder.Num() < NumExpected && NumSteps < ASYNC_STEP_TEST_MAX_STEPS)
+	{
+		TaskManager.Step(ASYNC_STEP_TEST_STEP_SECONDS);
+		NumSteps++;
+	}
+
+	if (OnlinePassThreadId != SteppingThreadId)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncStepTest: FAILED! The online pass did not run on the stepping thread"));
+		return;
+	}
+	if (FinalizeOrder.Num() != NumExpected)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncStepTest: FAILED! %d of %d tasks finalized after %d steps"), FinalizeOrder.Num(), NumExpected, NumSteps);
+		return;
+	}
+
+	TMap<FName, int32> LastIndexByLane;
+	int32 WaitingPosition = INDEX_NONE;
+	int32 StuckPosition = INDEX_NONE;
+	for (int32 Position = 0; Position < FinalizeOrder.Num(); Position++)
+	{
+		const int32 Index = FinalizeOrder[Position];
+		if (Index == -1 - (NumTasks + 1))
+		{
+			WaitingPosition = Position;
+			continue;
+		}
+		if (Index == -1 - NumTasks)
+		{
+			StuckPosition = Position;
+			continue;
+		}
+		if (Index < 0 || Index >= NumTasks)
+		{
+			UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncStepTest: FAILED! Unexpected completion %d"), Index);
+			return;
+		}
+		int32& LastIndex = LastIndexByLane.FindOrAdd(GetAsyncStepTestLane(Index));
+		if (Index < LastIndex)
+		{
+			UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncStepTest: FAILED! Task %d finalized after task %d of the same lane"), Index, LastIndex);
+			return;
+		}
+		LastIndex = Index;
+	}
+	if (WaitingPosition == INDEX_NONE || StuckPosition == INDEX_NONE || WaitingPosition > StuckPosition)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncStepTest: FAILED! The task waiting behind a stuck one did not time out first"));
+		return;
+	}
+
+	UE_LOG(LogB3atZOnline, Display, TEXT("AsyncStepTest: %d tasks in %d steps"), NumExpected, NumSteps);
+	UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncStepTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,116 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "OnlineSubsystemB3atZDirect.h"
+#include "NboSerializerDirect.h"
+#include "OnlineSubsystemB3atZ.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Size of the blob setting, large enough for a multi byte packed length */
+#define COMPACT_SETTING_TEST_BLOB_SIZE 300
+
+/** Type tag no setting is written with */
+#define COMPACT_SETTING_TEST_UNKNOWN_TAG 0x0F
+
+/** @return true if the read setting holds what was written, empty settings don't compare equal on their own */
+static bool IsSameCompactSetting(const FOnlineSessionSetting& Written, const FOnlineSessionSetting& Read)
+{
+	if (Written.AdvertisementType != Read.AdvertisementType || Written.Data.GetType() != Read.Data.GetType())
+	{
+		return false;
+	}
+	return Written.Data.GetType() == EOnlineKeyValuePairDataType::Empty || Written.Data == Read.Data;
+}
+
+/**
+ * Round trips a setting of every type through WriteCompactSetting/ReadCompactSetting, one after
+ * the other in a single packet the way settings are advertised, and checks packets that can't be
+ * read (an unknown type tag, a blob cut short) are flagged as overflowed instead of read past
+ *
+ * @param Subsystem the subsystem running the test
+ */
+void TestCompactSessionSettings(FOnlineSubsystemB3atZDirect* Subsystem)
+{
+	TArray<uint8> Blob;
+	Blob.AddUninitialized(COMPACT_SETTING_TEST_BLOB_SIZE);
+	for (int32 Index = 0; Index < Blob.Num(); Index++)
+	{
+		Blob[Index] = (uint8)(Index * 7);
+	}
+
+	TArray<FOnlineSessionSetting> Settings;
+	Settings.Add(FOnlineSessionSetting());
+	Settings.Add(FOnlineSessionSetting((int32)-123456, EB3atZOnlineDataAdvertisementType::ViaOnlineService));
+	Settings.Add(FOnlineSessionSetting((int32)MIN_int32, EB3atZOnlineDataAdvertisementType::ViaPingOnly));
+	Settings.Add(FOnlineSessionSetting((uint32)MAX_uint32, EB3atZOnlineDataAdvertisementType::ViaPingOnly));
+	Settings.Add(FOnlineSessionSetting((int64)MIN_int64, EB3atZOnlineDataAdvertisementType::ViaOnlineServiceAndPing));
+	Settings.Add(FOnlineSessionSetting((uint64)MAX_uint64, EB3atZOnlineDataAdvertisementType::ViaOnlineService));
+	Settings.Add(FOnlineSessionSetting(3.5f, EB3atZOnlineDataAdvertisementType::ViaOnlineService));
+	Settings.Add(FOnlineSessionSetting(-0.1, EB3atZOnlineDataAdvertisementType::ViaOnlineServiceAndPing));
+	Settings.Add(FOnlineSessionSetting(FString(TEXT("Arena")), EB3atZOnlineDataAdvertisementType::ViaOnlineService));
+	Settings.Add(FOnlineSessionSetting(FString(), EB3atZOnlineDataAdvertisementType::ViaOnlineService));
+	Settings.Add(FOnlineSessionSetting(Blob, EB3atZOnlineDataAdvertisementType::ViaOnlineService));
+	Settings.Add(FOnlineSessionSetting(true, EB3atZOnlineDataAdvertisementType::ViaOnlineServiceAndPing));
+	Settings.Add(FOnlineSessionSetting(false, EB3atZOnlineDataAdvertisementType::DontAdvertise));
+
+	FNboSerializeToBufferDirect Packet(512);
+	for (const FOnlineSessionSetting& Setting : Settings)
+	{
+		Packet.WriteCompactSetting(Setting);
+	}
+	if (Packet.HasOverflow())
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("CompactSettingsTest: FAILED! Writing the settings overflowed"));
+		return;
+	}
+
+	FNboSerializeFromBufferDirect Reader(Packet.GetRawBuffer(0), Packet.GetByteCount());
+	for (int32 Index = 0; Index < Settings.Num(); Index++)
+	{
+		FOnlineSessionSetting Read;
+		Reader.ReadCompactSetting(Read);
+		if (Reader.HasOverflow() || !IsSameCompactSetting(Settings[Index], Read))
+		{
+			UE_LOG(LogB3atZOnline, Warning, TEXT("CompactSettingsTest: FAILED! %s setting %d read back as %s"),
+				EOnlineKeyValuePairDataType::ToString(Settings[Index].Data.GetType()), Index, *Read.Data.ToString());
+			return;
+		}
+	}
+	if (Reader.AvailableToRead() != 0)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("CompactSettingsTest: FAILED! %d bytes left after the last setting"), Reader.AvailableToRead());
+		return;
+	}
+
+	// Nothing says how long a value of an unknown type is, so nothing after it can be trusted
+	FNboSerializeToBufferDirect UnknownPacket(64);
+	UnknownPacket << (uint8)COMPACT_SETTING_TEST_UNKNOWN_TAG;
+	UnknownPacket.WriteCompactSetting(Settings[1]);
+	FNboSerializeFromBufferDirect UnknownReader(UnknownPacket.GetRawBuffer(0), UnknownPacket.GetByteCount());
+	FOnlineSessionSetting UnknownSetting;
+	UnknownReader.ReadCompactSetting(UnknownSetting);
+	if (!UnknownReader.HasOverflow())
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("CompactSettingsTest: FAILED! An unknown type tag was accepted"));
+		return;
+	}
+
+	// A blob claiming more bytes than the packet holds
+	FNboSerializeToBufferDirect BlobPacket(512);
+	BlobPacket.WriteCompactSetting(Settings[10]);
+	FNboSerializeFromBufferDirect BlobReader(BlobPacket.GetRawBuffer(0), BlobPacket.GetByteCount() - 1);
+	FOnlineSessionSetting BlobSetting;
+	BlobReader.ReadCompactSetting(BlobSetting);
+	if (!BlobReader.HasOverflow() || BlobSetting.Data.GetType() == EOnlineKeyValuePairDataType::Blob)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("CompactSettingsTest: FAILED! A truncated blob was read"));
+		return;
+	}
+
+	UE_LOG(LogB3atZOnline, Display, TEXT("CompactSettingsTest: %d settings in %d bytes"), Settings.Num(), Packet.GetByteCount());
+	UE_LOG(LogB3atZOnline, Warning, TEXT("CompactSettingsTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,285 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "OnlineSubsystemB3atZDirect.h"
+#include "OnlineSessionInterfaceDirect.h"
+#include "NboSerializerDirect.h"
+#include "OnlineSubsystemB3atZ.h"
+#include "SocketSubsystem.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Number of search results the ping test pretends to have found */
+#define SESSION_PING_TEST_RESULTS 3
+
+/**
+ * Feeds pongs to a LAN search the way the beacon delegate does and checks the measured
+ * round trip ends up on the right result, stray pongs are ignored and
+ * OnPingSearchResultsComplete fires once the last ping in flight is answered
+ *
+ * @param Subsystem the subsystem the session interface belongs to
+ */
+void TestSessionPingResponses(FOnlineSubsystemB3atZDirect* Subsystem)
+{
+	TSharedRef<FOnlineSessionDirect> SessionInt = MakeShareable(new FOnlineSessionDirect(Subsystem));
+
+	int32 NumCompleted = 0;
+	bool bCompletedSuccessfully = false;
+	SessionInt->AddOnPingSearchResultsCompleteDelegate_Handle(FOnPingSearchResultsCompleteDelegate::CreateLambda([&NumCompleted, &bCompletedSuccessfully](bool bWasSuccessful)
+	{
+		NumCompleted++;
+		bCompletedSuccessfully = bWasSuccessful;
+	}));
+
+	// Pongs without a search have nowhere to go
+	SessionInt->OnPingResponseReceived(0, 0.010);
+
+	SessionInt->CurrentSessionSearch = MakeShareable(new FOnlineSessionSearchB3atZ());
+	for (int32 Index = 0; Index < SESSION_PING_TEST_RESULTS; Index++)
+	{
+		SessionInt->CurrentSessionSearch->SearchResults.AddDefaulted();
+	}
+
+	// Two pings in flight, the third result can't be pinged since it has no beacon address
+	const double Now = FPlatformTime::Seconds();
+	SessionInt->OutstandingPings.Add(0, Now);
+	SessionInt->OutstandingPings.Add(1, Now);
+	SessionInt->PendingPings.Add(2);
+	SessionInt->bPingSearchResultsPending = true;
+
+	const TArray<FOnlineSessionSearchResult>& Results = SessionInt->CurrentSessionSearch->SearchResults;
+	SessionInt->OnPingResponseReceived(0, 0.0125);
+	if (Results[0].PingInMs != 12 || Results[1].PingInMs != MAX_QUERY_PING || Results[2].PingInMs != MAX_QUERY_PING)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("PingResponseTest: FAILED! The round trip was not stored on the pinged result"));
+		return;
+	}
+	if (SessionInt->OutstandingPings.Contains(0) || NumCompleted != 0)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("PingResponseTest: FAILED! Answered ping still in flight or completed too early"));
+		return;
+	}
+
+	// Ids outside the results come from stale or forged pongs
+	SessionInt->OnPingResponseReceived(SESSION_PING_TEST_RESULTS, 0.001);
+	SessionInt->OnPingResponseReceived(-1, 0.001);
+
+	SessionInt->OnPingResponseReceived(1, 0.050);
+	if (Results[1].PingInMs != 50 || NumCompleted != 1 || !bCompletedSuccessfully)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("PingResponseTest: FAILED! The last answered ping did not complete the pings (%d, %d)"), Results[1].PingInMs, NumCompleted);
+		return;
+	}
+
+	// A pong arriving after its ping was given up on still carries a valid measurement
+	SessionInt->OnPingResponseReceived(0, 0.020);
+	if (Results[0].PingInMs != 20 || NumCompleted != 1)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("PingResponseTest: FAILED! A late pong was not applied or completed the pings again"));
+		return;
+	}
+
+	UE_LOG(LogB3atZOnline, Warning, TEXT("PingResponseTest: PASSED!"));
+}
+
+/** A single search parameter and whether the test session should satisfy it */
+struct FSearchFilterTestCase
+{
+	const TCHAR* Description;
+	FName Key;
+	FOnlineSessionSearchParam SearchParam;
+	bool bShouldMatch;
+
+	FSearchFilterTestCase(const TCHAR* InDescription, FName InKey, const FOnlineSessionSearchParam& InSearchParam, bool bInShouldMatch)
+		: Description(InDescription)
+		, Key(InKey)
+		, SearchParam(InSearchParam)
+		, bShouldMatch(bInShouldMatch)
+	{
+	}
+};
+
+/**
+ * Evaluates search parameters against a hosted session the way the host filters LAN
+ * queries, and checks a query naming a key the host never heard of is read without
+ * adding that name and without excluding the session
+ *
+ * @param Subsystem the subsystem the session interface belongs to
+ */
+void TestSessionSearchFilters(FOnlineSubsystemB3atZDirect* Subsystem)
+{
+	TSharedRef<FOnlineSessionDirect> SessionInt = MakeShareable(new FOnlineSessionDirect(Subsystem));
+
+	const FName SkillKey(TEXT("SEARCHFILTERTEST_SKILL"));
+	const FName SecretKey(TEXT("SEARCHFILTERTEST_SECRET"));
+	const FName UnknownKey(TEXT("SEARCHFILTERTEST_UNKNOWN"));
+
+	FOnlineSessionSettings Settings;
+	Settings.NumPublicConnections = 4;
+	Settings.bIsDedicated = false;
+	Settings.Set(SETTING_MAPNAME, FString(TEXT("Arena")), EB3atZOnlineDataAdvertisementType::ViaOnlineService);
+	Settings.Set(SETTING_GAMEMODE, FString(TEXT("CTF")), EB3atZOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	Settings.Set(SkillKey, 1200, EB3atZOnlineDataAdvertisementType::ViaOnlineService);
+	Settings.Set(SecretKey, FString(TEXT("Hidden")), EB3atZOnlineDataAdvertisementType::DontAdvertise);
+	const FNamedOnlineSession Session(FName(TEXT("SearchFilterTest")), Settings);
+
+	TArray<FSearchFilterTestCase> Cases;
+	Cases.Emplace(TEXT("Equals"), SETTING_MAPNAME, FOnlineSessionSearchParam(FString(TEXT("Arena")), EB3atZOnlineComparisonOp::Equals), true);
+	Cases.Emplace(TEXT("Equals other value"), SETTING_MAPNAME, FOnlineSessionSearchParam(FString(TEXT("Dome")), EB3atZOnlineComparisonOp::Equals), false);
+	Cases.Emplace(TEXT("Equals any map"), SETTING_MAPNAME, FOnlineSessionSearchParam(FString(), EB3atZOnlineComparisonOp::Equals), true);
+	Cases.Emplace(TEXT("Equals number"), SkillKey, FOnlineSessionSearchParam(1000, EB3atZOnlineComparisonOp::Equals), false);
+	Cases.Emplace(TEXT("GreaterThanEquals"), SkillKey, FOnlineSessionSearchParam(1000, EB3atZOnlineComparisonOp::GreaterThanEquals), true);
+	Cases.Emplace(TEXT("In"), SETTING_GAMEMODE, FOnlineSessionSearchParam(FString(TEXT("DM, CTF")), EB3atZOnlineComparisonOp::In), true);
+	Cases.Emplace(TEXT("In other values"), SETTING_GAMEMODE, FOnlineSessionSearchParam(FString(TEXT("DM,TDM")), EB3atZOnlineComparisonOp::In), false);
+	Cases.Emplace(TEXT("NotIn"), SETTING_GAMEMODE, FOnlineSessionSearchParam(FString(TEXT("DM,TDM")), EB3atZOnlineComparisonOp::NotIn), true);
+	Cases.Emplace(TEXT("NotIn ignoring case"), SETTING_GAMEMODE, FOnlineSessionSearchParam(FString(TEXT("DM, ctf")), EB3atZOnlineComparisonOp::NotIn), false);
+	Cases.Emplace(TEXT("Unknown key"), UnknownKey, FOnlineSessionSearchParam(FString(TEXT("Anything")), EB3atZOnlineComparisonOp::Equals), true);
+	Cases.Emplace(TEXT("Not advertised"), SecretKey, FOnlineSessionSearchParam(FString(TEXT("Other")), EB3atZOnlineComparisonOp::Equals), true);
+	Cases.Emplace(TEXT("Dedicated only"), SEARCH_DEDICATED_ONLY, FOnlineSessionSearchParam(true, EB3atZOnlineComparisonOp::Equals), false);
+
+	FSearchParams AllMatching;
+	for (const FSearchFilterTestCase& Case : Cases)
+	{
+		FSearchParams SearchParams;
+		SearchParams.Add(Case.Key, Case.SearchParam);
+		if (SessionInt->DoesSessionMatchSearch(Session, SearchParams) != Case.bShouldMatch)
+		{
+			UE_LOG(LogB3atZOnline, Warning, TEXT("SearchFilterTest: FAILED! %s should %s"), Case.Description, Case.bShouldMatch ? TEXT("match") : TEXT("not match"));
+			return;
+		}
+		if (Case.bShouldMatch && !AllMatching.Contains(Case.Key))
+		{
+			AllMatching.Add(Case.Key, Case.SearchParam);
+		}
+	}
+	if (!SessionInt->DoesSessionMatchSearch(Session, AllMatching))
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("SearchFilterTest: FAILED! Matching parameters excluded the session together"));
+		return;
+	}
+
+	// A query naming a key no one on this host ever named, written the way AppendSearchParamsToPacket writes keys
+	const FString UnnamedKey = FString::Printf(TEXT("SEARCHFILTERTEST_UNNAMED_%08x"), FMath::Rand());
+	FNboSerializeToBufferDirect Packet(512);
+	Packet << (int32)2;
+	Packet << SETTING_MAPNAME;
+	Packet << FOnlineSessionSearchParam(FString(TEXT("Arena")), EB3atZOnlineComparisonOp::Equals);
+	Packet << UnnamedKey;
+	Packet << FOnlineSessionSearchParam(FString(TEXT("Anything")), EB3atZOnlineComparisonOp::Equals);
+
+	FSearchParams ReadParams;
+	FNboSerializeFromBufferDirect Reader(Packet.GetRawBuffer(0), Packet.GetByteCount());
+	if (!SessionInt->ReadSearchParamsFromPacket(Reader, ReadParams))
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("SearchFilterTest: FAILED! Could not read the query parameters"));
+		return;
+	}
+	if (ReadParams.Num() != 1 || !ReadParams.Contains(SETTING_MAPNAME) || FName(*UnnamedKey, FNAME_Find) != NAME_None)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("SearchFilterTest: FAILED! An unknown query key was added (%d parameters read)"), ReadParams.Num());
+		return;
+	}
+	if (!SessionInt->DoesSessionMatchSearch(Session, ReadParams))
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("SearchFilterTest: FAILED! A query with an unknown key excluded the session"));
+		return;
+	}
+
+	UE_LOG(LogB3atZOnline, Warning, TEXT("SearchFilterTest: PASSED!"));
+}
+
+/**
+ * Round trips a session through AppendSessionToPacket/ReadSessionFromPacket in the current beacon
+ * version, checks the fixed fields sit where FDirectSessionPacket::FHeader puts them and a
+ * response cut short inside the header or the owner id is flagged as overflowed
+ *
+ * @param Subsystem the subsystem the session interface belongs to
+ */
+void TestSessionPacket(FOnlineSubsystemB3atZDirect* Subsystem)
+{
+	TSharedRef<FOnlineSessionDirect> SessionInt = MakeShareable(new FOnlineSessionDirect(Subsystem));
+
+	FOnlineSessionSettings Settings;
+	Settings.NumPublicConnections = 12;
+	Settings.NumPrivateConnections = 2;
+	Settings.bIsDedicated = true;
+	Settings.bAllowJoinInProgress = true;
+	Settings.bAntiCheatProtected = true;
+	Settings.BuildUniqueId = (int32)0x89ABCDEF;
+	Settings.Set(SETTING_MAPNAME, FString(TEXT("Arena")), EB3atZOnlineDataAdvertisementType::ViaOnlineService);
+
+	FOnlineSession Session(Settings);
+	Session.OwningUserId = MakeShareable(new FB3atZUniqueNetIdString(TEXT("SessionPacketTestOwner")));
+	Session.OwningUserName = TEXT("Owner \u00e9");
+	Session.NumOpenPublicConnections = 9;
+	Session.NumOpenPrivateConnections = 1;
+	FOnlineSessionInfoDirect* SessionInfo = new FOnlineSessionInfoDirect();
+	SessionInfo->HostAddr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+	SessionInfo->HostAddr->SetIp(0xC0A80107);
+	SessionInfo->SessionId = FB3atZUniqueNetIdString(TEXT("SessionPacketTestId"));
+	Session.SessionInfo = MakeShareable(SessionInfo);
+
+	FNboSerializeToBufferDirect Packet(512);
+	SessionInt->AppendSessionToPacket(Packet, &Session, LAN_BEACON_PACKET_VERSION);
+	if (Packet.HasOverflow() || Packet.GetByteCount() < FDirectSessionPacket::FHeader::Size)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("SessionPacketTest: FAILED! Writing the session overflowed"));
+		return;
+	}
+
+	// The port is whatever the net driver listens on, the header has to carry it unchanged
+	const uint8* Header = Packet.GetRawBuffer(0);
+	if (FDirectSessionPacket::FHeader::Get<EDirectSessionHeaderField::HostIp>(Header) != 0xC0A80107 ||
+		FDirectSessionPacket::FHeader::Get<EDirectSessionHeaderField::HostPort>(Header) != SessionInfo->HostAddr->GetPort() ||
+		FDirectSessionPacket::FHeader::Get<EDirectSessionHeaderField::NumOpenPublicConnections>(Header) != 9 ||
+		FDirectSessionPacket::FHeader::Get<EDirectSessionHeaderField::BuildUniqueId>(Header) != Settings.BuildUniqueId)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("SessionPacketTest: FAILED! The fixed fields are not where the header layout puts them"));
+		return;
+	}
+
+	FOnlineSession ReadSession;
+	FNboSerializeFromBufferDirect Reader(Packet.GetRawBuffer(0), Packet.GetByteCount());
+	SessionInt->ReadSessionFromPacket(Reader, &ReadSession);
+	const FOnlineSessionInfoDirect* ReadInfo = static_cast<const FOnlineSessionInfoDirect*>(ReadSession.SessionInfo.Get());
+	const FOnlineSessionSettings& ReadSettings = ReadSession.SessionSettings;
+	uint32 ReadIp = 0;
+	if (ReadInfo != NULL && ReadInfo->HostAddr.IsValid())
+	{
+		ReadInfo->HostAddr->GetIp(ReadIp);
+	}
+	if (Reader.HasOverflow() || Reader.AvailableToRead() != 0 || ReadInfo == NULL ||
+		ReadIp != 0xC0A80107 || ReadInfo->HostAddr->GetPort() != SessionInfo->HostAddr->GetPort() ||
+		ReadInfo->SessionId.ToString() != TEXT("SessionPacketTestId") ||
+		!ReadSession.OwningUserId.IsValid() || ReadSession.OwningUserId->ToString() != TEXT("SessionPacketTestOwner") ||
+		ReadSession.OwningUserName != Session.OwningUserName ||
+		ReadSession.NumOpenPublicConnections != 9 || ReadSession.NumOpenPrivateConnections != 1 ||
+		ReadSettings.NumPublicConnections != 12 || ReadSettings.NumPrivateConnections != 2 ||
+		!ReadSettings.bIsDedicated || !ReadSettings.bAllowJoinInProgress || !ReadSettings.bAntiCheatProtected ||
+		ReadSettings.bUsesPresence || ReadSettings.BuildUniqueId != Settings.BuildUniqueId ||
+		ReadSettings.Settings.Num() != 1)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("SessionPacketTest: FAILED! The session did not read back as written"));
+		return;
+	}
+
+	// Cut inside the header and inside the owner id that follows it
+	const uint32 CutSizes[] = { FDirectSessionPacket::FHeader::Size - 1, FDirectSessionPacket::FHeader::Size + 4 };
+	for (uint32 CutSize : CutSizes)
+	{
+		FOnlineSession CutSession;
+		FNboSerializeFromBufferDirect CutReader(Packet.GetRawBuffer(0), CutSize);
+		SessionInt->ReadSessionFromPacket(CutReader, &CutSession);
+		if (!CutReader.HasOverflow())
+		{
+			UE_LOG(LogB3atZOnline, Warning, TEXT("SessionPacketTest: FAILED! A session cut after %u bytes was read"), CutSize);
+			return;
+		}
+	}
+
+	UE_LOG(LogB3atZOnline, Display, TEXT("SessionPacketTest: session in %d bytes, %d of them fixed"), Packet.GetByteCount(), FDirectSessionPacket::FHeader::Size);
+	UE_LOG(LogB3atZOnline, Warning, TEXT("SessionPacketTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
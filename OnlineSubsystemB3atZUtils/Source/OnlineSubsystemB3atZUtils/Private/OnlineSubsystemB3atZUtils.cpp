@@ -412,6 +412,78 @@ static bool OnlineExec( UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar )
 						TestKeyValuePairs();
 						bWasHandled = true;
 					}
+					else if (FParse::Command(&Cmd, TEXT("VARIANTDATA")))
+					{
+						int32 NumSessions = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestVariantDataAllocations(int32 NumSessions);
+						TestVariantDataAllocations(NumSessions > 0 ? NumSessions : 1000);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("BEACONFLOOD")))
+					{
+						int32 NumPackets = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestB3atZBeaconFlood(int32 NumPackets);
+						TestB3atZBeaconFlood(NumPackets > 0 ? NumPackets : 4096);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("BEACONFRAGMENTS")))
+					{
+						extern void TestB3atZBeaconFragments();
+						TestB3atZBeaconFragments();
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("NBOWRITE")))
+					{
+						int32 NumPackets = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestNboEncodeThroughput(int32 NumPackets);
+						TestNboEncodeThroughput(NumPackets > 0 ? NumPackets : 100000);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("NBOSTRING")))
+					{
+						int32 NumKeys = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestNboStringThroughput(int32 NumKeys);
+						TestNboStringThroughput(NumKeys > 0 ? NumKeys : 100000);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("NBOARRAY")))
+					{
+						int32 NumElements = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestNboArrayThroughput(int32 NumElements);
+						TestNboArrayThroughput(NumElements > 0 ? NumElements : 256);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("NBOLAYOUT")))
+					{
+						int32 NumPackets = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestNboPacketLayout(int32 NumPackets);
+						TestNboPacketLayout(NumPackets > 0 ? NumPackets : 1000000);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("ASYNCQUEUE")))
+					{
+						int32 NumItems = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestAsyncQueueContention(int32 NumItems);
+						TestAsyncQueueContention(NumItems > 0 ? NumItems : 100000);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("ASYNCFLOW")))
+					{
+						int32 NumSteps = FCString::Atoi(*FParse::Token(Cmd, false));
+						extern void TestAsyncFlowLatency(int32 NumSteps);
+						TestAsyncFlowLatency(NumSteps > 0 ? NumSteps : 4);
+						bWasHandled = true;
+					}
+					else if (FParse::Command(&Cmd, TEXT("ASYNCREPLAY")))
+					{
+						FString Filename;
+						float StepMs = 10.0f;
+						FParse::Value(Cmd, TEXT("File="), Filename);
+						FParse::Value(Cmd, TEXT("StepMs="), StepMs);
+						extern void TestAsyncReplay(const FString& Filename, float StepMs);
+						TestAsyncReplay(Filename, StepMs > 0.0f ? StepMs : 10.0f);
+						bWasHandled = true;
+					}
 					else if (FParse::Command(&Cmd, TEXT("TITLEFILE")))
 					{
 						// This class deletes itself once done
@@ -0,0 +1,199 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "OnlineAsyncFlow.h"
+#include "OnlineSubsystemB3atZ.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Number of flows run for each variant */
+#define ASYNC_FLOW_TEST_ITERATIONS 1000
+
+/** Frame time the measured frame counts are converted with */
+#define ASYNC_FLOW_TEST_FRAME_MS (1000.0 / 60.0)
+
+/** Task manager without an online service, pumped by hand from the test */
+class FTestAsyncFlowTaskManager : public FOnlineAsyncTaskManager
+{
+public:
+	virtual void OnlineTick() override {}
+};
+
+/** Result of running one variant */
+struct FAsyncFlowTestResult
+{
+	int32 TotalFrames;
+	double TotalSeconds;
+	bool bSucceeded;
+
+	FAsyncFlowTestResult()
+		: TotalFrames(0)
+		, TotalSeconds(0.0)
+		, bSucceeded(true)
+	{
+	}
+};
+
+/**
+ * Pumps the manager the way the engine does, one online pass and one game tick per frame
+ *
+ * @param bIsDone set by the flow once it finished
+ * @return the number of frames it took
+ */
+static int32 PumpUntilDone(FTestAsyncFlowTaskManager& TaskManager, const bool& bIsDone)
+{
+	int32 NumFrames = 0;
+	while (!bIsDone && NumFrames < 1000)
+	{
+		TaskManager.Tick();
+		TaskManager.GameTick();
+		NumFrames++;
+	}
+	return NumFrames;
+}
+
+/** Runs one step of the nested variant, the game thread callback of each step starts the next */
+static void RunNestedStep(FTestAsyncFlowTaskManager& TaskManager, int32 Step, int32 NumSteps, int32& Counter, bool& bIsDone)
+{
+	if (Step == NumSteps)
+	{
+		bIsDone = true;
+		return;
+	}
+
+	FTestAsyncFlowTaskManager* Manager = &TaskManager;
+	int32* CounterPtr = &Counter;
+	bool* bIsDonePtr = &bIsDone;
+	TaskManager.AddGenericToInQueueOnlineThread([Manager, Step, NumSteps, CounterPtr, bIsDonePtr]()
+	{
+		(*CounterPtr)++;
+		// The completion delegate of the request fires on the game thread
+		Manager->AddGenericToOutQueue([Manager, Step, NumSteps, CounterPtr, bIsDonePtr]()
+		{
+			RunNestedStep(*Manager, Step + 1, NumSteps, *CounterPtr, *bIsDonePtr);
+		});
+	});
+}
+
+/** Chains the steps with delegate callbacks, each step hops to the game thread and back */
+static FAsyncFlowTestResult RunNestedCallbacks(FTestAsyncFlowTaskManager& TaskManager, int32 NumSteps)
+{
+	FAsyncFlowTestResult Result;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < ASYNC_FLOW_TEST_ITERATIONS; Iteration++)
+	{
+		int32 Counter = 0;
+		bool bIsDone = false;
+		RunNestedStep(TaskManager, 0, NumSteps, Counter, bIsDone);
+		Result.TotalFrames += PumpUntilDone(TaskManager, bIsDone);
+		Result.bSucceeded = Result.bSucceeded && bIsDone && Counter == NumSteps;
+	}
+	Result.TotalSeconds = FPlatformTime::Seconds() - StartTime;
+	return Result;
+}
+
+/** Chains the steps in a single flow, resuming each on the given thread */
+static FAsyncFlowTestResult RunFlow(FTestAsyncFlowTaskManager& TaskManager, int32 NumSteps, EOnlineAsyncResume::Type ResumeOn)
+{
+	FAsyncFlowTestResult Result;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < ASYNC_FLOW_TEST_ITERATIONS; Iteration++)
+	{
+		int32 Counter = 0;
+		bool bIsDone = false;
+		bool bFlowSucceeded = false;
+		int32* CounterPtr = &Counter;
+
+		FOnlineAsyncFlow* Flow = new FOnlineAsyncFlow(TaskManager);
+		for (int32 Step = 0; Step < NumSteps; Step++)
+		{
+			Flow->Then([CounterPtr]()
+			{
+				(*CounterPtr)++;
+				return EOnlineAsyncStepResult::Succeeded;
+			}, ResumeOn);
+		}
+		bool* bIsDonePtr = &bIsDone;
+		bool* bFlowSucceededPtr = &bFlowSucceeded;
+		Flow->OnComplete([bIsDonePtr, bFlowSucceededPtr](bool bWasSuccessful)
+		{
+			*bFlowSucceededPtr = bWasSuccessful;
+			*bIsDonePtr = true;
+		});
+		Flow->Start();
+
+		Result.TotalFrames += PumpUntilDone(TaskManager, bIsDone);
+		Result.bSucceeded = Result.bSucceeded && bFlowSucceeded && Counter == NumSteps;
+	}
+	Result.TotalSeconds = FPlatformTime::Seconds() - StartTime;
+	return Result;
+}
+
+/** Checks that a cancelled flow stops between steps and reports failure */
+static bool TestAsyncFlowCancel(FTestAsyncFlowTaskManager& TaskManager)
+{
+	bool bIsDone = false;
+	bool bFlowSucceeded = true;
+	bool* bIsDonePtr = &bIsDone;
+	bool* bFlowSucceededPtr = &bFlowSucceeded;
+
+	FOnlineAsyncFlow* Flow = new FOnlineAsyncFlow(TaskManager);
+	Flow->Then([]() { return EOnlineAsyncStepResult::Pending; })
+		.OnComplete([bIsDonePtr, bFlowSucceededPtr](bool bWasSuccessful)
+		{
+			*bFlowSucceededPtr = bWasSuccessful;
+			*bIsDonePtr = true;
+		});
+	const FOnlineAsyncTaskHandle Handle = Flow->Start();
+
+	TaskManager.Tick();
+	TaskManager.GameTick();
+	const bool bWasCancelled = TaskManager.Cancel(Handle);
+	PumpUntilDone(TaskManager, bIsDone);
+
+	return bWasCancelled && bIsDone && !bFlowSucceeded;
+}
+
+/** Logs the average latency of a variant */
+static void LogAsyncFlowResult(const TCHAR* Name, const FAsyncFlowTestResult& Result)
+{
+	const double AvgFrames = (double)Result.TotalFrames / ASYNC_FLOW_TEST_ITERATIONS;
+	UE_LOG(LogB3atZOnline, Display, TEXT("AsyncFlowTest: %-24s %.2f frames (%.1f ms at 60 Hz), %.2f us of CPU per flow"),
+		Name,
+		AvgFrames,
+		AvgFrames * ASYNC_FLOW_TEST_FRAME_MS,
+		Result.TotalSeconds * 1000000.0 / ASYNC_FLOW_TEST_ITERATIONS);
+}
+
+/**
+ * Benchmark of the end to end latency of a multi step online flow, written as nested
+ * delegate callbacks and as an FOnlineAsyncFlow resuming on either thread
+ *
+ * @param NumSteps the number of requests the flow is made of
+ */
+void TestAsyncFlowLatency(int32 NumSteps)
+{
+	// Never started as a thread, so there is no work event to wake and nothing to Init
+	FTestAsyncFlowTaskManager TaskManager;
+
+	const FAsyncFlowTestResult Nested = RunNestedCallbacks(TaskManager, NumSteps);
+	const FAsyncFlowTestResult GameThreadFlow = RunFlow(TaskManager, NumSteps, EOnlineAsyncResume::GameThread);
+	const FAsyncFlowTestResult OnlineThreadFlow = RunFlow(TaskManager, NumSteps, EOnlineAsyncResume::OnlineThread);
+	const bool bCancelled = TestAsyncFlowCancel(TaskManager);
+
+	if (!Nested.bSucceeded || !GameThreadFlow.bSucceeded || !OnlineThreadFlow.bSucceeded || !bCancelled)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncFlowTest: FAILED! Steps were skipped or the cancel was ignored"));
+		return;
+	}
+
+	UE_LOG(LogB3atZOnline, Display, TEXT("AsyncFlowTest: %d steps, %d flows per variant"), NumSteps, ASYNC_FLOW_TEST_ITERATIONS);
+	LogAsyncFlowResult(TEXT("nested callbacks"), Nested);
+	LogAsyncFlowResult(TEXT("flow, game thread"), GameThreadFlow);
+	LogAsyncFlowResult(TEXT("flow, online thread"), OnlineThreadFlow);
+	UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncFlowTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
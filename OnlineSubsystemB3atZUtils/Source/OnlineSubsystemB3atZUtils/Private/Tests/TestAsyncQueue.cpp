@@ -0,0 +1,200 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+#include "OnlineAsyncTaskManager.h"
+#include "OnlineSubsystemB3atZ.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Number of threads completing items at the same time, as the online thread and platform callbacks would */
+#define ASYNC_QUEUE_TEST_PRODUCERS 4
+
+/** Minimal completed item, only carries its sequence number */
+class FTestAsyncQueueItem : public FOnlineAsyncItem
+{
+public:
+	int32 Sequence;
+
+	explicit FTestAsyncQueueItem(int32 InSequence)
+		: Sequence(InSequence)
+	{
+	}
+
+	virtual FString ToString() const override { return TEXT("FTestAsyncQueueItem"); }
+};
+
+/** The out queue as it was before, an array guarded by a critical section */
+struct FLockedAsyncQueue
+{
+	TArray<FOnlineAsyncItem*> Items;
+	FCriticalSection Lock;
+
+	void Push(FOnlineAsyncItem* Item)
+	{
+		FScopeLock ScopeLock(&Lock);
+		Items.Add(Item);
+	}
+
+	/** Pops one item per lock, the way GameTick used to drain the queue */
+	int32 Drain()
+	{
+		int32 NumDrained = 0;
+		for (;;)
+		{
+			FOnlineAsyncItem* Item = nullptr;
+			{
+				FScopeLock ScopeLock(&Lock);
+				if (Items.Num() == 0)
+				{
+					break;
+				}
+				Item = Items[0];
+				Items.RemoveAt(0);
+			}
+			delete Item;
+			NumDrained++;
+		}
+		return NumDrained;
+	}
+};
+
+/** The lock free out queue, drained with one swap per call */
+struct FLockFreeAsyncQueue
+{
+	TOnlineAsyncQueue<FOnlineAsyncItem> Items;
+
+	void Push(FOnlineAsyncItem* Item)
+	{
+		Items.Push(Item);
+	}
+
+	int32 Drain()
+	{
+		FOnlineAsyncItem* Tail = nullptr;
+		int32 NumDrained = 0;
+		FOnlineAsyncItem* Item = Items.PopAll(Tail, NumDrained);
+		while (Item != nullptr)
+		{
+			FOnlineAsyncItem* Next = TOnlineAsyncQueue<FOnlineAsyncItem>::GetNext(Item);
+			delete Item;
+			Item = Next;
+		}
+		return NumDrained;
+	}
+};
+
+/** Completes items into the queue from its own thread */
+template<class QueueType>
+class FAsyncQueueProducer : public FRunnable
+{
+	QueueType& Queue;
+	int32 NumItems;
+
+public:
+	FAsyncQueueProducer(QueueType& InQueue, int32 InNumItems)
+		: Queue(InQueue)
+		, NumItems(InNumItems)
+	{
+	}
+
+	virtual uint32 Run() override
+	{
+		for (int32 Index = 0; Index < NumItems; Index++)
+		{
+			Queue.Push(new FTestAsyncQueueItem(Index));
+		}
+		return 0;
+	}
+};
+
+/**
+ * Pushes NumItems from the producer threads while the calling thread drains the queue
+ *
+ * @return the seconds until every item was drained
+ */
+template<class QueueType>
+static double RunAsyncQueueContention(int32 NumItems)
+{
+	QueueType Queue;
+	const int32 ItemsPerProducer = NumItems / ASYNC_QUEUE_TEST_PRODUCERS;
+	const int32 TotalItems = ItemsPerProducer * ASYNC_QUEUE_TEST_PRODUCERS;
+
+	TArray<FAsyncQueueProducer<QueueType>*> Producers;
+	TArray<FRunnableThread*> Threads;
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < ASYNC_QUEUE_TEST_PRODUCERS; Index++)
+	{
+		Producers.Add(new FAsyncQueueProducer<QueueType>(Queue, ItemsPerProducer));
+		Threads.Add(FRunnableThread::Create(Producers.Last(), TEXT("AsyncQueueProducer")));
+	}
+
+	int32 NumDrained = 0;
+	while (NumDrained < TotalItems)
+	{
+		NumDrained += Queue.Drain();
+	}
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	for (int32 Index = 0; Index < Threads.Num(); Index++)
+	{
+		Threads[Index]->WaitForCompletion();
+		delete Threads[Index];
+		delete Producers[Index];
+	}
+
+	return Seconds;
+}
+
+/** Checks that a single producer's items come out of the lock free queue in push order */
+static bool TestAsyncQueueOrder()
+{
+	TOnlineAsyncQueue<FOnlineAsyncItem> Queue;
+	for (int32 Index = 0; Index < 16; Index++)
+	{
+		Queue.Push(new FTestAsyncQueueItem(Index));
+	}
+
+	FOnlineAsyncItem* Tail = nullptr;
+	int32 NumItems = 0;
+	FOnlineAsyncItem* Item = Queue.PopAll(Tail, NumItems);
+	bool bInOrder = NumItems == 16 && Queue.IsEmpty() && static_cast<FTestAsyncQueueItem*>(Tail)->Sequence == 15;
+	for (int32 Expected = 0; Item != nullptr; Expected++)
+	{
+		bInOrder = bInOrder && static_cast<FTestAsyncQueueItem*>(Item)->Sequence == Expected;
+		FOnlineAsyncItem* Next = TOnlineAsyncQueue<FOnlineAsyncItem>::GetNext(Item);
+		delete Item;
+		Item = Next;
+	}
+	return bInOrder;
+}
+
+/**
+ * Micro benchmark comparing the locked array and lock free async task queues under producer contention
+ *
+ * @param NumItems the number of completed items pushed across all producers
+ */
+void TestAsyncQueueContention(int32 NumItems)
+{
+	if (!TestAsyncQueueOrder())
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncQueueTest: FAILED! Items were reordered"));
+		return;
+	}
+
+	const double LockedSeconds = RunAsyncQueueContention<FLockedAsyncQueue>(NumItems);
+	const double LockFreeSeconds = RunAsyncQueueContention<FLockFreeAsyncQueue>(NumItems);
+
+	UE_LOG(LogB3atZOnline, Display, TEXT("AsyncQueueTest: %d items from %d producers, locked %.3f ms (%.3f us/item), lock free %.3f ms (%.3f us/item)"),
+		NumItems, ASYNC_QUEUE_TEST_PRODUCERS,
+		LockedSeconds * 1000.0, LockedSeconds * 1000000.0 / NumItems,
+		LockFreeSeconds * 1000.0, LockFreeSeconds * 1000000.0 / NumItems);
+	UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncQueueTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,129 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "Misc/Paths.h"
+#include "OnlineAsyncTaskRecorder.h"
+#include "OnlineSubsystemB3atZ.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Number of tasks in the generated workload */
+#define ASYNC_REPLAY_TEST_TASKS 2000
+
+/** Number of serialization lanes besides the default one in the generated workload */
+#define ASYNC_REPLAY_TEST_LANES 4
+
+/** Task manager without an online service, stepped by hand */
+class FTestAsyncReplayTaskManager : public FOnlineAsyncTaskManager
+{
+public:
+	FTestAsyncReplayTaskManager()
+	{
+		SetDeterministic();
+	}
+
+	virtual void OnlineTick() override {}
+};
+
+/** Builds a workload mixing lanes, parallel tasks and priorities, the same for every run */
+static void MakeAsyncReplayWorkload(double StepSeconds, TArray<FOnlineAsyncRecordedTask>& OutTasks)
+{
+	FRandomStream Random(0x0A7A);
+	double EnqueueTime = 0.0;
+	for (int32 Index = 0; Index < ASYNC_REPLAY_TEST_TASKS; Index++)
+	{
+		FOnlineAsyncRecordedTask& Task = OutTasks[OutTasks.AddDefaulted()];
+		const int32 Lane = Random.RandRange(0, ASYNC_REPLAY_TEST_LANES);
+		Task.TaskId = Index + 1;
+		Task.Name = FName(TEXT("FTestAsyncReplayTask"));
+		Task.Lane = Lane == 0 ? NAME_None : FName(*FString::Printf(TEXT("User%d"), Lane));
+		Task.bIsParallel = Random.FRand() < 0.25f;
+		Task.Priority = (EOnlineAsyncPriority::Type)Random.RandRange(0, EOnlineAsyncPriority::Count - 1);
+		Task.bWasSuccessful = Random.FRand() < 0.9f;
+		Task.EnqueueTime = EnqueueTime;
+		Task.ActivateTime = 0.0;
+		Task.CompleteTime = Random.RandRange(0, 8) * StepSeconds;
+		EnqueueTime += Random.RandRange(0, 2) * StepSeconds;
+	}
+}
+
+/** Logs the statistics of a replay */
+static void LogAsyncReplayResult(const TCHAR* Name, const FOnlineAsyncReplayResult& Result)
+{
+	UE_LOG(LogB3atZOnline, Display, TEXT("AsyncReplayTest: %s %d tasks in %d steps, %.3f s virtual, %.3f ms wall (%.0f tasks/s), %d reordered"),
+		Name,
+		Result.NumTasks,
+		Result.NumSteps,
+		Result.VirtualSeconds,
+		Result.WallSeconds * 1000.0,
+		Result.WallSeconds > 0.0 ? Result.NumTasks / Result.WallSeconds : 0.0,
+		Result.NumReordered);
+}
+
+/**
+ * Replays an async task recording twice on deterministic task managers and checks both
+ * runs finalize in the same order. Without a file a generated workload is recorded first
+ *
+ * @param Filename the recording to replay, empty to generate one
+ * @param StepMs virtual time per step
+ */
+void TestAsyncReplay(const FString& Filename, float StepMs)
+{
+	const double StepSeconds = StepMs / 1000.0;
+	FOnlineAsyncTaskRecorder& Recorder = FOnlineAsyncTaskRecorder::Get();
+
+	FString RecordingFile = Filename;
+	if (RecordingFile.IsEmpty())
+	{
+		if (Recorder.IsRecording())
+		{
+			UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncReplayTest: FAILED! A recording is already running"));
+			return;
+		}
+
+		TArray<FOnlineAsyncRecordedTask> Workload;
+		MakeAsyncReplayWorkload(StepSeconds, Workload);
+
+		RecordingFile = FPaths::ProfilingDir() / TEXT("AsyncReplayTest.oatr");
+		if (!Recorder.StartRecording(RecordingFile))
+		{
+			UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncReplayTest: FAILED! Could not write %s"), *RecordingFile);
+			return;
+		}
+		FTestAsyncReplayTaskManager TaskManager;
+		const FOnlineAsyncReplayResult Recorded = FOnlineAsyncTaskRecorder::Replay(TaskManager, Workload, StepSeconds);
+		Recorder.StopRecording();
+		LogAsyncReplayResult(TEXT("recorded"), Recorded);
+	}
+
+	TArray<FOnlineAsyncRecordedTask> Tasks;
+	if (!FOnlineAsyncTaskRecorder::LoadRecording(RecordingFile, Tasks))
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncReplayTest: FAILED! Could not read %s"), *RecordingFile);
+		return;
+	}
+
+	FOnlineAsyncReplayResult Replays[2];
+	for (int32 Run = 0; Run < ARRAY_COUNT(Replays); Run++)
+	{
+		FTestAsyncReplayTaskManager TaskManager;
+		Replays[Run] = FOnlineAsyncTaskRecorder::Replay(TaskManager, Tasks, StepSeconds);
+		LogAsyncReplayResult(Run == 0 ? TEXT("replay 1") : TEXT("replay 2"), Replays[Run]);
+	}
+
+	if (Replays[0].FinalizeOrder != Replays[1].FinalizeOrder || Replays[0].FinalizeOrder.Num() != Replays[0].NumTasks)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncReplayTest: FAILED! Replays of the same recording finalized differently"));
+		return;
+	}
+	if (Filename.IsEmpty() && Replays[0].NumReordered > 0)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncReplayTest: FAILED! Replay diverged from its own recording"));
+		return;
+	}
+	UE_LOG(LogB3atZOnline, Warning, TEXT("AsyncReplayTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,279 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+#include "IPAddress.h"
+#include "B3atZBeacon.h"
+#include "NboSerializer.h"
+#include "OnlineSubsystemB3atZ.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Port the benchmark beacon listens on (moved up if taken) */
+#define BEACON_FLOOD_TEST_PORT 15001
+
+/** Number of packets sent before the receiver drains, keeps the flood within the socket receive buffer */
+#define BEACON_FLOOD_BURST_SIZE 128
+
+/** Port the fragments of the reassembly test pretend to come from */
+#define BEACON_FRAGMENT_TEST_PORT 15002
+
+/** Nonce of the search the reassembly test answers */
+#define BEACON_FRAGMENT_TEST_NONCE 0x0123456789abcdefULL
+
+/** Builds a flood of client query packets with distinct nonces, as a discovery storm would look on the wire */
+static void BuildQueryFlood(TArray<TArray<uint8>>& OutPackets, int32 NumPackets)
+{
+	FB3atZSession PacketBuilder;
+	OutPackets.Empty(NumPackets);
+	for (int32 Index = 0; Index < NumPackets; Index++)
+	{
+		FNboSerializeToBuffer Packet(LAN_BEACON_PACKET_HEADER_SIZE);
+		PacketBuilder.CreateClientQueryPacket(Packet, (uint64)Index + 1);
+		OutPackets.Emplace(Packet.GetBuffer());
+	}
+}
+
+/**
+ * Replays the flood against the beacon on loopback and times how long the receiver takes to drain it
+ *
+ * @return the seconds spent receiving, or a negative value if not all packets arrived
+ */
+static double ReplayQueryFlood(FSocket* SendSocket, const FInternetAddr& BeaconAddr, FB3atZBeacon& Beacon, const TArray<TArray<uint8>>& Packets, bool bBatched)
+{
+	FB3atZReceiveBatch Batch;
+	Batch.Init(LAN_BEACON_RECEIVE_BATCH_SIZE);
+	uint8 PacketData[LAN_BEACON_MAX_PACKET_SIZE];
+
+	double ReceiveSeconds = 0.0;
+	int32 NumReceived = 0;
+	for (int32 BurstStart = 0; BurstStart < Packets.Num(); BurstStart += BEACON_FLOOD_BURST_SIZE)
+	{
+		const int32 BurstEnd = FMath::Min(BurstStart + BEACON_FLOOD_BURST_SIZE, Packets.Num());
+		for (int32 Index = BurstStart; Index < BurstEnd; Index++)
+		{
+			int32 BytesSent = 0;
+			SendSocket->SendTo(Packets[Index].GetData(), Packets[Index].Num(), BytesSent, BeaconAddr);
+		}
+		// Give the loopback a moment to deliver the burst
+		FPlatformProcess::Sleep(0.001f);
+
+		const double StartTime = FPlatformTime::Seconds();
+		if (bBatched)
+		{
+			int32 NumRead = 0;
+			do
+			{
+				NumRead = Beacon.ReceivePackets(Batch, LAN_BEACON_RECEIVE_BATCH_SIZE);
+				NumReceived += NumRead;
+			}
+			while (NumRead == LAN_BEACON_RECEIVE_BATCH_SIZE);
+		}
+		else
+		{
+			while (Beacon.ReceivePacket(PacketData, LAN_BEACON_MAX_PACKET_SIZE) > 0)
+			{
+				NumReceived++;
+			}
+		}
+		ReceiveSeconds += FPlatformTime::Seconds() - StartTime;
+	}
+
+	return NumReceived == Packets.Num() ? ReceiveSeconds : -1.0;
+}
+
+/**
+ * Micro benchmark comparing the single packet and batched receive paths of the LAN beacon
+ *
+ * @param NumPackets the number of query packets in the flood
+ */
+void TestB3atZBeaconFlood(int32 NumPackets)
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+	int32 BeaconPort = BEACON_FLOOD_TEST_PORT;
+	FB3atZBeacon Beacon;
+	Beacon.AddOnPortChangedDelegate_Handle(FOnPortChangedDelegate::CreateLambda([&BeaconPort](int32 NewPort)
+	{
+		BeaconPort = NewPort;
+	}));
+	if (!Beacon.InitHost(BeaconPort))
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFloodTest: FAILED! Could not bind the beacon"));
+		return;
+	}
+
+	TSharedRef<FInternetAddr> BeaconAddr = SocketSubsystem->CreateInternetAddr(0x7f000001, BeaconPort);
+	FSocket* SendSocket = SocketSubsystem->CreateSocket(NAME_DGram, TEXT("Beacon flood"), true);
+	if (SendSocket == NULL)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFloodTest: FAILED! Could not create the send socket"));
+		return;
+	}
+
+	TArray<TArray<uint8>> Packets;
+	BuildQueryFlood(Packets, NumPackets);
+
+	const double SingleSeconds = ReplayQueryFlood(SendSocket, *BeaconAddr, Beacon, Packets, false);
+	const double BatchedSeconds = ReplayQueryFlood(SendSocket, *BeaconAddr, Beacon, Packets, true);
+
+	SocketSubsystem->DestroySocket(SendSocket);
+
+	if (SingleSeconds < 0.0 || BatchedSeconds < 0.0)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFloodTest: FAILED! Packets were lost on loopback"));
+		return;
+	}
+
+	UE_LOG(LogB3atZOnline, Display, TEXT("BeaconFloodTest: %d packets, single %.3f ms (%.2f us/packet), batched %.3f ms (%.2f us/packet)"),
+		NumPackets,
+		SingleSeconds * 1000.0, SingleSeconds * 1000000.0 / NumPackets,
+		BatchedSeconds * 1000.0, BatchedSeconds * 1000000.0 / NumPackets);
+	UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFloodTest: PASSED!"));
+}
+
+/** Searching session fed fragments directly, keeping every response it reassembles */
+class FTestFragmentSession : public FB3atZSession
+{
+public:
+	FTestFragmentSession()
+	{
+		// Sized the way Search does, without binding a socket
+		ReassemblySlots.SetNum(B3atZ_REASSEMBLY_SLOTS);
+		for (FReassemblySlot& Slot : ReassemblySlots)
+		{
+			Slot.Buffer.SetNumUninitialized(LAN_BEACON_MAX_FRAGMENTS * LAN_BEACON_FRAGMENT_PAYLOAD_SIZE);
+			Slot.bInUse = false;
+		}
+		B3atZNonce = BEACON_FRAGMENT_TEST_NONCE;
+	}
+
+	/**
+	 * Handles a fragment packet the way ProcessPacket does
+	 *
+	 * @return false if the packet was rejected as a fragment of our search
+	 */
+	bool ReceiveFragment(const FInternetAddr& Source, const TArray<uint8>& Fragment)
+	{
+		uint64 ResponseId;
+		uint8 FragmentIndex, FragmentCount;
+		if (!IsValidLanFragmentPacket(Fragment.GetData(), Fragment.Num(), ResponseId, FragmentIndex, FragmentCount))
+		{
+			return false;
+		}
+		const int32 HeaderSize = LAN_BEACON_PACKET_HEADER_SIZE + LAN_BEACON_FRAGMENT_HEADER_SIZE;
+		ReassembleFragment(Source, ResponseId, FragmentIndex, FragmentCount, &Fragment[HeaderSize], Fragment.Num() - HeaderSize);
+		return true;
+	}
+
+	virtual void TriggerOnValidResponsePacketDelegates(uint8* PacketData, int32 PacketLength) override
+	{
+		Responses.Emplace(PacketData, PacketLength);
+	}
+
+	/** Payloads of the completed responses in completion order */
+	TArray<TArray<uint8>> Responses;
+};
+
+/** Splits the response into fragments answering the given query */
+static bool BuildResponseFragments(FB3atZSession& Host, const TArray<uint8>& Response, uint64 ClientNonce, TArray<TArray<uint8>>& OutFragments)
+{
+	if (!Host.CreateHostResponseFragments(Response.GetData(), Response.Num(), OutFragments))
+	{
+		return false;
+	}
+	const uint64 ResponseId = Host.MakeResponseId(ClientNonce);
+	for (TArray<uint8>& Fragment : OutFragments)
+	{
+		Host.SetHostResponsePacketNonce(Fragment.GetData(), ResponseId);
+	}
+	return true;
+}
+
+/**
+ * Splits a host response too large for one packet and feeds the fragments to a searching
+ * session in order, out of order, with duplicates and with one missing, checking each
+ * complete response is passed on exactly once and incomplete or foreign ones never are
+ */
+void TestB3atZBeaconFragments()
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> HostAddr = SocketSubsystem->CreateInternetAddr(0x7f000001, BEACON_FRAGMENT_TEST_PORT);
+
+	// Three fragments, the last one partly filled
+	const int32 PayloadLength = 2 * LAN_BEACON_FRAGMENT_PAYLOAD_SIZE + 100;
+	FB3atZSession Host;
+	FNboSerializeToBuffer ResponsePacket(LAN_BEACON_PACKET_HEADER_SIZE + PayloadLength);
+	Host.CreateHostResponsePacket(ResponsePacket, 0);
+	for (int32 Index = 0; Index < PayloadLength; Index++)
+	{
+		ResponsePacket << (uint8)(Index * 13);
+	}
+	const TArray<uint8> Response = ResponsePacket.GetBuffer();
+	const TArray<uint8> Payload(&Response[LAN_BEACON_PACKET_HEADER_SIZE], PayloadLength);
+
+	FTestFragmentSession Client;
+	TArray<TArray<uint8>> Fragments;
+	if (!BuildResponseFragments(Host, Response, Client.B3atZNonce, Fragments) || Fragments.Num() != 3)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFragmentsTest: FAILED! The response was split into %d fragments"), Fragments.Num());
+		return;
+	}
+
+	// In order
+	for (const TArray<uint8>& Fragment : Fragments)
+	{
+		Client.ReceiveFragment(*HostAddr, Fragment);
+	}
+	if (Client.Responses.Num() != 1 || Client.Responses[0] != Payload)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFragmentsTest: FAILED! Fragments in order were not reassembled"));
+		return;
+	}
+
+	// Out of order with duplicates, the response must still be passed on once
+	BuildResponseFragments(Host, Response, Client.B3atZNonce, Fragments);
+	Client.ReceiveFragment(*HostAddr, Fragments[2]);
+	Client.ReceiveFragment(*HostAddr, Fragments[0]);
+	Client.ReceiveFragment(*HostAddr, Fragments[2]);
+	Client.ReceiveFragment(*HostAddr, Fragments[0]);
+	Client.ReceiveFragment(*HostAddr, Fragments[1]);
+	if (Client.Responses.Num() != 2 || Client.Responses[1] != Payload)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFragmentsTest: FAILED! Fragments out of order gave %d responses"), Client.Responses.Num() - 1);
+		return;
+	}
+
+	// A late duplicate of a finished response starts over instead of completing it again
+	Client.ReceiveFragment(*HostAddr, Fragments[1]);
+	if (Client.Responses.Num() != 2)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFragmentsTest: FAILED! A late duplicate completed the response again"));
+		return;
+	}
+
+	// A lost fragment leaves the response incomplete
+	BuildResponseFragments(Host, Response, Client.B3atZNonce, Fragments);
+	Client.ReceiveFragment(*HostAddr, Fragments[0]);
+	Client.ReceiveFragment(*HostAddr, Fragments[2]);
+	if (Client.Responses.Num() != 2)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFragmentsTest: FAILED! A response missing a fragment was passed on"));
+		return;
+	}
+
+	// Fragments answering someone else's search
+	BuildResponseFragments(Host, Response, ~Client.B3atZNonce, Fragments);
+	if (Client.ReceiveFragment(*HostAddr, Fragments[0]))
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFragmentsTest: FAILED! A fragment of another search was accepted"));
+		return;
+	}
+
+	UE_LOG(LogB3atZOnline, Warning, TEXT("BeaconFragmentsTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
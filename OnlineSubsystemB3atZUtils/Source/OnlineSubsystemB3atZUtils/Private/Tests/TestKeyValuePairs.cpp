@@ -2,6 +2,9 @@
 // Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
 
 #include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeCounter.h"
 #include "OnlineKeyValuePair.h"
 #include "OnlineSubsystemB3atZ.h"
 
@@ -213,4 +216,369 @@ void TestKeyValuePairs()
 	UE_LOG(LogB3atZOnline, Warning, TEXT("KeyValuePairTest: %s!"), bSuccess ? TEXT("PASSED") : TEXT("FAILED"));
 }
 
+/**
+ * FVariantData as it was before, strings and blobs always on the heap and deep copied
+ * even when the source is a temporary
+ */
+class FLegacyVariantData
+{
+	EOnlineKeyValuePairDataType::Type Type;
+	union
+	{
+		int32 AsInt;
+		TCHAR* AsTCHAR;
+		struct
+		{
+			uint8* BlobData;
+			uint32 BlobSize;
+		} AsBlob;
+	} Value;
+
+	void Assign(const FLegacyVariantData& Other)
+	{
+		Type = Other.Type;
+		if (Type == EOnlineKeyValuePairDataType::String)
+		{
+			const int32 StrLen = FCString::Strlen(Other.Value.AsTCHAR);
+			Value.AsTCHAR = new TCHAR[StrLen + 1];
+			FCString::Strcpy(Value.AsTCHAR, StrLen + 1, Other.Value.AsTCHAR);
+		}
+		else if (Type == EOnlineKeyValuePairDataType::Blob)
+		{
+			Value.AsBlob.BlobSize = Other.Value.AsBlob.BlobSize;
+			Value.AsBlob.BlobData = new uint8[Value.AsBlob.BlobSize];
+			FMemory::Memcpy(Value.AsBlob.BlobData, Other.Value.AsBlob.BlobData, Value.AsBlob.BlobSize);
+		}
+		else
+		{
+			Value.AsInt = Other.Value.AsInt;
+		}
+	}
+
+	void Free()
+	{
+		if (Type == EOnlineKeyValuePairDataType::String)
+		{
+			delete [] Value.AsTCHAR;
+		}
+		else if (Type == EOnlineKeyValuePairDataType::Blob)
+		{
+			delete [] Value.AsBlob.BlobData;
+		}
+		Type = EOnlineKeyValuePairDataType::Empty;
+	}
+
+public:
+	FLegacyVariantData(int32 InData)
+		: Type(EOnlineKeyValuePairDataType::Int32)
+	{
+		Value.AsInt = InData;
+	}
+
+	FLegacyVariantData(const TCHAR* InData)
+		: Type(EOnlineKeyValuePairDataType::String)
+	{
+		const int32 StrLen = FCString::Strlen(InData);
+		Value.AsTCHAR = new TCHAR[StrLen + 1];
+		FCString::Strcpy(Value.AsTCHAR, StrLen + 1, InData);
+	}
+
+	FLegacyVariantData(const TArray<uint8>& InData)
+		: Type(EOnlineKeyValuePairDataType::Blob)
+	{
+		Value.AsBlob.BlobSize = InData.Num();
+		Value.AsBlob.BlobData = new uint8[Value.AsBlob.BlobSize];
+		FMemory::Memcpy(Value.AsBlob.BlobData, InData.GetData(), Value.AsBlob.BlobSize);
+	}
+
+	FLegacyVariantData(const FLegacyVariantData& Other)
+	{
+		Assign(Other);
+	}
+
+	FLegacyVariantData& operator=(const FLegacyVariantData& Other)
+	{
+		if (this != &Other)
+		{
+			Free();
+			Assign(Other);
+		}
+		return *this;
+	}
+
+	~FLegacyVariantData()
+	{
+		Free();
+	}
+};
+
+/** Counts the allocations made through GMalloc while it is installed in its place */
+class FCountingMalloc : public FMalloc
+{
+public:
+	FMalloc* InnerMalloc;
+	FThreadSafeCounter NumAllocations;
+
+	FCountingMalloc()
+		: InnerMalloc(nullptr)
+	{
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		NumAllocations.Increment();
+		return InnerMalloc->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Count > 0)
+		{
+			NumAllocations.Increment();
+		}
+		return InnerMalloc->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override
+	{
+		InnerMalloc->Free(Original);
+	}
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+	{
+		return InnerMalloc->QuantizeSize(Count, Alignment);
+	}
+
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return InnerMalloc->GetAllocationSize(Original, SizeOut);
+	}
+
+	virtual void Trim() override
+	{
+		InnerMalloc->Trim();
+	}
+
+	virtual void SetupTLSCachesOnCurrentThread() override
+	{
+		InnerMalloc->SetupTLSCachesOnCurrentThread();
+	}
+
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+	{
+		InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread();
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return InnerMalloc->IsInternallyThreadSafe();
+	}
+
+	virtual bool ValidateHeap() override
+	{
+		return InnerMalloc->ValidateHeap();
+	}
+
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return InnerMalloc->GetDescriptiveName();
+	}
+};
+
+/**
+ * Runs a workload with every GMalloc allocation counted. Other threads allocating
+ * meanwhile are counted too, so run it on an otherwise idle instance
+ *
+ * @param Workload the code to measure
+ * @param OutSeconds receives how long the workload took
+ * @return the number of allocations made
+ */
+template<typename WorkloadFunc>
+static int32 CountAllocations(const WorkloadFunc& Workload, double& OutSeconds)
+{
+	// Never destroyed, another thread may still be returning through it after it is removed
+	static FCountingMalloc CountingMalloc;
+	CountingMalloc.InnerMalloc = GMalloc;
+	CountingMalloc.NumAllocations.Reset();
+	GMalloc = &CountingMalloc;
+
+	const double StartTime = FPlatformTime::Seconds();
+	Workload();
+	OutSeconds = FPlatformTime::Seconds() - StartTime;
+
+	GMalloc = CountingMalloc.InnerMalloc;
+	return CountingMalloc.NumAllocations.GetValue();
+}
+
+/** A session setting value as advertised by a typical host: numbers, short tags, a small id blob and the server name */
+template<typename VariantType>
+static VariantType MakeSessionSettingValue(int32 Index, const TArray<uint8>& SessionIdBlob)
+{
+	switch (Index % 6)
+	{
+	case 0:
+		return VariantType(Index);
+	case 1:
+		return VariantType(TEXT("TDM"));
+	case 2:
+		return VariantType(TEXT("EU"));
+	case 3:
+		return VariantType(SessionIdBlob);
+	case 4:
+		return VariantType(TEXT("Lighthouse"));
+	default:
+		return VariantType(TEXT("Official Server #12 - Team Deathmatch 24/7"));
+	}
+}
+
+/**
+ * Decodes the settings of every search result into its own map, the way ReadSettingsFromPacket
+ * hands each setting over, then copies the results as the search object does for the game
+ */
+template<typename VariantType>
+static void RunSessionSettingsWorkload(int32 NumSessions, const TArray<FName>& Keys, const TArray<uint8>& SessionIdBlob)
+{
+	TArray<TMap<FName, VariantType>> Results;
+	Results.Reserve(NumSessions);
+	for (int32 SessionIdx = 0; SessionIdx < NumSessions; SessionIdx++)
+	{
+		TMap<FName, VariantType>& Settings = Results[Results.AddDefaulted()];
+		Settings.Reserve(Keys.Num());
+		for (int32 KeyIdx = 0; KeyIdx < Keys.Num(); KeyIdx++)
+		{
+			VariantType Decoded = MakeSessionSettingValue<VariantType>(KeyIdx, SessionIdBlob);
+			Settings.Add(Keys[KeyIdx], MoveTemp(Decoded));
+		}
+	}
+	TArray<TMap<FName, VariantType>> Copies = Results;
+}
+
+/**
+ * Fills leaderboard rows with the written stats, moving each temporary into its column, then
+ * copies the rows out as a leaderboard read does
+ */
+template<typename VariantType>
+static void RunLeaderboardWorkload(int32 NumRows, const TArray<FName>& StatNames, const TArray<uint8>& StatBlob)
+{
+	TArray<TMap<FName, VariantType>> Rows;
+	Rows.Reserve(NumRows);
+	for (int32 RowIdx = 0; RowIdx < NumRows; RowIdx++)
+	{
+		TMap<FName, VariantType>& Columns = Rows[Rows.AddDefaulted()];
+		Columns.Reserve(StatNames.Num());
+		for (int32 StatIdx = 0; StatIdx < StatNames.Num(); StatIdx++)
+		{
+			// Mostly numbers, plus a platform tag, a clan tag and a stat checksum
+			VariantType Stat = StatIdx == 0 ? VariantType(TEXT("PC")) :
+				StatIdx == 1 ? VariantType(TEXT("B3Z")) :
+				StatIdx == 2 ? VariantType(StatBlob) :
+				VariantType(RowIdx * StatIdx);
+			Columns.Add(StatNames[StatIdx], MoveTemp(Stat));
+		}
+	}
+	TArray<TMap<FName, VariantType>> ReadRows = Rows;
+}
+
+/** Checks inline and heap strings and blobs survive copies and moves */
+static bool TestVariantDataStorage()
+{
+	bool bSuccess = true;
+
+	// Largest string that fits inline and the smallest one that doesn't, same for blobs
+	const int32 MaxInlineChars = VARIANT_DATA_INLINE_SIZE / sizeof(TCHAR) - 1;
+	const FString InlineString = FString::ChrN(MaxInlineChars, TEXT('i'));
+	const FString HeapString = FString::ChrN(MaxInlineChars + 1, TEXT('h'));
+	TArray<uint8> InlineBlob;
+	TArray<uint8> HeapBlob;
+	for (int32 Index = 0; Index <= VARIANT_DATA_INLINE_SIZE; Index++)
+	{
+		if (Index < VARIANT_DATA_INLINE_SIZE)
+		{
+			InlineBlob.Add((uint8)Index);
+		}
+		HeapBlob.Add((uint8)(255 - Index));
+	}
+
+	TArray<FVariantData> Values;
+	Values.Add(FVariantData(InlineString));
+	Values.Add(FVariantData(HeapString));
+	Values.Add(FVariantData(FString()));
+	Values.Add(FVariantData(InlineBlob));
+	Values.Add(FVariantData(HeapBlob));
+
+	for (const FVariantData& Original : Values)
+	{
+		FVariantData Copy(Original);
+		FVariantData Assigned(5);
+		Assigned = Copy;
+		FVariantData Moved(MoveTemp(Copy));
+		FVariantData MoveAssigned(TEXT("overwritten by the move"));
+		MoveAssigned = MoveTemp(Assigned);
+
+		bSuccess = bSuccess && Copy.GetType() == EOnlineKeyValuePairDataType::Empty && Assigned.GetType() == EOnlineKeyValuePairDataType::Empty;
+		bSuccess = bSuccess && Moved == Original && MoveAssigned == Original;
+	}
+
+	FString OutString;
+	Values[0].GetValue(OutString);
+	bSuccess = bSuccess && OutString == InlineString;
+	Values[1].GetValue(OutString);
+	bSuccess = bSuccess && OutString == HeapString;
+
+	TArray<uint8> OutBlob;
+	Values[3].GetValue(OutBlob);
+	bSuccess = bSuccess && OutBlob == InlineBlob;
+	Values[4].GetValue(OutBlob);
+	bSuccess = bSuccess && OutBlob == HeapBlob;
+
+	// Changing type from an inline payload must not free it
+	Values[0].SetValue(HeapBlob);
+	Values[3].SetValue(HeapString);
+	Values[0].GetValue(OutBlob);
+	Values[3].GetValue(OutString);
+	bSuccess = bSuccess && OutBlob == HeapBlob && OutString == HeapString;
+
+	return bSuccess;
+}
+
+/**
+ * Counts the allocations of session settings and leaderboard workloads with FVariantData
+ * against the previous always-allocate, copy-only storage
+ *
+ * @param NumSessions the number of search results and leaderboard rows to build
+ */
+void TestVariantDataAllocations(int32 NumSessions)
+{
+	if (!TestVariantDataStorage())
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("VariantDataTest: FAILED! Values didn't survive a copy or move"));
+		return;
+	}
+
+	TArray<FName> Keys;
+	for (int32 KeyIdx = 0; KeyIdx < 18; KeyIdx++)
+	{
+		Keys.Add(FName(*FString::Printf(TEXT("SETTING_%d"), KeyIdx)));
+	}
+	TArray<uint8> SmallBlob;
+	SmallBlob.AddZeroed(16);
+
+	double LegacySeconds = 0.0;
+	double Seconds = 0.0;
+	const int32 LegacySessionAllocs = CountAllocations([&]() { RunSessionSettingsWorkload<FLegacyVariantData>(NumSessions, Keys, SmallBlob); }, LegacySeconds);
+	const int32 SessionAllocs = CountAllocations([&]() { RunSessionSettingsWorkload<FVariantData>(NumSessions, Keys, SmallBlob); }, Seconds);
+	UE_LOG(LogB3atZOnline, Display, TEXT("VariantDataTest: session settings, %d results of %d settings"), NumSessions, Keys.Num());
+	UE_LOG(LogB3atZOnline, Display, TEXT("VariantDataTest:   before %8d allocations %.3f ms"), LegacySessionAllocs, LegacySeconds * 1000.0);
+	UE_LOG(LogB3atZOnline, Display, TEXT("VariantDataTest:   now    %8d allocations %.3f ms"), SessionAllocs, Seconds * 1000.0);
+
+	const TArray<FName> StatNames(Keys.GetData(), 8);
+	const int32 LegacyLeaderboardAllocs = CountAllocations([&]() { RunLeaderboardWorkload<FLegacyVariantData>(NumSessions, StatNames, SmallBlob); }, LegacySeconds);
+	const int32 LeaderboardAllocs = CountAllocations([&]() { RunLeaderboardWorkload<FVariantData>(NumSessions, StatNames, SmallBlob); }, Seconds);
+	UE_LOG(LogB3atZOnline, Display, TEXT("VariantDataTest: leaderboard, %d rows of %d stats"), NumSessions, StatNames.Num());
+	UE_LOG(LogB3atZOnline, Display, TEXT("VariantDataTest:   before %8d allocations %.3f ms"), LegacyLeaderboardAllocs, LegacySeconds * 1000.0);
+	UE_LOG(LogB3atZOnline, Display, TEXT("VariantDataTest:   now    %8d allocations %.3f ms"), LeaderboardAllocs, Seconds * 1000.0);
+
+	UE_LOG(LogB3atZOnline, Warning, TEXT("VariantDataTest: PASSED!"));
+}
+
 #endif //WITH_DEV_AUTOMATION_TESTS
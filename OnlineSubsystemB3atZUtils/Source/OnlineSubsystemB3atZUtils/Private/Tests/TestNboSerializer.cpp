@@ -0,0 +1,588 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved
+// Plugin written by Philipp Buerki. Copyright 2017. All Rights reserved..
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "B3atZBeacon.h"
+#include "NboSerializer.h"
+#include "OnlineSubsystemB3atZ.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Number of settings in the benchmark response, a typical advertised session */
+#define NBO_TEST_NUM_SETTINGS 16
+
+/**
+ * The writer as it was before, a zero filled array written through bounds checked operator[]
+ */
+class FLegacyNboWriter
+{
+	TArray<uint8> Data;
+	uint32 NumBytes;
+	bool bHasOverflowed;
+
+public:
+	explicit FLegacyNboWriter(uint32 Size)
+		: NumBytes(0)
+		, bHasOverflowed(false)
+	{
+		Data.Empty(Size);
+		Data.AddZeroed(Size);
+	}
+
+	uint32 GetByteCount() const { return NumBytes; }
+	bool HasOverflow() const { return bHasOverflowed; }
+	const uint8* GetData() const { return Data.GetData(); }
+
+	friend FLegacyNboWriter& operator<<(FLegacyNboWriter& Ar, const uint8& B)
+	{
+		if (!Ar.bHasOverflowed && Ar.NumBytes + 1 <= (uint32)Ar.Data.Num())
+		{
+			Ar.Data[Ar.NumBytes++] = B;
+		}
+		else
+		{
+			Ar.bHasOverflowed = true;
+		}
+		return Ar;
+	}
+
+	friend FLegacyNboWriter& operator<<(FLegacyNboWriter& Ar, const uint32& D)
+	{
+		if (!Ar.bHasOverflowed && Ar.NumBytes + 4 <= (uint32)Ar.Data.Num())
+		{
+			Ar.Data[Ar.NumBytes + 0] = (D >> 24) & 0xFF;
+			Ar.Data[Ar.NumBytes + 1] = (D >> 16) & 0xFF;
+			Ar.Data[Ar.NumBytes + 2] = (D >> 8) & 0xFF;
+			Ar.Data[Ar.NumBytes + 3] = D & 0xFF;
+			Ar.NumBytes += 4;
+		}
+		else
+		{
+			Ar.bHasOverflowed = true;
+		}
+		return Ar;
+	}
+
+	friend FLegacyNboWriter& operator<<(FLegacyNboWriter& Ar, const uint64& Q)
+	{
+		if (!Ar.bHasOverflowed && Ar.NumBytes + 8 <= (uint32)Ar.Data.Num())
+		{
+			for (int32 Index = 0; Index < 8; Index++)
+			{
+				Ar.Data[Ar.NumBytes + Index] = (Q >> (56 - Index * 8)) & 0xFF;
+			}
+			Ar.NumBytes += 8;
+		}
+		else
+		{
+			Ar.bHasOverflowed = true;
+		}
+		return Ar;
+	}
+
+	friend FLegacyNboWriter& operator<<(FLegacyNboWriter& Ar, const FString& String)
+	{
+		FTCHARToUTF8 Converted(*String);
+		const uint32 Len = Converted.Length();
+		Ar << Len;
+		if (!Ar.bHasOverflowed && Ar.NumBytes + Len <= (uint32)Ar.Data.Num())
+		{
+			if (Len > 0)
+			{
+				FMemory::Memcpy(&Ar.Data[Ar.NumBytes], Converted.Get(), Len);
+				Ar.NumBytes += Len;
+			}
+		}
+		else
+		{
+			Ar.bHasOverflowed = true;
+		}
+		return Ar;
+	}
+};
+
+/** Writes a host response the shape of a LAN beacon answer: header, owner and a list of settings */
+template<class WriterType>
+static void EncodeBeaconResponse(WriterType& Packet, const TArray<FString>& SettingNames, uint64 Nonce)
+{
+	Packet << (uint8)LAN_BEACON_PACKET_VERSION << (uint8)1 << (uint32)0x1234ABCD
+		<< (uint8)LAN_SERVER_RESPONSE1 << (uint8)LAN_SERVER_RESPONSE2 << Nonce;
+	Packet << FString(TEXT("0123456789ABCDEF0123456789ABCDEF")) << FString(TEXT("HostPlayerName"))
+		<< (uint32)8 << (uint32)16 << (uint64)0x0A000001 << (uint32)7777;
+	Packet << (uint32)SettingNames.Num();
+	for (int32 Index = 0; Index < SettingNames.Num(); Index++)
+	{
+		Packet << SettingNames[Index] << (uint8)EOnlineKeyValuePairDataType::Int32 << (uint32)Index << (uint8)1;
+	}
+}
+
+/** @return the seconds it took to encode NumPackets responses with a freshly constructed writer each */
+template<class EncodeFunc>
+static double TimeEncode(int32 NumPackets, uint32& OutChecksum, const EncodeFunc& Encode)
+{
+	OutChecksum = 0;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumPackets; Index++)
+	{
+		OutChecksum += Encode((uint64)Index);
+	}
+	return FPlatformTime::Seconds() - StartTime;
+}
+
+/** Checks the owned, external and growable writers produce the same bytes, and that growing works past the initial size */
+static bool TestNboWriterModes(const TArray<FString>& SettingNames)
+{
+	FLegacyNboWriter Legacy(LAN_BEACON_MAX_PACKET_SIZE);
+	EncodeBeaconResponse(Legacy, SettingNames, 42);
+
+	FNboSerializeToBuffer Owned(LAN_BEACON_MAX_PACKET_SIZE);
+	EncodeBeaconResponse(Owned, SettingNames, 42);
+
+	uint8 StackBuffer[LAN_BEACON_MAX_PACKET_SIZE];
+	FNboSerializeToBuffer External(StackBuffer, LAN_BEACON_MAX_PACKET_SIZE);
+	EncodeBeaconResponse(External, SettingNames, 42);
+
+	FNboSerializeToBuffer Growable(16, ENboWriteMode::Growable);
+	EncodeBeaconResponse(Growable, SettingNames, 42);
+
+	FNboSerializeToBuffer TooSmall(StackBuffer, 16);
+	EncodeBeaconResponse(TooSmall, SettingNames, 42);
+
+	const uint32 NumBytes = Legacy.GetByteCount();
+	return !Legacy.HasOverflow()
+		&& Owned.GetByteCount() == NumBytes && FMemory::Memcmp((uint8*)Owned, Legacy.GetData(), NumBytes) == 0
+		&& External.GetByteCount() == NumBytes && FMemory::Memcmp(StackBuffer, Legacy.GetData(), NumBytes) == 0
+		&& !Growable.HasOverflow() && Growable.GetByteCount() == NumBytes && FMemory::Memcmp((uint8*)Growable, Legacy.GetData(), NumBytes) == 0
+		&& TooSmall.HasOverflow();
+}
+
+/**
+ * Micro benchmark of LAN beacon response encoding with the old zero filled writer against
+ * the owned, caller supplied and growable modes of FNboSerializeToBuffer
+ *
+ * @param NumPackets the number of responses encoded per writer
+ */
+void TestNboEncodeThroughput(int32 NumPackets)
+{
+	TArray<FString> SettingNames;
+	for (int32 Index = 0; Index < NBO_TEST_NUM_SETTINGS; Index++)
+	{
+		SettingNames.Add(FString::Printf(TEXT("SETTING_%d"), Index));
+	}
+
+	if (!TestNboWriterModes(SettingNames))
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboEncodeTest: FAILED! Writer modes produced different packets"));
+		return;
+	}
+
+	uint32 LegacyChecksum = 0;
+	const double LegacySeconds = TimeEncode(NumPackets, LegacyChecksum, [&SettingNames](uint64 Nonce)
+	{
+		FLegacyNboWriter Packet(LAN_BEACON_MAX_PACKET_SIZE);
+		EncodeBeaconResponse(Packet, SettingNames, Nonce);
+		return Packet.GetByteCount();
+	});
+
+	uint32 OwnedChecksum = 0;
+	const double OwnedSeconds = TimeEncode(NumPackets, OwnedChecksum, [&SettingNames](uint64 Nonce)
+	{
+		FNboSerializeToBuffer Packet(LAN_BEACON_MAX_PACKET_SIZE);
+		EncodeBeaconResponse(Packet, SettingNames, Nonce);
+		return Packet.GetByteCount();
+	});
+
+	uint32 ExternalChecksum = 0;
+	const double ExternalSeconds = TimeEncode(NumPackets, ExternalChecksum, [&SettingNames](uint64 Nonce)
+	{
+		uint8 PacketBuffer[LAN_BEACON_MAX_PACKET_SIZE];
+		FNboSerializeToBuffer Packet(PacketBuffer, LAN_BEACON_MAX_PACKET_SIZE);
+		EncodeBeaconResponse(Packet, SettingNames, Nonce);
+		return Packet.GetByteCount();
+	});
+
+	uint32 GrowableChecksum = 0;
+	const double GrowableSeconds = TimeEncode(NumPackets, GrowableChecksum, [&SettingNames](uint64 Nonce)
+	{
+		FNboSerializeToBuffer Packet(128, ENboWriteMode::Growable);
+		EncodeBeaconResponse(Packet, SettingNames, Nonce);
+		return Packet.GetByteCount();
+	});
+
+	if (OwnedChecksum != LegacyChecksum || ExternalChecksum != LegacyChecksum || GrowableChecksum != LegacyChecksum)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboEncodeTest: FAILED! Writers encoded different sizes"));
+		return;
+	}
+
+	const double BytesPerRun = (double)LegacyChecksum;
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboEncodeTest: %d responses of %u bytes"), NumPackets, LegacyChecksum / FMath::Max(NumPackets, 1));
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboEncodeTest: zero filled  %.3f ms (%.1f MB/s)"), LegacySeconds * 1000.0, BytesPerRun / FMath::Max(LegacySeconds, 1e-9) / (1024.0 * 1024.0));
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboEncodeTest: owned        %.3f ms (%.1f MB/s)"), OwnedSeconds * 1000.0, BytesPerRun / FMath::Max(OwnedSeconds, 1e-9) / (1024.0 * 1024.0));
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboEncodeTest: stack buffer %.3f ms (%.1f MB/s)"), ExternalSeconds * 1000.0, BytesPerRun / FMath::Max(ExternalSeconds, 1e-9) / (1024.0 * 1024.0));
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboEncodeTest: growable     %.3f ms (%.1f MB/s)"), GrowableSeconds * 1000.0, BytesPerRun / FMath::Max(GrowableSeconds, 1e-9) / (1024.0 * 1024.0));
+	UE_LOG(LogB3atZOnline, Warning, TEXT("NboEncodeTest: PASSED!"));
+}
+
+/** Reads a key the way the reader did before, through an Alloca copy, FUTF8ToTCHAR, an FString and an FName */
+static FName LegacyReadName(FNboSerializeFromBuffer& Packet)
+{
+	int32 Len = 0;
+	Packet >> Len;
+	if (Packet.HasOverflow() || Len <= 0 || Len > Packet.AvailableToRead())
+	{
+		return NAME_None;
+	}
+	char* Temp = (char*)FMemory_Alloca(Len + 1);
+	Packet.ReadBinary((uint8*)Temp, Len);
+	Temp[Len] = '\0';
+	FString NameString = FUTF8ToTCHAR(Temp).Get();
+	return FName(*NameString);
+}
+
+/** Checks strings and names survive a round trip and that views compare without converting */
+static bool TestNboStringRoundTrip()
+{
+	// A character outside the BMP, a surrogate pair where TCHAR is UTF-16
+	FString Emoji;
+	if (sizeof(TCHAR) == 2)
+	{
+		Emoji.AppendChar((TCHAR)0xD83D);
+		Emoji.AppendChar((TCHAR)0xDE00);
+	}
+	else
+	{
+		Emoji.AppendChar((TCHAR)0x1F600);
+	}
+	const FString Strings[] = { FString(), FString(TEXT("MAPNAME")), FString(TEXT("Caf\x00E9 \x20AC")), Emoji + TEXT(" emoji") };
+	const FName Names[] = { FName(TEXT("SETTING_MAPNAME")), FName(TEXT("Key"), 3), FName(TEXT("Stra\x00DF")) };
+
+	uint8 PacketBuffer[512];
+	FNboSerializeToBuffer Writer(PacketBuffer, sizeof(PacketBuffer));
+	for (const FString& String : Strings)
+	{
+		Writer << String;
+		Writer.WritePackedString(String);
+	}
+	for (const FName& Name : Names)
+	{
+		Writer << Name;
+	}
+	Writer << TEXT("MAPNAME");
+	if (Writer.HasOverflow())
+	{
+		return false;
+	}
+
+	FNboSerializeFromBuffer Reader(PacketBuffer, Writer.GetByteCount());
+	FString Read;
+	for (const FString& String : Strings)
+	{
+		Reader >> Read;
+		if (Read != String)
+		{
+			return false;
+		}
+		Reader.ReadPackedString(Read);
+		if (Read != String)
+		{
+			return false;
+		}
+	}
+	for (const FName& Name : Names)
+	{
+		FName ReadName;
+		Reader >> ReadName;
+		if (ReadName != Name || ReadName.GetNumber() != Name.GetNumber())
+		{
+			return false;
+		}
+	}
+	FNboStringView View;
+	return Reader.ReadStringView(View)
+		&& View.Equals("MAPNAME") && View.Equals(TEXT("MAPNAME")) && !View.Equals(TEXT("MAPNAM")) && !View.Equals(TEXT("MAPNAMES"))
+		&& !Reader.HasOverflow() && Reader.AvailableToRead() == 0;
+}
+
+/**
+ * Checks string and name round trips, then times reading setting keys the old way,
+ * as names straight from the packet bytes and as views compared against a key
+ *
+ * @param NumKeys the number of keys read per method
+ */
+void TestNboStringThroughput(int32 NumKeys)
+{
+	if (!TestNboStringRoundTrip())
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboStringTest: FAILED! Strings didn't survive a round trip"));
+		return;
+	}
+
+	FNboSerializeToBuffer Packet(1024, ENboWriteMode::Growable);
+	for (int32 Index = 0; Index < NBO_TEST_NUM_SETTINGS; Index++)
+	{
+		Packet << FName(*FString::Printf(TEXT("SETTING_%d"), Index));
+	}
+	const int32 NumPasses = FMath::Max(NumKeys / NBO_TEST_NUM_SETTINGS, 1);
+
+	int32 LegacyMatches = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		FNboSerializeFromBuffer Reader(Packet, Packet.GetByteCount());
+		for (int32 Index = 0; Index < NBO_TEST_NUM_SETTINGS; Index++)
+		{
+			LegacyMatches += LegacyReadName(Reader) != NAME_None;
+		}
+	}
+	const double LegacySeconds = FPlatformTime::Seconds() - StartTime;
+
+	int32 NameMatches = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		FNboSerializeFromBuffer Reader(Packet, Packet.GetByteCount());
+		FName Key;
+		for (int32 Index = 0; Index < NBO_TEST_NUM_SETTINGS; Index++)
+		{
+			Reader >> Key;
+			NameMatches += Key != NAME_None;
+		}
+	}
+	const double NameSeconds = FPlatformTime::Seconds() - StartTime;
+
+	int32 ViewMatches = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		FNboSerializeFromBuffer Reader(Packet, Packet.GetByteCount());
+		FNboStringView Key;
+		for (int32 Index = 0; Index < NBO_TEST_NUM_SETTINGS; Index++)
+		{
+			Reader.ReadStringView(Key);
+			ViewMatches += Key.Equals("SETTING_7");
+		}
+	}
+	const double ViewSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (LegacyMatches != NameMatches || ViewMatches != NumPasses)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboStringTest: FAILED! Readers disagree on the keys"));
+		return;
+	}
+
+	const int32 NumRead = NumPasses * NBO_TEST_NUM_SETTINGS;
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboStringTest: %d keys"), NumRead);
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboStringTest: via FString %.3f ms (%.0f ns/key)"), LegacySeconds * 1000.0, LegacySeconds * 1e9 / NumRead);
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboStringTest: FName       %.3f ms (%.0f ns/key)"), NameSeconds * 1000.0, NameSeconds * 1e9 / NumRead);
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboStringTest: view        %.3f ms (%.0f ns/key)"), ViewSeconds * 1000.0, ViewSeconds * 1e9 / NumRead);
+	UE_LOG(LogB3atZOnline, Warning, TEXT("NboStringTest: PASSED!"));
+}
+
+/** Writes one number the way callers did before WriteArray, 16 bit values have no operator so they go as two bytes */
+static void WriteNboElement(FNboSerializeToBuffer& Packet, uint16 Value)
+{
+	Packet << (uint8)(Value >> 8) << (uint8)(Value & 0xFF);
+}
+
+template<typename ElementType>
+static void WriteNboElement(FNboSerializeToBuffer& Packet, const ElementType& Value)
+{
+	Packet << Value;
+}
+
+/**
+ * Times writing and reading an array of one element type element by element and with WriteArray/ReadArray
+ *
+ * @param TypeName name of the type for the log
+ * @param NumElements the number of elements in the array
+ * @param NumPasses how often the array is written and read
+ * @return false if the bulk and per element encodings differ or the array didn't survive a round trip
+ */
+template<typename ElementType>
+static bool BenchmarkNboArray(const TCHAR* TypeName, int32 NumElements, int32 NumPasses)
+{
+	TArray<ElementType> Source;
+	Source.SetNumUninitialized(NumElements);
+	uint8* SourceBytes = (uint8*)Source.GetData();
+	for (int32 Index = 0; Index < NumElements * (int32)sizeof(ElementType); Index++)
+	{
+		SourceBytes[Index] = (uint8)(Index * 31 + 7);
+	}
+
+	// Both writers reuse one buffer each, so only the encoding is timed
+	const uint32 Size = NumElements * sizeof(ElementType);
+	TArray<uint8> ScalarBuffer;
+	TArray<uint8> BulkBuffer;
+	ScalarBuffer.SetNumUninitialized(Size);
+	BulkBuffer.SetNumUninitialized(Size);
+	uint32 ScalarBytes = 0;
+	uint32 BulkBytes = 0;
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		FNboSerializeToBuffer Packet(ScalarBuffer.GetData(), Size);
+		for (const ElementType& Element : Source)
+		{
+			WriteNboElement(Packet, Element);
+		}
+		ScalarBytes = Packet.HasOverflow() ? 0 : Packet.GetByteCount();
+	}
+	const double ScalarWriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		FNboSerializeToBuffer Packet(BulkBuffer.GetData(), Size);
+		Packet.WriteArray(Source.GetData(), NumElements);
+		BulkBytes = Packet.HasOverflow() ? 0 : Packet.GetByteCount();
+	}
+	const double BulkWriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+	TArray<ElementType> Read;
+	Read.SetNumUninitialized(NumElements);
+	bool bReadOverflowed = false;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		FNboSerializeFromBuffer Reader(BulkBuffer.GetData(), Size);
+		Reader.ReadArray(Read.GetData(), NumElements);
+		bReadOverflowed |= Reader.HasOverflow();
+	}
+	const double BulkReadSeconds = FPlatformTime::Seconds() - StartTime;
+
+	const bool bMatches = ScalarBytes == Size && BulkBytes == Size && !bReadOverflowed
+		&& ScalarBuffer == BulkBuffer
+		&& FMemory::Memcmp(Read.GetData(), Source.GetData(), Size) == 0;
+
+	const double TotalMB = (double)Size * NumPasses / (1024.0 * 1024.0);
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboArrayTest: %-6s per element %8.1f MB/s, WriteArray %8.1f MB/s, ReadArray %8.1f MB/s"),
+		TypeName,
+		TotalMB / FMath::Max(ScalarWriteSeconds, 1e-9),
+		TotalMB / FMath::Max(BulkWriteSeconds, 1e-9),
+		TotalMB / FMath::Max(BulkReadSeconds, 1e-9));
+	return bMatches;
+}
+
+/** Checks that a count from a truncated or hostile packet overflows instead of allocating */
+static bool TestNboArrayBounds()
+{
+	uint8 PacketBuffer[16];
+	FNboSerializeToBuffer Writer(PacketBuffer, sizeof(PacketBuffer));
+	Writer << (int32)0x40000000 << (uint32)1;
+	FNboSerializeFromBuffer Reader(PacketBuffer, Writer.GetByteCount());
+	TArray<uint64> Elements;
+	Reader.ReadArray(Elements);
+	return Reader.HasOverflow() && Elements.Num() == 0;
+}
+
+/**
+ * Micro benchmarks of WriteArray/ReadArray against per element serialization for the common element types
+ *
+ * @param NumElements the number of elements per array
+ */
+void TestNboArrayThroughput(int32 NumElements)
+{
+	// Roughly the same amount of data for every array size
+	const int32 NumPasses = FMath::Max((16 * 1024 * 1024) / (NumElements * 8), 1);
+
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboArrayTest: %d elements, %d passes, %s"), NumElements, NumPasses,
+		NBO_SWAP_WITH_SSE2 ? TEXT("SSE2 byte swap") : PLATFORM_LITTLE_ENDIAN ? TEXT("scalar byte swap") : TEXT("memcpy"));
+
+	bool bPassed = TestNboArrayBounds();
+	bPassed &= BenchmarkNboArray<uint8>(TEXT("uint8"), NumElements, NumPasses);
+	bPassed &= BenchmarkNboArray<uint16>(TEXT("uint16"), NumElements, NumPasses);
+	bPassed &= BenchmarkNboArray<int32>(TEXT("int32"), NumElements, NumPasses);
+	bPassed &= BenchmarkNboArray<uint64>(TEXT("uint64"), NumElements, NumPasses);
+	bPassed &= BenchmarkNboArray<float>(TEXT("float"), NumElements, NumPasses);
+	bPassed &= BenchmarkNboArray<double>(TEXT("double"), NumElements, NumPasses);
+
+	if (!bPassed)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboArrayTest: FAILED! Bulk and per element encodings differ"));
+		return;
+	}
+	UE_LOG(LogB3atZOnline, Warning, TEXT("NboArrayTest: PASSED!"));
+}
+
+/** Writes a beacon header field by field, as the beacon did before FB3atZBeaconHeader */
+static void StreamBeaconHeader(FNboSerializeToBuffer& Packet, int32 GameId, uint64 Nonce)
+{
+	Packet << LAN_BEACON_PACKET_VERSION << (uint8)1 << GameId << LAN_SERVER_QUERY1 << LAN_SERVER_QUERY2 << Nonce;
+}
+
+/**
+ * Checks the beacon layouts encode the same bytes as streaming the fields did, decode them
+ * back and patch single fields in place, then times header encoding both ways
+ *
+ * @param NumPackets the number of headers encoded per method
+ */
+void TestNboPacketLayout(int32 NumPackets)
+{
+	const int32 GameId = 0x1234ABCD;
+	const uint64 Nonce = 0x0102030405060708ULL;
+
+	uint8 Streamed[FB3atZBeaconHeader::Size];
+	FNboSerializeToBuffer StreamWriter(Streamed, sizeof(Streamed));
+	StreamBeaconHeader(StreamWriter, GameId, Nonce);
+
+	uint8 Encoded[FB3atZBeaconHeader::Size];
+	FNboSerializeToBuffer LayoutWriter(Encoded, sizeof(Encoded));
+	const bool bWritten = FB3atZBeaconHeader::Write(LayoutWriter, LAN_BEACON_PACKET_VERSION, 1, GameId, LAN_SERVER_QUERY1, LAN_SERVER_QUERY2, Nonce);
+	const bool bOverflowDetected = !FB3atZBeaconHeader::Write(LayoutWriter, 0, 0, 0, 0, 0, 0) && LayoutWriter.HasOverflow();
+
+	uint8 Version, Platform, Type1, Type2;
+	int32 ReadGameId;
+	uint64 ReadNonce;
+	FNboSerializeFromBuffer Reader(Encoded, sizeof(Encoded));
+	const bool bRead = FB3atZBeaconHeader::Read(Reader, Version, Platform, ReadGameId, Type1, Type2, ReadNonce);
+
+	FB3atZBeaconHeader::Set<EB3atZBeaconHeaderField::Nonce>(Encoded, Nonce + 1);
+	const bool bPatched = FB3atZBeaconHeader::Get<EB3atZBeaconHeaderField::Nonce>(Encoded) == Nonce + 1
+		&& FB3atZBeaconHeader::Get<EB3atZBeaconHeaderField::GameId>(Encoded) == GameId
+		&& Encoded[LAN_BEACON_NONCE_OFFSET + 7] == (uint8)((Nonce + 1) & 0xFF);
+
+	if (!bWritten || !bOverflowDetected || StreamWriter.GetByteCount() != FB3atZBeaconHeader::Size ||
+		!bRead || Version != LAN_BEACON_PACKET_VERSION || ReadGameId != GameId || Type2 != LAN_SERVER_QUERY2 || ReadNonce != Nonce || !bPatched)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboLayoutTest: FAILED! Beacon header layout doesn't round trip"));
+		return;
+	}
+	FB3atZBeaconHeader::Set<EB3atZBeaconHeaderField::Nonce>(Encoded, Nonce);
+	if (FMemory::Memcmp(Streamed, Encoded, FB3atZBeaconHeader::Size) != 0)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboLayoutTest: FAILED! Layout and streamed headers differ on the wire"));
+		return;
+	}
+
+	uint8 PacketBuffer[FB3atZBeaconHeader::Size];
+	uint32 Checksum = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumPackets; Index++)
+	{
+		FNboSerializeToBuffer Packet(PacketBuffer, sizeof(PacketBuffer));
+		StreamBeaconHeader(Packet, GameId, (uint64)Index);
+		Checksum += PacketBuffer[FB3atZBeaconHeader::Size - 1];
+	}
+	const double StreamSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumPackets; Index++)
+	{
+		FB3atZBeaconHeader::Encode(PacketBuffer, LAN_BEACON_PACKET_VERSION, 1, GameId, LAN_SERVER_QUERY1, LAN_SERVER_QUERY2, (uint64)Index);
+		Checksum -= PacketBuffer[FB3atZBeaconHeader::Size - 1];
+	}
+	const double LayoutSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (Checksum != 0)
+	{
+		UE_LOG(LogB3atZOnline, Warning, TEXT("NboLayoutTest: FAILED! Timed encodings differ"));
+		return;
+	}
+	UE_LOG(LogB3atZOnline, Display, TEXT("NboLayoutTest: %d headers, streamed %.3f ms, layout %.3f ms"), NumPackets, StreamSeconds * 1000.0, LayoutSeconds * 1000.0);
+	UE_LOG(LogB3atZOnline, Warning, TEXT("NboLayoutTest: PASSED!"));
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS